@@ -22,7 +22,17 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 
 HEADERS += \
     hashmap.h \
-    hashmap_iterator.h
+    hashmap_concurrent.h \
+    hashmap_dense.h \
+    hashmap_epoch.h \
+    hashmap_frozen.h \
+    hashmap_iterator.h \
+    hashmap_node_pool.h \
+    hashmap_robin_hood.h \
+    hashmap_sharded.h \
+    hashmap_snapshot.h \
+    hashmap_static.h \
+    hashmap_swiss.h
 
 DISTFILES += \
     short_answer.txt
@@ -6,112 +6,468 @@
 #include "hashmap.h"
 
 // See milestone 2 about delegating constructors (when HashMap is called in the initalizer list below)
-template <typename K, typename M, typename H>
-HashMap<K, M, H>::HashMap() : HashMap{kDefaultBuckets} { }
+template <typename K, typename M, typename H, typename S, typename A>
+HashMap<K, M, H, S, A>::HashMap() : HashMap{kDefaultBuckets} { }
 
-template <typename K, typename M, typename H>
-HashMap<K, M, H>::HashMap(size_t bucket_count, const H& hash) :
+template <typename K, typename M, typename H, typename S, typename A>
+HashMap<K, M, H, S, A>::HashMap(size_t bucket_count, const H& hash, const allocator_type& alloc) :
     _size{0},
     _hash_function{hash},
-    _buckets_array{bucket_count, nullptr} { }
+    _buckets_array(indexing::bucket_count(bucket_count), nullptr, typename bucket_array_type::allocator_type(alloc)),
+    _occupied(_buckets_array.size(), typename occupancy_bitmap::allocator_type(alloc)),
+    _old_buckets_array(typename bucket_array_type::allocator_type(alloc)),
+    _migrated{0},
+    _pool{alloc},
+    _incremental_rehash{false},
+    _max_load_factor{1.0f} { }
 
-template <typename K, typename M, typename H>
-HashMap<K, M, H>::~HashMap() {
+template <typename K, typename M, typename H, typename S, typename A>
+HashMap<K, M, H, S, A>::HashMap(const allocator_type& alloc) : HashMap(kDefaultBuckets, H(), alloc) { }
+
+template <typename K, typename M, typename H, typename S, typename A>
+HashMap<K, M, H, S, A>::~HashMap() {
     clear();
 }
 
-template <typename K, typename M, typename H>
-inline size_t HashMap<K, M, H>::size() const noexcept {
+template <typename K, typename M, typename H, typename S, typename A>
+inline size_t HashMap<K, M, H, S, A>::size() const noexcept {
     return _size;
 }
 
-template <typename K, typename M, typename H>
-inline bool HashMap<K, M, H>::empty() const noexcept {
+template <typename K, typename M, typename H, typename S, typename A>
+inline bool HashMap<K, M, H, S, A>::empty() const noexcept {
     return size() == 0;
 }
 
-template <typename K, typename M, typename H>
-inline float HashMap<K, M, H>::load_factor() const noexcept {
+template <typename K, typename M, typename H, typename S, typename A>
+inline float HashMap<K, M, H, S, A>::load_factor() const noexcept {
     return static_cast<float>(size())/bucket_count();
 };
 
-template <typename K, typename M, typename H>
-inline size_t HashMap<K, M, H>::bucket_count() const noexcept {
+template <typename K, typename M, typename H, typename S, typename A>
+inline size_t HashMap<K, M, H, S, A>::bucket_count() const noexcept {
     return _buckets_array.size();
 };
 
-template <typename K, typename M, typename H>
-M& HashMap<K, M, H>::at(const K& key) {
+template <typename K, typename M, typename H, typename S, typename A>
+size_t HashMap<K, M, H, S, A>::max_bucket_count() const noexcept {
+    return _buckets_array.max_size();
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+size_t HashMap<K, M, H, S, A>::bucket(const K& key) const {
+    return bucket_index(_hash_function(key));
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename KeyLike, typename>
+size_t HashMap<K, M, H, S, A>::bucket(const KeyLike& key) const {
+    return bucket_index(_hash_function(key));
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+size_t HashMap<K, M, H, S, A>::bucket_size(size_t n) const noexcept {
+    size_t count = 0;
+    for (auto iter = begin(n); iter != end(n); ++iter) {
+        ++count;
+    }
+    return count;
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+typename HashMap<K, M, H, S, A>::local_iterator HashMap<K, M, H, S, A>::begin(size_t n) noexcept {
+    return local_iterator(bucket_front(n));
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+typename HashMap<K, M, H, S, A>::local_iterator HashMap<K, M, H, S, A>::end(size_t) noexcept {
+    return local_iterator(nullptr);
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+typename HashMap<K, M, H, S, A>::const_local_iterator HashMap<K, M, H, S, A>::begin(size_t n) const noexcept {
+    // see static_cast/const_cast trick explained in find().
+    return static_cast<const_local_iterator>(const_cast<HashMap<K, M, H, S, A>*>(this)->begin(n));
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+typename HashMap<K, M, H, S, A>::const_local_iterator HashMap<K, M, H, S, A>::end(size_t n) const noexcept {
+    return static_cast<const_local_iterator>(const_cast<HashMap<K, M, H, S, A>*>(this)->end(n));
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+typename HashMap<K, M, H, S, A>::allocator_type HashMap<K, M, H, S, A>::get_allocator() const noexcept {
+    return _pool.get_allocator();
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+H HashMap<K, M, H, S, A>::hash_function() const {
+    return _hash_function;
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+float HashMap<K, M, H, S, A>::max_load_factor() const noexcept {
+    return _max_load_factor;
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+void HashMap<K, M, H, S, A>::max_load_factor(float ml) {
+    if (!(ml > 0)) {
+        throw std::out_of_range("HashMap<K, M, H, S, A>::max_load_factor: max load factor must be positive.");
+    }
+    _max_load_factor = ml;
+    if (load_factor() > _max_load_factor) {
+        rehash(min_bucket_count(size()));
+    }
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+void HashMap<K, M, H, S, A>::reserve(size_t count) {
+    size_t needed = min_bucket_count(count);
+    if (needed > bucket_count()) {
+        rehash(needed);
+    }
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+bool HashMap<K, M, H, S, A>::incremental_rehash() const noexcept {
+    return _incremental_rehash;
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+void HashMap<K, M, H, S, A>::incremental_rehash(bool enabled) {
+    _incremental_rehash = enabled;
+    if (!enabled) {
+        migrate_buckets(_old_buckets_array.size());
+    }
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+bool HashMap<K, M, H, S, A>::rehash_in_progress() const noexcept {
+    return !_old_buckets_array.empty();
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+size_t HashMap<K, M, H, S, A>::min_bucket_count(size_t count) const noexcept {
+    float buckets = std::ceil(count / _max_load_factor);
+    return buckets < 1 ? 1 : static_cast<size_t>(buckets);
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+M& HashMap<K, M, H, S, A>::at(const K& key) {
     auto [prev, node_found] = find_node(key);
             if (node_found == nullptr) {
-        throw std::out_of_range("HashMap<K, M, H>::at: key not found");
+        throw std::out_of_range("HashMap<K, M, H, S, A>::at: key not found");
     }
     return node_found->value.second;
 }
 
-template <typename K, typename M, typename H>
-const M& HashMap<K, M, H>::at(const K& key) const {
+template <typename K, typename M, typename H, typename S, typename A>
+const M& HashMap<K, M, H, S, A>::at(const K& key) const {
     // see static_cast/const_cast trick explained in find().
-    return static_cast<const M&>(const_cast<HashMap<K, M, H>*>(this)->at(key));
+    return static_cast<const M&>(const_cast<HashMap<K, M, H, S, A>*>(this)->at(key));
 }
 
-template <typename K, typename M, typename H>
-bool HashMap<K, M, H>::contains(const K& key) const noexcept {
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename KeyLike, typename>
+M& HashMap<K, M, H, S, A>::at(const KeyLike& key) {
+    node* node_found = find_node(key).second;
+    if (node_found == nullptr) {
+        throw std::out_of_range("HashMap<K, M, H, S, A>::at: key not found");
+    }
+    return node_found->value.second;
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename KeyLike, typename>
+const M& HashMap<K, M, H, S, A>::at(const KeyLike& key) const {
+    // see static_cast/const_cast trick explained in find().
+    return static_cast<const M&>(const_cast<HashMap<K, M, H, S, A>*>(this)->at(key));
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+bool HashMap<K, M, H, S, A>::contains(const K& key) const noexcept {
     return find_node(key).second != nullptr;
 }
 
-template <typename K, typename M, typename H>
-void HashMap<K, M, H>::clear() noexcept {
-    for (auto& curr : _buckets_array) {
-        while (curr != nullptr) {
-            auto trash = curr;
-            curr = curr->next;
-            delete trash;
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename KeyLike, typename>
+bool HashMap<K, M, H, S, A>::contains(const KeyLike& key) const noexcept {
+    return find_node(key).second != nullptr;
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+void HashMap<K, M, H, S, A>::clear() noexcept {
+    destroy_nodes();
+    _pool.release(); // every node is destroyed, so hand the slabs back all at once
+    // nothing left to move, so any rehash in progress is done
+    _old_buckets_array.clear();
+    _old_buckets_array.shrink_to_fit();
+    _migrated = 0;
+    _size = 0;
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+void HashMap<K, M, H, S, A>::destroy_nodes() noexcept {
+    for (auto* array : {&_buckets_array, &_old_buckets_array}) {
+        for (auto& curr : *array) {
+            while (curr != nullptr) {
+                auto trash = curr;
+                curr = curr->next;
+                _pool.destroy(trash);
+            }
         }
     }
+    _occupied.clear();
     _size = 0;
 }
 
-template <typename K, typename M, typename H>
-typename HashMap<K, M, H>::iterator HashMap<K, M, H>::find(const K& key) {
+template <typename K, typename M, typename H, typename S, typename A>
+void HashMap<K, M, H, S, A>::clone_from(const HashMap& rhs) {
+    _buckets_array.assign(rhs._buckets_array.size(), nullptr);
+    _occupied.assign(rhs._occupied); // sized like rhs's, but marked only as chains are linked,
+    _occupied.clear();               // so a copy that throws leaves no bit on an empty bucket
+    _old_buckets_array.assign(rhs._old_buckets_array.size(), nullptr);
+    if (_old_buckets_array.empty()) {
+        _old_buckets_array.shrink_to_fit();
+    }
+    _migrated = rhs._migrated;
+
+    for (auto [array, rhs_array] : {std::pair{&_buckets_array, &rhs._buckets_array},
+                                    std::pair{&_old_buckets_array, &rhs._old_buckets_array}}) {
+        for (size_t i = 0; i < rhs_array->size(); ++i) {
+            // append each copy at the tail, so every chain keeps rhs's order
+            node** tail = &(*array)[i];
+            for (node* curr = (*rhs_array)[i]; curr != nullptr; curr = curr->next) {
+                node* copy = _pool.create(curr->value, nullptr);
+                if constexpr (kCacheHash) {
+                    copy->hash = curr->hash;
+                }
+                *tail = copy;
+                tail = &copy->next;
+                ++_size; // counted as it is linked in, so the map stays valid if a copy throws
+                if (array == &_buckets_array) {
+                    _occupied.set(i);
+                }
+            }
+        }
+    }
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+typename HashMap<K, M, H, S, A>::iterator HashMap<K, M, H, S, A>::find(const K& key) {
+    migrate_buckets(kRehashStep);
     return make_iterator(find_node(key).second);
 }
 
-template <typename K, typename M, typename H>
-typename HashMap<K, M, H>::const_iterator HashMap<K, M, H>::find(const K& key) const {
+template <typename K, typename M, typename H, typename S, typename A>
+typename HashMap<K, M, H, S, A>::const_iterator HashMap<K, M, H, S, A>::find(const K& key) const {
     // This is called the static_cast/const_cast trick, which allows us to reuse
     // the non-const version of find to implement the const version.
     // The idea is to cast this so it's pointing to a non-const HashMap, which
     // calls the overload above (and prevent infinite recursion).
     // Also note that we are calling the conversion operator in the iterator class!
-    return static_cast<const_iterator>(const_cast<HashMap<K, M, H>*>(this)->find(key));
+    // Unlike find above, this must not move any buckets, since *this may really be const.
+    return static_cast<const_iterator>(const_cast<HashMap<K, M, H, S, A>*>(this)->make_iterator(find_node(key).second));
 }
 
-template <typename K, typename M, typename H>
-std::pair<typename HashMap<K, M, H>::iterator, bool> HashMap<K, M, H>::insert(const value_type& value) {
-    const auto& [key, mapped] = value;
-    auto [prev, node_to_edit] = find_node(key);
-    size_t index = _hash_function(key) % bucket_count();
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename KeyLike, typename>
+typename HashMap<K, M, H, S, A>::iterator HashMap<K, M, H, S, A>::find(const KeyLike& key) {
+    migrate_buckets(kRehashStep);
+    return make_iterator(find_node(key).second);
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename KeyLike, typename>
+typename HashMap<K, M, H, S, A>::const_iterator HashMap<K, M, H, S, A>::find(const KeyLike& key) const {
+    // see static_cast/const_cast trick explained in find() above.
+    return static_cast<const_iterator>(const_cast<HashMap<K, M, H, S, A>*>(this)->make_iterator(find_node(key).second));
+}
 
-    if (node_to_edit != nullptr) {
-        return {make_iterator(node_to_edit), false};
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename ForwardIt, typename OutputIt>
+OutputIt HashMap<K, M, H, S, A>::find_many(ForwardIt first, ForwardIt last, OutputIt out) {
+    migrate_buckets(kRehashStep);
+    find_batched(first, last, [&](node* curr, size_t bucket) {
+        *out++ = iterator(this, curr, curr == nullptr ? bucket_end() : bucket);
+    });
+    return out;
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename ForwardIt, typename OutputIt>
+OutputIt HashMap<K, M, H, S, A>::find_many(ForwardIt first, ForwardIt last, OutputIt out) const {
+    // see static_cast/const_cast trick explained in find() above. No buckets are moved.
+    auto* self = const_cast<HashMap<K, M, H, S, A>*>(this);
+    find_batched(first, last, [&](node* curr, size_t bucket) {
+        *out++ = const_iterator(self, curr, curr == nullptr ? bucket_end() : bucket);
+    });
+    return out;
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename ForwardIt, typename OutputIt>
+OutputIt HashMap<K, M, H, S, A>::contains_many(ForwardIt first, ForwardIt last, OutputIt out) const {
+    find_batched(first, last, [&](node* curr, size_t) {
+        *out++ = curr != nullptr;
+    });
+    return out;
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+std::pair<typename HashMap<K, M, H, S, A>::iterator, bool> HashMap<K, M, H, S, A>::insert(const value_type& value) {
+    return emplace_key(value.first, value);
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+std::pair<typename HashMap<K, M, H, S, A>::iterator, bool> HashMap<K, M, H, S, A>::insert(value_type&& value) {
+    return emplace_key(value.first, std::move(value));
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename... Args>
+std::pair<typename HashMap<K, M, H, S, A>::iterator, bool> HashMap<K, M, H, S, A>::emplace(Args&&... args) {
+    // the key is part of the element, so the node has to be built before the lookup
+    node* temp = _pool.create(nullptr, std::forward<Args>(args)...);
+    size_t hash;
+    try {
+        // hashing, comparing keys or growing may throw, and then the node is freed
+        const K& key = temp->value.first;
+        hash = _hash_function(key);
+        store_hash(temp, hash);
+        migrate_buckets(kRehashStep);
+        node* found = find_node(key, hash).second;
+        if (found != nullptr) {
+            _pool.destroy(temp);
+            return {make_iterator(found), false};
+        }
+        grow_for_insert();
+    } catch (...) {
+        _pool.destroy(temp);
+        throw;
     }
 
-    auto temp = new node(value, _buckets_array[index]);
-    _buckets_array[index] = temp;
+    size_t bucket = bucket_index(hash);
+    node*& front = bucket_slot(bucket);
+    temp->next = front;
+    front = temp;
+    sync_occupied(bucket);
 
     ++_size;
     return {make_iterator(temp), true};
 }
 
-template <typename K, typename M, typename H>
-typename HashMap<K, M, H>::node_pair HashMap<K, M, H>::find_node(const K& key) const {
-    size_t index = _hash_function(key) % bucket_count();
-    node* curr = _buckets_array[index];
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename... Args>
+std::pair<typename HashMap<K, M, H, S, A>::iterator, bool> HashMap<K, M, H, S, A>::try_emplace(const K& key, Args&&... args) {
+    return emplace_key(key, std::piecewise_construct, std::forward_as_tuple(key),
+                       std::forward_as_tuple(std::forward<Args>(args)...));
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename... Args>
+std::pair<typename HashMap<K, M, H, S, A>::iterator, bool> HashMap<K, M, H, S, A>::try_emplace(K&& key, Args&&... args) {
+    // key is only moved from once the lookup is done and the node is being built
+    return emplace_key(key, std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                       std::forward_as_tuple(std::forward<Args>(args)...));
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename Obj>
+std::pair<typename HashMap<K, M, H, S, A>::iterator, bool> HashMap<K, M, H, S, A>::insert_or_assign(const K& key, Obj&& obj) {
+    auto result = try_emplace(key, std::forward<Obj>(obj));
+    if (!result.second) {
+        // try_emplace didn't touch obj, since key was already there
+        result.first->second = std::forward<Obj>(obj);
+    }
+    return result;
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename Obj>
+std::pair<typename HashMap<K, M, H, S, A>::iterator, bool> HashMap<K, M, H, S, A>::insert_or_assign(K&& key, Obj&& obj) {
+    auto result = try_emplace(std::move(key), std::forward<Obj>(obj));
+    if (!result.second) {
+        result.first->second = std::forward<Obj>(obj);
+    }
+    return result;
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename KeyLike, typename... Args>
+std::pair<typename HashMap<K, M, H, S, A>::iterator, bool> HashMap<K, M, H, S, A>::emplace_key(const KeyLike& key, Args&&... args) {
+    size_t hash = _hash_function(key);
+    migrate_buckets(kRehashStep);
+    node* found = find_node(key, hash).second;
+    if (found != nullptr) {
+        return {make_iterator(found), false};
+    }
+
+    return {make_iterator(emplace_new(hash, std::forward<Args>(args)...)), true};
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+void HashMap<K, M, H, S, A>::grow_for_insert() {
+    if (_size + 1 > bucket_count() * _max_load_factor) {
+        rehash(std::max(kGrowthFactor * bucket_count(), min_bucket_count(_size + 1)));
+    }
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename... Args>
+typename HashMap<K, M, H, S, A>::node* HashMap<K, M, H, S, A>::emplace_new(size_t hash, Args&&... args) {
+    grow_for_insert();
+
+    size_t bucket = bucket_index(hash);
+    node*& front = bucket_slot(bucket);
+    auto temp = _pool.create(front, std::forward<Args>(args)...);
+    store_hash(temp, hash);
+    front = temp;
+    sync_occupied(bucket);
+
+    ++_size;
+    return temp;
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename InputIt>
+void HashMap<K, M, H, S, A>::insert_range(InputIt first, InputIt last, bool unique) {
+    // a single-pass input range can only be walked once, so it can't be measured first
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+        size_t count = std::distance(first, last);
+        reserve(_size + count);
+        _pool.reserve(count);
+    }
+    for (auto iter = first; iter != last; ++iter) {
+        if (unique) {
+            emplace_new(_hash_function(iter->first), *iter);
+        } else {
+            emplace_key(iter->first, *iter);
+        }
+    }
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename KeyLike>
+typename HashMap<K, M, H, S, A>::node_pair HashMap<K, M, H, S, A>::find_node(const KeyLike& key) const {
+    return find_node(key, _hash_function(key));
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename KeyLike>
+typename HashMap<K, M, H, S, A>::node_pair HashMap<K, M, H, S, A>::find_node(const KeyLike& key, size_t hash) const {
+    node* curr = const_cast<HashMap<K, M, H, S, A>*>(this)->bucket_slot(bucket_index(hash));
     node* prev = nullptr; // if first node is the key, return {nullptr, front}
     while (curr != nullptr) {
         const auto& [found_key, found_mapped] = curr->value;
-        if (found_key == key) {
+        // a different cached hash code means a different key, without comparing the keys
+        bool same_hash = true;
+        if constexpr (kCacheHash) {
+            same_hash = curr->hash == hash;
+        }
+        if (same_hash && found_key == key) {
             return {prev, curr};
         }
         prev = curr;
@@ -120,80 +476,272 @@ typename HashMap<K, M, H>::node_pair HashMap<K, M, H>::find_node(const K& key) c
     return {nullptr, nullptr}; // key not found at all.
 }
 
-template <typename K, typename M, typename H>
-typename HashMap<K, M, H>::iterator HashMap<K, M, H>::begin() noexcept {
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename ForwardIt, typename Found>
+void HashMap<K, M, H, S, A>::find_batched(ForwardIt first, ForwardIt last, Found found) const {
+    if (bucket_count() < kFindBatchMin) {
+        // the table is in the cache already, so there are no misses to overlap
+        for (; first != last; ++first) {
+            size_t hash = _hash_function(*first);
+            found(find_node(*first, hash).second, bucket_index(hash));
+        }
+        return;
+    }
+    auto* self = const_cast<HashMap<K, M, H, S, A>*>(this);
+    size_t hashes[kFindBatch];
+    size_t buckets[kFindBatch];
+    node* fronts[kFindBatch];
+    while (first != last) {
+        // pass 1: hash the batch and prefetch each key's bucket
+        ForwardIt batch_first = first;
+        size_t count = 0;
+        for (; count < kFindBatch && first != last; ++count, ++first) {
+            hashes[count] = _hash_function(*first);
+            buckets[count] = bucket_index(hashes[count]);
+            __builtin_prefetch(&self->bucket_slot(buckets[count]));
+        }
+        // pass 2: read the buckets, which have arrived by now, and prefetch their front nodes
+        for (size_t i = 0; i < count; ++i) {
+            fronts[i] = self->bucket_slot(buckets[i]);
+            if (fronts[i] != nullptr) {
+                __builtin_prefetch(fronts[i]);
+            }
+        }
+        // pass 3: walk each chain, as find_node does
+        for (size_t i = 0; i < count; ++i, ++batch_first) {
+            const auto& key = *batch_first;
+            node* curr = fronts[i];
+            while (curr != nullptr) {
+                bool same_hash = true;
+                if constexpr (kCacheHash) {
+                    same_hash = curr->hash == hashes[i];
+                }
+                if (same_hash && curr->value.first == key) {
+                    break;
+                }
+                curr = curr->next;
+            }
+            found(curr, buckets[i]);
+        }
+    }
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+typename HashMap<K, M, H, S, A>::iterator HashMap<K, M, H, S, A>::begin() noexcept {
     size_t index = first_not_empty_bucket();
-    if (index == bucket_count()) {
+    if (index == bucket_end()) {
         return end();
     }
-    return make_iterator(_buckets_array[index]);
+    return make_iterator(bucket_front(index));
 }
 
-template <typename K, typename M, typename H>
-typename HashMap<K, M, H>::iterator HashMap<K, M, H>::end() noexcept {
+template <typename K, typename M, typename H, typename S, typename A>
+typename HashMap<K, M, H, S, A>::iterator HashMap<K, M, H, S, A>::end() noexcept {
     return make_iterator(nullptr);
 }
 
-template <typename K, typename M, typename H>
-typename HashMap<K, M, H>::const_iterator HashMap<K, M, H>::begin() const noexcept {
+template <typename K, typename M, typename H, typename S, typename A>
+typename HashMap<K, M, H, S, A>::const_iterator HashMap<K, M, H, S, A>::begin() const noexcept {
     // see static_cast/const_cast trick explained in find().
-    return static_cast<const_iterator>(const_cast<HashMap<K, M, H>*>(this)->begin());
+    return static_cast<const_iterator>(const_cast<HashMap<K, M, H, S, A>*>(this)->begin());
 }
 
-template <typename K, typename M, typename H>
-typename HashMap<K, M, H>::const_iterator HashMap<K, M, H>::end() const noexcept {
+template <typename K, typename M, typename H, typename S, typename A>
+typename HashMap<K, M, H, S, A>::const_iterator HashMap<K, M, H, S, A>::end() const noexcept {
     // see static_cast/const_cast trick explained in find().
-    return static_cast<const_iterator>(const_cast<HashMap<K, M, H>*>(this)->end());
+    return static_cast<const_iterator>(const_cast<HashMap<K, M, H, S, A>*>(this)->end());
 }
 
-template <typename K, typename M, typename H>
-size_t HashMap<K, M, H>::first_not_empty_bucket() const noexcept {
-    auto isNotNullptr = [ ](const auto& v){
-        return v != nullptr;
-    };
+template <typename K, typename M, typename H, typename S, typename A>
+size_t HashMap<K, M, H, S, A>::first_not_empty_bucket() const noexcept {
+    return next_occupied(0);
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+size_t HashMap<K, M, H, S, A>::bucket_index(size_t hash) const noexcept {
+    if (!_old_buckets_array.empty()) {
+        size_t old_index = indexing::index(hash, _old_buckets_array.size());
+        if (old_index >= _migrated) {
+            return bucket_count() + old_index;
+        }
+    }
+    return indexing::index(hash, bucket_count());
+}
 
-    auto found = std::find_if(_buckets_array.begin(), _buckets_array.end(), isNotNullptr);
-    return found - _buckets_array.begin();
+template <typename K, typename M, typename H, typename S, typename A>
+typename HashMap<K, M, H, S, A>::node*& HashMap<K, M, H, S, A>::bucket_slot(size_t bucket) noexcept {
+    return bucket < bucket_count() ? _buckets_array[bucket] : _old_buckets_array[bucket - bucket_count()];
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+void HashMap<K, M, H, S, A>::migrate_buckets(size_t count) {
+    for (; count > 0 && _migrated < _old_buckets_array.size(); --count, ++_migrated) {
+        node*& curr = _old_buckets_array[_migrated];
+        while (curr != nullptr) {
+            size_t index = indexing::index(node_hash(curr), bucket_count());
+            auto temp = curr;
+            curr = temp->next;
+            temp->next = _buckets_array[index];
+            _buckets_array[index] = temp;
+            sync_occupied(index);
+        }
+    }
+    if (!_old_buckets_array.empty() && _migrated == _old_buckets_array.size()) {
+        _old_buckets_array.clear();
+        _old_buckets_array.shrink_to_fit();
+        _migrated = 0;
+    }
 }
 
-template <typename K, typename M, typename H>
-typename HashMap<K, M, H>::iterator HashMap<K, M, H>::make_iterator(node* curr) {
+template <typename K, typename M, typename H, typename S, typename A>
+typename HashMap<K, M, H, S, A>::iterator HashMap<K, M, H, S, A>::make_iterator(node* curr) {
     if (curr == nullptr) {
-        return {&_buckets_array, curr, bucket_count()};
+        return {this, curr, bucket_end()};
     }
-    size_t index = _hash_function(curr->value.first) % bucket_count();
-    return {&_buckets_array, curr, index};
+    return {this, curr, bucket_index(node_hash(curr))};
 }
 
-template <typename K, typename M, typename H>
-bool HashMap<K, M, H>::erase(const K& key) {
-    auto [prev, node_to_erase] = find_node(key);
+template <typename K, typename M, typename H, typename S, typename A>
+size_t HashMap<K, M, H, S, A>::node_hash(const node* n) const {
+    if constexpr (kCacheHash) {
+        return n->hash;
+    } else {
+        return _hash_function(n->value.first);
+    }
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+void HashMap<K, M, H, S, A>::store_hash([[maybe_unused]] node* n, [[maybe_unused]] size_t hash) noexcept {
+    if constexpr (kCacheHash) {
+        n->hash = hash;
+    }
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+size_t HashMap<K, M, H, S, A>::bucket_end() const noexcept {
+    return bucket_count() + _old_buckets_array.size();
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+size_t HashMap<K, M, H, S, A>::next_occupied(size_t bucket) const noexcept {
+    size_t buckets = bucket_count();
+    if (bucket < buckets) {
+        const uint64_t* words = _occupied.data();
+        size_t word = bucket / 64;
+        uint64_t bits = words[word] & (~uint64_t{0} << (bucket % 64)); // drop the buckets before
+        while (bits == 0 && ++word < _occupied.size()) {
+            bits = words[word];
+        }
+        if (bits != 0) {
+            return word * 64 + __builtin_ctzll(bits);
+        }
+        bucket = buckets;
+    }
+    // the old buckets have no bitmap: they only last until the rehash finishes,
+    // and the ones before _migrated are already empty
+    for (bucket = std::max(bucket, buckets + _migrated); bucket < bucket_end(); ++bucket) {
+        if (_old_buckets_array[bucket - buckets] != nullptr) {
+            return bucket;
+        }
+    }
+    return bucket_end();
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+void HashMap<K, M, H, S, A>::sync_occupied(size_t bucket) noexcept {
+    if (bucket < bucket_count()) {
+        if (_buckets_array[bucket] != nullptr) {
+            _occupied.set(bucket);
+        } else {
+            _occupied.reset(bucket);
+        }
+    }
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+void HashMap<K, M, H, S, A>::rebuild_occupied(size_t threads) {
+    size_t words = _occupied.size();
+    uint64_t* data = _occupied.data();
+    auto fill_words = [&](size_t t) {
+        for (size_t word = t * words / threads; word < (t + 1) * words / threads; ++word) {
+            size_t first = word * 64;
+            size_t last = std::min(first + 64, bucket_count());
+            uint64_t bits = 0;
+            for (size_t i = first; i < last; ++i) {
+                bits |= uint64_t{_buckets_array[i] != nullptr} << (i - first);
+            }
+            data[word] = bits;
+        }
+    };
+    threads = std::max<size_t>(std::min(threads, words), 1);
+    run_on_threads(threads, fill_words);
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+typename HashMap<K, M, H, S, A>::node* HashMap<K, M, H, S, A>::bucket_front(size_t bucket) noexcept {
+    return bucket_slot(bucket);
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+typename HashMap<K, M, H, S, A>::node* HashMap<K, M, H, S, A>::next_in_bucket(node* curr) noexcept {
+    return curr->next;
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+bool HashMap<K, M, H, S, A>::erase(const K& key) {
+    migrate_buckets(kRehashStep);
+    return unlink(key, _hash_function(key));
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename KeyLike, typename>
+bool HashMap<K, M, H, S, A>::erase(const KeyLike& key) {
+    migrate_buckets(kRehashStep);
+    return unlink(key, _hash_function(key));
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+typename HashMap<K, M, H, S, A>::iterator HashMap<K, M, H, S, A>::erase(typename HashMap<K, M, H, S, A>::const_iterator pos) {
+    // unlink rather than erase(key), which could move the bucket the next element is in
+    auto erased = pos++._node;
+    unlink(erased->value.first, node_hash(erased));
+    return make_iterator(pos._node); // unfortunately we need a regular iterator, not a const_iterator
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename KeyLike>
+bool HashMap<K, M, H, S, A>::unlink(const KeyLike& key, size_t hash) {
+    auto [prev, node_to_erase] = find_node(key, hash);
     if (node_to_erase == nullptr) {
         return false;
     }
-    size_t index = _hash_function(key) % bucket_count();
-    (prev ? prev->next : _buckets_array[index]) = node_to_erase->next;
+    if (prev != nullptr) {
+        prev->next = node_to_erase->next;
+    } else {
+        size_t bucket = bucket_index(hash);
+        bucket_slot(bucket) = node_to_erase->next;
+        sync_occupied(bucket); // the bucket may be empty now
+    }
+    _pool.destroy(node_to_erase);
     --_size;
     return true;
 }
 
-template <typename K, typename M, typename H>
-typename HashMap<K, M, H>::iterator HashMap<K, M, H>::erase(typename HashMap<K, M, H>::const_iterator pos) {
-    erase(pos++->first);
-    return make_iterator(pos._node); // unfortunately we need a regular iterator, not a const_iterator
-}
-
-template <typename K, typename M, typename H>
-    void HashMap<K, M, H>::debug() const {
+template <typename K, typename M, typename H, typename S, typename A>
+    void HashMap<K, M, H, S, A>::debug() const {
     std::cout << std::setw(30) << std::setfill('-') << '\n' << std::setfill(' ')
           << "Printing debug information for your HashMap implementation\n"
           << "Size: " << size() << std::setw(15) << std::right
           << "Buckets: " << bucket_count() << std::setw(20) << std::right
           << "(load factor: " << std::setprecision(2) << load_factor() << ") \n\n";
 
-    for (size_t i = 0; i < bucket_count(); ++i) {
+    if (rehash_in_progress()) {
+        std::cout << "Rehash in progress: [" << bucket_count() << ", " << bucket_end()
+                  << ") are the old buckets, of which " << _migrated << " have been moved\n";
+    }
+    for (size_t i = 0; i < bucket_end(); ++i) {
         std::cout << "[" << std::setw(3) << i << "]:";
-        node* curr = _buckets_array[i];
+        node* curr = const_cast<HashMap<K, M, H, S, A>*>(this)->bucket_slot(i);
         while (curr != nullptr) {
             const auto& [key, mapped] = curr->value;
             // next line will not compile if << not supported for K or M
@@ -205,25 +753,218 @@ template <typename K, typename M, typename H>
     std::cout << std::setw(30) << std::setfill('-') << '\n' << std::setfill(' ');
 }
 
-template <typename K, typename M, typename H>
-void HashMap<K, M, H>::rehash(size_t new_bucket_count) {
+template <typename K, typename M, typename H, typename S, typename A>
+void HashMap<K, M, H, S, A>::rehash(size_t new_bucket_count) {
 if (new_bucket_count == 0) {
-    throw std::out_of_range("HashMap<K, M, H>::rehash: new_bucket_count must be positive.");
+    throw std::out_of_range("HashMap<K, M, H, S, A>::rehash: new_bucket_count must be positive.");
 }
 
-std::vector<node*> new_buckets_array(new_bucket_count);
+migrate_buckets(_old_buckets_array.size()); // at most one rehash in progress at a time
+new_bucket_count = indexing::bucket_count(new_bucket_count);
+bucket_array_type new_buckets_array(new_bucket_count, nullptr, _buckets_array.get_allocator());
+occupancy_bitmap new_occupied(new_bucket_count, _occupied.get_allocator());
+    if (_incremental_rehash && _size > 0) {
+        _old_buckets_array = std::move(_buckets_array);
+        _buckets_array = std::move(new_buckets_array);
+        _occupied = std::move(new_occupied); // the old buckets have no bits, see next_occupied
+        _migrated = 0;
+        return;
+    }
     for (auto& curr : _buckets_array) { // short answer question is asking about this 'curr'
         while (curr != nullptr) {
-            const auto& [key, mapped] = curr->value;
-            size_t index = _hash_function(key) % new_bucket_count;
+            size_t index = indexing::index(node_hash(curr), new_bucket_count);
 
             auto temp = curr;
             curr = temp->next;
             temp->next = new_buckets_array[index];
             new_buckets_array[index] = temp;
+            new_occupied.set(index);
         }
     }
     _buckets_array = std::move(new_buckets_array);
+    _occupied = std::move(new_occupied);
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+void HashMap<K, M, H, S, A>::rehash(size_t new_bucket_count, size_t threads) {
+    if (new_bucket_count == 0) {
+        throw std::out_of_range("HashMap<K, M, H, S, A>::rehash: new_bucket_count must be positive.");
+    }
+    constexpr bool can_throw = !kCacheHash && !std::is_nothrow_invocable_v<const H&, const K&>;
+    threads = parallel_threads(threads);
+    if (can_throw || threads <= 1) {
+        bool incremental = std::exchange(_incremental_rehash, false);
+        rehash(new_bucket_count);
+        _incremental_rehash = incremental;
+        return;
+    }
+
+    migrate_buckets(_old_buckets_array.size());
+    new_bucket_count = indexing::bucket_count(new_bucket_count);
+    bucket_array_type new_buckets_array(new_bucket_count, nullptr, _buckets_array.get_allocator());
+    occupancy_bitmap new_occupied(new_bucket_count, _occupied.get_allocator());
+    threads = std::min({threads, new_bucket_count, _buckets_array.size()});
+
+    size_t old_bucket_count = _buckets_array.size();
+    if (new_bucket_count % old_bucket_count == 0) {
+        // Growing by a whole factor, every indexing policy sends old bucket i only to new
+        // buckets that no other old bucket's nodes go to (i mod the old count for modulo and
+        // mask, the ones starting with i's bits for fibonacci). So threads with their own
+        // old buckets can link straight into the new array, in one pass.
+        run_on_threads(threads, [&](size_t t) {
+            for (size_t i = t * old_bucket_count / threads; i < (t + 1) * old_bucket_count / threads; ++i) {
+                for (node* curr = _buckets_array[i]; curr != nullptr; ) {
+                    size_t index = indexing::index(node_hash(curr), new_bucket_count);
+                    node* temp = curr;
+                    curr = temp->next;
+                    temp->next = new_buckets_array[index];
+                    new_buckets_array[index] = temp;
+                }
+            }
+        });
+        _buckets_array = std::move(new_buckets_array);
+        _occupied = std::move(new_occupied);
+        rebuild_occupied(threads); // neighbouring buckets share words, so set the bits afterwards
+        return;
+    }
+
+    // partial[t * threads + r] holds the nodes thread t found that belong in slice r of the new buckets
+    std::vector<node*> partial(threads * threads, nullptr);
+    auto slice_of = [&](size_t index) { return index * threads / new_bucket_count; };
+
+    run_on_threads(threads, [&](size_t t) {
+        node** chains = &partial[t * threads];
+        for (size_t i = t * old_bucket_count / threads; i < (t + 1) * old_bucket_count / threads; ++i) {
+            for (node* curr = _buckets_array[i]; curr != nullptr; ) {
+                node* temp = curr;
+                curr = temp->next;
+                node*& chain = chains[slice_of(indexing::index(node_hash(temp), new_bucket_count))];
+                temp->next = chain;
+                chain = temp;
+            }
+        }
+    });
+    run_on_threads(threads, [&](size_t r) {
+        for (size_t t = 0; t < threads; ++t) {
+            for (node* curr = partial[t * threads + r]; curr != nullptr; ) {
+                size_t index = indexing::index(node_hash(curr), new_bucket_count);
+                node* temp = curr;
+                curr = temp->next;
+                temp->next = new_buckets_array[index];
+                new_buckets_array[index] = temp;
+            }
+        }
+    });
+    _buckets_array = std::move(new_buckets_array);
+    _occupied = std::move(new_occupied);
+    rebuild_occupied(threads);
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename Fn>
+void HashMap<K, M, H, S, A>::run_on_threads(size_t threads, const Fn& fn) {
+    std::exception_ptr error;
+    std::atomic<bool> failed = false;
+    auto call = [&](size_t t) {
+        try {
+            fn(t);
+        } catch (...) {
+            if (!failed.exchange(true)) error = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (size_t t = 1; t < threads; ++t) {
+        try {
+            pool.emplace_back(call, t);
+        } catch (const std::system_error&) {
+            call(t);
+        }
+    }
+    call(0);
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+size_t HashMap<K, M, H, S, A>::parallel_threads(size_t threads) const noexcept {
+    size_t limit = std::max<size_t>(_size / kParallelMin, 1);
+    size_t hardware = std::thread::hardware_concurrency(); // 0 if it can't tell
+    if (hardware != 0) limit = std::min(limit, hardware);
+    return std::clamp<size_t>(threads, 1, limit);
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+std::vector<typename HashMap<K, M, H, S, A>::bucket_range>
+HashMap<K, M, H, S, A>::bucket_ranges(size_t parts) {
+    size_t buckets = bucket_end();
+    parts = std::min(std::max<size_t>(parts, 1), buckets);
+    std::vector<bucket_range> ranges;
+    ranges.reserve(parts);
+    for (size_t i = 0; i < parts; ++i) {
+        ranges.push_back(bucket_range(this, i * buckets / parts, (i + 1) * buckets / parts));
+    }
+    return ranges;
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+std::vector<typename HashMap<K, M, H, S, A>::const_bucket_range>
+HashMap<K, M, H, S, A>::bucket_ranges(size_t parts) const {
+    // see static_cast/const_cast trick explained in find().
+    auto ranges = const_cast<HashMap<K, M, H, S, A>*>(this)->bucket_ranges(parts);
+    std::vector<const_bucket_range> const_ranges;
+    const_ranges.reserve(ranges.size());
+    for (const auto& range : ranges) {
+        const_ranges.push_back(const_bucket_range(range._map, range._first, range._last));
+    }
+    return const_ranges;
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename Fn>
+void HashMap<K, M, H, S, A>::parallel_for_each(Fn fn, size_t threads) {
+    auto ranges = bucket_ranges(parallel_threads(threads));
+    run_on_threads(ranges.size(), [&](size_t t) {
+        for (auto& value : ranges[t]) {
+            fn(value);
+        }
+    });
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename Fn>
+void HashMap<K, M, H, S, A>::parallel_for_each(Fn fn, size_t threads) const {
+    auto ranges = bucket_ranges(parallel_threads(threads));
+    run_on_threads(ranges.size(), [&](size_t t) {
+        for (const auto& value : ranges[t]) {
+            fn(value);
+        }
+    });
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename T, typename MapFn, typename CombineFn>
+T HashMap<K, M, H, S, A>::parallel_reduce(T init, MapFn map_fn, CombineFn combine_fn, size_t threads) const {
+    auto ranges = bucket_ranges(parallel_threads(threads));
+    // each range starts from its first element rather than from init, so init is used once
+    std::vector<std::optional<T>> partial(ranges.size());
+    run_on_threads(ranges.size(), [&](size_t t) {
+        auto iter = ranges[t].begin();
+        auto last = ranges[t].end();
+        if (iter == last) return;
+        T result(map_fn(*iter));
+        for (++iter; iter != last; ++iter) {
+            result = combine_fn(std::move(result), map_fn(*iter));
+        }
+        partial[t].emplace(std::move(result));
+    });
+    for (auto& result : partial) {
+        if (result) init = combine_fn(std::move(init), std::move(*result));
+    }
+    return init;
 }
 
 /* begin student code */
@@ -242,14 +983,20 @@ std::vector<node*> new_buckets_array(new_bucket_count);
  *
  * Complexity: O(N), where N = std::distance(first, last);
  */
-template <typename K, typename M, typename H>
+template <typename K, typename M, typename H, typename S, typename A>
 template <typename InputIt>
-HashMap<K, M, H>::HashMap(InputIt first, InputIt last, size_t bucket_count, const H& hash) : HashMap(bucket_count, hash) {
-    auto iter = first;
-    while (iter != last) {
-        insert({iter->first, iter->second});
-        ++iter;
-    }
+HashMap<K, M, H, S, A>::HashMap(InputIt first, InputIt last, size_t bucket_count, const H& hash,
+    const allocator_type& alloc) : HashMap(bucket_count, hash, alloc) {
+    insert_range(first, last, false);
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename InputIt>
+HashMap<K, M, H, S, A> HashMap<K, M, H, S, A>::from_unique_range(InputIt first, InputIt last, const H& hash,
+    const allocator_type& alloc) {
+    HashMap map(kDefaultBuckets, hash, alloc);
+    map.insert_range(first, last, true);
+    return map;
 }
 
 /*
@@ -270,14 +1017,15 @@ HashMap<K, M, H>::HashMap(InputIt first, InputIt last, size_t bucket_count, cons
  *
  * Also, you should check out the delegating constructor note in the .cpp file.
  */
-template <typename K, typename M, typename H>
-HashMap<K, M, H>::HashMap(std::initializer_list<value_type> init, size_t bucket_count, const H& hash) : HashMap(init.begin(), init.end(), bucket_count, hash){}
+template <typename K, typename M, typename H, typename S, typename A>
+HashMap<K, M, H, S, A>::HashMap(std::initializer_list<value_type> init, size_t bucket_count, const H& hash,
+    const allocator_type& alloc) : HashMap(init.begin(), init.end(), bucket_count, hash, alloc){}
 
 
 // Milestone 3 (required) - operator overloading
 // The function headers are provided for you.
-template <typename K, typename M, typename H>
-M& HashMap<K, M, H>::operator[](const K& key) {
+template <typename K, typename M, typename H, typename S, typename A>
+M& HashMap<K, M, H, S, A>::operator[](const K& key) {
     /*
      * The following code is returning a reference to memory that is on the stack.
      * This is a very common mistake, do not make the same mistake!
@@ -287,11 +1035,23 @@ M& HashMap<K, M, H>::operator[](const K& key) {
      */
     // complete the function implementation (1 line of code)
     // isn't it funny how the bad starter code is longer than the correct answer?
-    return insert({key, {}}).first->second;
+    return try_emplace(key).first->second;
 }
 
-template <typename K, typename M, typename H>
-bool operator==(const HashMap<K, M, H>& lhs, const HashMap<K, M, H>& rhs) {
+template <typename K, typename M, typename H, typename S, typename A>
+M& HashMap<K, M, H, S, A>::operator[](K&& key) {
+    return try_emplace(std::move(key)).first->second;
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+template <typename KeyLike, typename>
+M& HashMap<K, M, H, S, A>::operator[](const KeyLike& key) {
+    // look up key as it is, so the K is only built when a new element is inserted
+    return emplace_key(key, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple()).first->second;
+}
+
+template <typename K, typename M, typename H, typename S, typename A>
+bool operator==(const HashMap<K, M, H, S, A>& lhs, const HashMap<K, M, H, S, A>& rhs) {
     // complete the function implementation (~4-5 lines of code)
     if (lhs.size() != rhs.size()) return false;
     for (const auto& [key, value] : lhs) {
@@ -301,14 +1061,14 @@ bool operator==(const HashMap<K, M, H>& lhs, const HashMap<K, M, H>& rhs) {
     return true;
 }
 
-template <typename K, typename M, typename H>
-bool operator!=(const HashMap<K, M, H>& lhs, const HashMap<K, M, H>& rhs) {
+template <typename K, typename M, typename H, typename S, typename A>
+bool operator!=(const HashMap<K, M, H, S, A>& lhs, const HashMap<K, M, H, S, A>& rhs) {
     // complete the function implementation (1 line of code)
     return !(lhs==rhs);
 }
 
-template <typename K, typename M, typename H>
-std::ostream& operator<<(std::ostream& os, const HashMap<K, M, H>& rhs) {
+template <typename K, typename M, typename H, typename S, typename A>
+std::ostream& operator<<(std::ostream& os, const HashMap<K, M, H, S, A>& rhs) {
     // complete the function implementation (~7 lines of code)
     os << "{";
     auto iter = rhs.begin();
@@ -329,49 +1089,109 @@ std::ostream& operator<<(std::ostream& os, const HashMap<K, M, H>& rhs) {
 
 // provide the function headers and implementations (~35 lines of code)
 // copy constructor
-template <typename K, typename M, typename H>
-HashMap<K, M, H>::HashMap(const HashMap& rhs) : HashMap(rhs.bucket_count(), rhs._hash_function) {
-    for (auto [key, value] : rhs) {
-        insert({key, value});
-    }
+template <typename K, typename M, typename H, typename S, typename A>
+HashMap<K, M, H, S, A>::HashMap(const HashMap& rhs) : HashMap(rhs.bucket_count(), rhs._hash_function,
+    allocator_traits::select_on_container_copy_construction(rhs.get_allocator())) {
+    _max_load_factor = rhs._max_load_factor;
+    _incremental_rehash = rhs._incremental_rehash;
+    _pool.reserve(rhs._size);
+    clone_from(rhs); // the hash functions are copies, so every key belongs in the same bucket
 }
 
 // copy assignment operator
-template <typename K, typename M, typename H>
-HashMap<K, M, H>& HashMap<K, M, H>::operator=(const HashMap& rhs) {
+template <typename K, typename M, typename H, typename S, typename A>
+HashMap<K, M, H, S, A>& HashMap<K, M, H, S, A>::operator=(const HashMap& rhs) {
     if (&rhs == this) return *this;
-    clear();
-    for (auto [key, value] : rhs) {
-        insert({key, value});
+    destroy_nodes(); // the slabs stay, so the copies below reuse the old nodes' memory
+    if constexpr (allocator_traits::propagate_on_container_copy_assignment::value) {
+        if (get_allocator() != rhs.get_allocator()) {
+            // the lhs is empty, so switch its pool and buckets over to rhs's allocator. Copy
+            // assignment (not move) propagates the allocator, so copy empty arrays made with
+            // it: never rhs's own, whose node pointers the reinserting branch below would keep.
+            // the pool's move assignment keeps its own allocator unless that propagates on
+            // move assignment, so rebuild the pool in place instead (its slabs go first)
+            std::destroy_at(&_pool);
+            ::new (static_cast<void*>(&_pool)) NodePool<node, A>(rhs.get_allocator());
+            const bucket_array_type empty_buckets(rhs._buckets_array.size(), nullptr,
+                                                  rhs._buckets_array.get_allocator());
+            const occupancy_bitmap empty_bitmap(rhs._buckets_array.size(), rhs._occupied.get_allocator());
+            const bucket_array_type empty_old_buckets(rhs._old_buckets_array.get_allocator());
+            _buckets_array = empty_buckets;
+            _occupied = empty_bitmap;
+            _old_buckets_array = empty_old_buckets;
+        }
+    }
+    _max_load_factor = rhs._max_load_factor;
+    _incremental_rehash = rhs._incremental_rehash;
+
+    // Cloning rhs's buckets is only right if our hash function agrees with rhs's. Copy it if
+    // it can be assigned; a stateless one (such as a lambda without captures) always agrees.
+    if constexpr (std::is_copy_assignable_v<H> || std::is_empty_v<H>) {
+        if constexpr (std::is_copy_assignable_v<H>) {
+            _hash_function = rhs._hash_function;
+        }
+        clone_from(rhs);
+    } else {
+        _old_buckets_array.clear();
+        _old_buckets_array.shrink_to_fit();
+        _migrated = 0;
+        for (const auto& value : rhs) {
+            insert(value);
+        }
     }
     return *this;
 }
 
 // move constructor
-template <typename K, typename M, typename H>
-HashMap<K, M, H>::HashMap(HashMap&& rhs) :
+template <typename K, typename M, typename H, typename S, typename A>
+HashMap<K, M, H, S, A>::HashMap(HashMap&& rhs) :
     _size{std::move(rhs._size)},
     _hash_function{std::move(rhs._hash_function)},
-    _buckets_array{rhs.bucket_count(), nullptr} {
-    for (size_t i = 0; i < rhs.bucket_count(); i++) {
-        _buckets_array[i] = std::move(rhs._buckets_array[i]);
-        rhs._buckets_array[i] = nullptr;
-    }
+    _buckets_array{std::move(rhs._buckets_array)},
+    _occupied{std::move(rhs._occupied)},
+    _old_buckets_array{std::move(rhs._old_buckets_array)},
+    _migrated{rhs._migrated},
+    _pool{std::move(rhs._pool)},
+    _incremental_rehash{rhs._incremental_rehash},
+    _max_load_factor{rhs._max_load_factor} {
+    // steal the whole bucket array so moving is O(1) however far the map has grown,
+    // and leave rhs with one empty bucket so it stays usable
+    rhs._buckets_array.assign(1, nullptr);
+    rhs._occupied = occupancy_bitmap(1, rhs._occupied.get_allocator());
+    rhs._old_buckets_array.clear();
+    rhs._migrated = 0;
     rhs._size = 0;
 }
 
 // move assignment operator
-template <typename K, typename M, typename H>
-HashMap<K, M, H>& HashMap<K, M, H>::operator=(HashMap&& rhs) {
+template <typename K, typename M, typename H, typename S, typename A>
+HashMap<K, M, H, S, A>& HashMap<K, M, H, S, A>::operator=(HashMap&& rhs) {
     if (this != &rhs) {
         clear();
+        _max_load_factor = rhs._max_load_factor;
+        _incremental_rehash = rhs._incremental_rehash;
+        if constexpr (!allocator_traits::propagate_on_container_move_assignment::value) {
+            if (get_allocator() != rhs.get_allocator()) {
+                // rhs's nodes must go back to rhs's allocator, so move the elements into new nodes
+                _hash_function = rhs._hash_function;
+                for (auto& [key, mapped] : rhs) {
+                    try_emplace(key, std::move(mapped));
+                }
+                rhs.clear();
+                return *this;
+            }
+        }
         _size = std::move(rhs._size);
         _hash_function = std::move(rhs._hash_function);
-        _buckets_array.resize(rhs.bucket_count());
-        for (size_t i = 0; i < rhs.bucket_count(); i++) {
-            _buckets_array[i] = std::move(rhs._buckets_array[i]);
-            rhs._buckets_array[i] = nullptr;
-        }
+        _buckets_array = std::move(rhs._buckets_array);
+        _occupied = std::move(rhs._occupied);
+        _old_buckets_array = std::move(rhs._old_buckets_array);
+        _migrated = rhs._migrated;
+        _pool = std::move(rhs._pool);
+        rhs._buckets_array.assign(1, nullptr);
+        rhs._occupied = occupancy_bitmap(1, rhs._occupied.get_allocator());
+        rhs._old_buckets_array.clear();
+        rhs._migrated = 0;
         rhs._size = 0;
     }
     return *this;
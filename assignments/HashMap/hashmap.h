@@ -10,8 +10,190 @@
 #include <iomanip>              // for setw, setprecision, setfill, right
 #include <sstream>              // for istringstream
 #include "hashmap_iterator.h"
+#include "hashmap_node_pool.h"
 
 // add any other includes that are necessary
+#include <vector>               // for the bucket array
+#include <array>                // for the inline words of the occupancy bitmap
+#include <algorithm>            // for std::find_if, std::fill, std::clamp
+#include <type_traits>          // for std::is_same_v, std::enable_if_t, std::void_t
+#include <cmath>                // for std::ceil
+#include <iterator>             // for std::distance, std::iterator_traits
+#include <limits>               // for std::numeric_limits
+#include <cstdint>              // for uint64_t
+#include <memory>               // for std::allocator, std::allocator_traits, std::destroy_at
+#include <new>                  // for placement new, in copy assignment
+#include <memory_resource>      // for std::pmr::polymorphic_allocator
+#include <tuple>                // for std::forward_as_tuple
+#include <utility>              // for std::piecewise_construct, std::forward
+#include <thread>               // for std::thread, in rehash(new_buckets, threads) and parallel_*
+#include <system_error>         // for std::system_error
+#include <exception>            // for std::exception_ptr, in run_on_threads
+#include <atomic>               // for std::atomic, in run_on_threads
+#include <optional>             // for the partial results of parallel_reduce
+
+/*
+* Storage policies for HashMap, selected through its fourth template parameter.
+*
+* chained_storage     - (default) every bucket is a singly linked list of nodes, allocated from
+*                       slabs owned by the map (see hashmap_node_pool.h).
+*                       This is the layout described throughout this file.
+*                       It is basic_chained_storage<modulo_indexing>, see bucket indexing below.
+* robin_hood_storage  - every element lives directly in one flat array of slots. Collisions
+*                       are resolved by linear probing with Robin Hood displacement, so a
+*                       lookup scans neighbouring slots instead of chasing pointers.
+*                       See hashmap_robin_hood.h.
+* swiss_storage       - a flat array of slots plus one control byte per slot holding 7 bits of
+*                       the key's hash. Lookups compare 16 control bytes at a time (SSE2) and
+*                       only compare keys whose byte matches. See hashmap_swiss.h.
+* dense_storage       - the elements live in one array in insertion order, and a separate
+*                       table of 32-bit entry numbers does the hashing (like CPython's
+*                       dict). Iteration is a linear scan in insertion order, and erase
+*                       leaves tombstones that are compacted away on rebuild.
+*                       See hashmap_dense.h.
+* small_storage<N>    - dense_storage that keeps up to N elements inside the map object,
+*                       found by a linear scan, with no index table and no heap allocation.
+*                       It builds the index table once it outgrows N. See hashmap_dense.h.
+*
+* Every policy provides the same public interface and the same HashMapIterator, except
+* for incremental rehashing (see incremental_rehash) and custom allocators, which only
+* chained_storage offers. The flat policies require the default std::allocator. Only
+* chained_storage caches hash codes (see cache_hash_code).
+*
+* Usage:
+*      HashMap<std::string, int> chained;
+*      HashMap<std::string, int, std::hash<std::string>, robin_hood_storage> flat;
+*/
+struct robin_hood_storage {};
+struct swiss_storage {};
+
+/*
+* The dense storage policy, with the number of elements kept inside the map object as
+* a parameter. dense_storage keeps none of them inline.
+*/
+template <size_t InlineCapacity = 0>
+struct basic_dense_storage {};
+using dense_storage = basic_dense_storage<>;
+template <size_t N = 8>
+using small_storage = basic_dense_storage<N>;
+
+/*
+* Bucket indexing policies for the chained HashMap: how a hash code becomes a bucket index.
+* Each one rounds a requested number of buckets to a number it can index, and maps a
+* hash code to a bucket in [0, bucket_count).
+*
+* modulo_indexing     - (default) hash % bucket_count, for any bucket count. A 64-bit
+*                       division, but it uses every bit of the hash, so it is the safe
+*                       choice for weak hash functions.
+* mask_indexing       - bucket_count is a power of two, and the index is the low bits of the
+*                       hash. The fastest, but only for hash functions whose low bits are
+*                       well mixed (std::hash<int> is the identity, so keys that are all
+*                       multiples of 64 share 1/64 of the buckets).
+* fibonacci_indexing  - bucket_count is a power of two, and the index is the top bits of
+*                       hash * 2^64 / golden ratio. One multiply and a shift, and it spreads
+*                       out patterned keys that mask_indexing would pile into a few buckets.
+*
+* Usage:
+*      HashMap<int, int, std::hash<int>, basic_chained_storage<fibonacci_indexing>> map;
+*/
+struct modulo_indexing {
+    static size_t bucket_count(size_t requested) noexcept {
+        return requested;
+    }
+    static size_t index(size_t hash, size_t bucket_count) noexcept {
+        return hash % bucket_count;
+    }
+};
+
+struct mask_indexing {
+    static size_t bucket_count(size_t requested) noexcept {
+        size_t count = 1;
+        while (count < requested) count *= 2;
+        return count;
+    }
+    static size_t index(size_t hash, size_t bucket_count) noexcept {
+        return hash & (bucket_count - 1);
+    }
+};
+
+struct fibonacci_indexing {
+    static size_t bucket_count(size_t requested) noexcept {
+        return mask_indexing::bucket_count(requested);
+    }
+    static size_t index(size_t hash, size_t bucket_count) noexcept {
+        // keep the top log2(bucket_count) bits. Shifting by 63 - log2 and then by 1 more
+        // (instead of by 64 - log2 at once) avoids an undefined shift by 64 for one bucket.
+        uint64_t mixed = static_cast<uint64_t>(hash) * 11400714819323198485ull;
+        return static_cast<size_t>(mixed >> (63 - __builtin_ctzll(bucket_count)) >> 1);
+    }
+};
+
+/*
+* The chained storage policy, with the bucket indexing policy as a parameter.
+*/
+template <typename Indexing = modulo_indexing>
+struct basic_chained_storage {
+    using indexing = Indexing;
+};
+using chained_storage = basic_chained_storage<>;
+
+template <typename Storage>
+struct is_chained_storage : std::false_type {};
+
+template <typename Indexing>
+struct is_chained_storage<basic_chained_storage<Indexing>> : std::true_type {};
+
+/*
+* Heterogeneous lookup: if the hash function type declares a member type named
+* is_transparent (the same opt-in std::unordered_map uses in C++20), then find, contains,
+* at, erase and operator[] also accept any KeyLike type. The key is hashed and compared
+* with operator== as it is, without first being converted to a temporary K.
+*
+* Requirements: H must hash a KeyLike to the same value as the K it is equal to, and
+* K == KeyLike must compile. std::hash<std::string_view> and std::string are an example.
+*
+* Usage:
+*      struct string_hash {
+*          using is_transparent = void;
+*          size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+*      };
+*      HashMap<std::string, int, string_hash> map;
+*      map.contains("Avery");                      // no std::string is constructed
+*      map.find(std::string_view{line}.substr(4)); // nor here
+*/
+template <typename H, typename = void>
+struct is_transparent_hash : std::false_type {};
+
+template <typename H>
+struct is_transparent_hash<H, std::void_t<typename H::is_transparent>> : std::true_type {};
+
+/*
+* Whether the chained HashMap stores each key's full hash code in its node. With the
+* cached hash, rehash and iterator creation never call H again, erase hashes the key
+* only once, and a chain walk compares hash codes before it compares keys.
+*
+* Caching costs one size_t per node, so by default it is on except for keys that are
+* cheap to hash anyway (arithmetic, enum and pointer keys). Specialize it to choose:
+*
+* Usage:
+*      template <>
+*      struct cache_hash_code<Point, PointHash> : std::false_type {};    // don't cache
+*/
+template <typename K, typename H>
+struct cache_hash_code : std::bool_constant<!std::is_arithmetic_v<K> && !std::is_enum_v<K> &&
+                                            !std::is_pointer_v<K>> {};
+
+/*
+* Base class of the chained HashMap's node: holds the node's hash code if it is cached,
+* and is empty otherwise, so uncached nodes don't get any bigger.
+*/
+template <bool Cached>
+struct node_hash_code {};
+
+template <>
+struct node_hash_code<true> {
+    size_t hash = 0;
+};
 
 /*
 * Template class for a HashMap
@@ -19,6 +201,10 @@
 * K = key type
 * M = mapped type
 * H = hash function type used to hash a key; if not provided, defaults to std::hash<K>
+* Storage = storage policy (see above); if not provided, defaults to chained_storage
+* Allocator = allocator for the nodes and the bucket array; if not provided, defaults to
+*      std::allocator<std::pair<const K, M>>. It is rebound to the node and node* types.
+*      See pmr::HashMap below for maps that allocate from a std::pmr::memory_resource.
 *
 * Notes: When dealing with the Stanford libraries, we often call M the value
 * (and maps store key/value pairs).
@@ -38,10 +224,15 @@
 * Concept requirements:
 *      - H is function type that with function prototype size_t hash(const K& key).
 *           The const and reference are not required, but key cannot be modified in function.
+*           If H is transparent, it must also hash the other key types passed to lookups
+*           (see is_transparent_hash above).
 *      - K and M must be regular (copyable, default constructible, and equality comparable).
 */
-template <typename K, typename M, typename H = std::hash<K>>
+template <typename K, typename M, typename H = std::hash<K>, typename Storage = chained_storage,
+          typename Allocator = std::allocator<std::pair<const K, M>>>
 class HashMap {
+    static_assert(is_chained_storage<Storage>::value, "HashMap: unknown storage policy");
+
 public:
     /*
     * Alias for std::pair<const K, M>, used by the STL (such as in std::inserter)
@@ -53,6 +244,14 @@ public:
     */
     using value_type = std::pair<const K, M>;
 
+    /*
+    * Alias for the Allocator, as in all allocator-aware STL containers.
+    *
+    * Usage:
+    *      HashMap::allocator_type alloc = map.get_allocator();
+    */
+    using allocator_type = Allocator;
+
     /*
      * Alias for the iterator type. Recall that it's impossible for an external client
      * to figure out the type of this iterator (you would've never guessed what the template
@@ -85,6 +284,33 @@ public:
     friend class HashMapIterator<HashMap, false>;
     friend class HashMapIterator<HashMap, true>;
 
+    /*
+     * Aliases for a range of buckets, which can be walked like the whole map.
+     * See bucket_ranges below.
+     */
+    using bucket_range = HashMapBucketRange<HashMap, false>;
+    using const_bucket_range = HashMapBucketRange<HashMap, true>;
+    friend bucket_range;
+    friend const_bucket_range;
+
+    /*
+     * Aliases for the local iterators, which walk a single bucket. See begin(n) below.
+     */
+    using local_iterator = HashMapLocalIterator<HashMap, false>;
+    using const_local_iterator = HashMapLocalIterator<HashMap, true>;
+    friend local_iterator;
+    friend const_local_iterator;
+
+    /*
+    * Enables the KeyLike overloads of find, contains, at, erase and operator[] only if H is
+    * transparent (see is_transparent_hash), and never for iterators, so erase(pos) still
+    * erases pos.
+    */
+    template <typename KeyLike>
+    using if_transparent = std::enable_if_t<is_transparent_hash<H>::value &&
+                                            !std::is_convertible_v<const KeyLike&, iterator> &&
+                                            !std::is_convertible_v<const KeyLike&, const_iterator>>;
+
     /*
     * Default constructor
     * Creates an empty HashMap with default number of buckets and hash function.
@@ -116,8 +342,24 @@ public:
     *
     * HashMap<int, int> map(1.0);  // double -> int conversion not allowed.
     * HashMap<int, int> map = 1;   // copy-initialization, does not compile.
+    *
+    * With mask_indexing or fibonacci_indexing, bucket_count is rounded up to a power of two.
+    *
+    * Every constructor also takes an optional allocator as its last parameter, which
+    * the map uses for all of its nodes and buckets.
+    */
+    explicit HashMap(size_t bucket_count, const H& hash = H(), const allocator_type& alloc = allocator_type());
+
+    /*
+    * Constructor with only an allocator: default number of buckets and hash function.
+    *
+    * Usage:
+    *      std::pmr::monotonic_buffer_resource arena;
+    *      pmr::HashMap<int, int> map(&arena);
+    *
+    * Complexity: O(B), B = number of buckets
     */
-    explicit HashMap(size_t bucket_count, const H& hash = H());
+    explicit HashMap(const allocator_type& alloc);
 
     /*
     * Destructor.
@@ -168,11 +410,106 @@ public:
     *
     * Complexity: O(1) (inlined because function is short)
     *
-    * Notes: our minimal implementation does not automatically rehash when the load
-    * factor is too high. If you want as an extension, you can implement automatic rehashing.
+    * Notes: insert automatically rehashes before the load factor would exceed
+    * max_load_factor(), so after any insert load_factor() <= max_load_factor().
     */
     inline float load_factor() const noexcept;
 
+    /*
+    * Returns the maximum load factor. Once an insert would push load_factor() above this
+    * value, the map grows its bucket array (see insert). Defaults to 1.0, the same as
+    * std::unordered_map.
+    *
+    * Parameters: none
+    * Return value: float
+    *
+    * Usage:
+    *      float max = map.max_load_factor();
+    *
+    * Complexity: O(1)
+    */
+    float max_load_factor() const noexcept;
+
+    /*
+    * Sets the maximum load factor. If the current load factor is above the new maximum,
+    * the map rehashes right away so the bound holds.
+    *
+    * Parameters: ml - the new maximum load factor. Must be greater than 0.
+    * Return value: none
+    *
+    * Usage:
+    *      map.max_load_factor(0.5);                                        // shorter chains, more buckets
+    *      map.max_load_factor(std::numeric_limits<float>::infinity());     // never grow automatically
+    *
+    * Exceptions: std::out_of_range if ml is not greater than 0.
+    *
+    * Complexity: O(1), or O(N) if it triggers a rehash, N = number of elements
+    */
+    void max_load_factor(float ml);
+
+    /*
+    * Makes room for at least count elements: rehashes to enough buckets that count
+    * elements fit without exceeding max_load_factor(). Never shrinks the bucket array.
+    *
+    * Parameters: count - the number of elements to make room for.
+    * Return value: none
+    *
+    * Usage:
+    *      map.reserve(1000000);   // the next million inserts never rehash
+    *
+    * Complexity: O(N) if it rehashes, O(1) otherwise, N = number of elements
+    */
+    void reserve(size_t count);
+
+    /*
+    * Returns whether rehashing is incremental. Off by default.
+    *
+    * Parameters: none
+    * Return value: bool
+    *
+    * Usage:
+    *      bool incremental = map.incremental_rehash();
+    *
+    * Complexity: O(1)
+    */
+    bool incremental_rehash() const noexcept;
+
+    /*
+    * Turns incremental rehashing on or off.
+    *
+    * When it is on, rehash (and so the automatic growth in insert) only allocates the new
+    * bucket array. The old array is kept next to it, and every later insert, find and
+    * erase(key) moves kRehashStep more old buckets into the new array. Until the old array
+    * is empty, lookups check whichever table holds the key's bucket. This spreads the O(N)
+    * cost of a rehash over many operations, so no single insert pays for all of it.
+    *
+    * Parameters: enabled - true to rehash incrementally, false to rehash all at once.
+    * Return value: none
+    *
+    * Usage:
+    *      HashMap<int, int> map;
+    *      map.incremental_rehash(true);
+    *      for (int i = 0; i < 10000000; ++i) map.insert({i, i}); // no insert moves every node
+    *
+    * Complexity: O(1), or O(N) when turning it off during a rehash, which finishes the rehash.
+    *
+    * Notes: while a rehash is in progress, insert, find and erase(key) may move nodes between
+    * the two tables, which invalidates iterators (but not references to elements, since nodes
+    * never move in memory). erase(pos) never moves nodes, so erasing while iterating is safe.
+    */
+    void incremental_rehash(bool enabled);
+
+    /*
+    * Returns whether an incremental rehash is in progress, i.e. some elements are
+    * still in the old bucket array.
+    *
+    * Usage:
+    *      if (map.rehash_in_progress()) { ... }
+    *
+    * Complexity: O(1)
+    */
+    bool rehash_in_progress() const noexcept;
+
     /*
     * Returns the number of buckets.
     *
@@ -184,8 +521,8 @@ public:
     *
     * Complexity: O(1) (inlined because function is short)
     *
-    * Notes: our minimal implementation does not automatically rehash when the load
-    * factor is too high. If you want, you can implement automatic rehashing.
+    * Notes: the number of buckets grows automatically as elements are inserted,
+    * see max_load_factor().
     *
     * What is noexcept? It's a guarantee that this function does not throw
     * exceptions, allowing the compiler to optimize this function further.
@@ -194,6 +531,71 @@ public:
     */
     inline size_t bucket_count() const noexcept;
 
+    /*
+    * Returns the largest number of buckets the map could have, as limited by the allocator.
+    *
+    * Usage:
+    *      map.rehash(std::min(wanted, map.max_bucket_count()));
+    *
+    * Complexity: O(1)
+    */
+    size_t max_bucket_count() const noexcept;
+
+    /*
+    * The bucket interface, as in std::unordered_map: bucket(key) is the bucket key is in
+    * (or would be in, if it isn't in the map), bucket_size(n) is the number of elements in
+    * bucket n, and begin(n)/end(n) are local iterators over the elements of bucket n.
+    *
+    * Parameters: key - any key, or any KeyLike if H is transparent.
+    *             n - a bucket number. Must be less than bucket_count(), or during an
+    *             incremental rehash, less than bucket_count() plus the old bucket count.
+    *
+    * Usage:
+    *      size_t hottest = 0;
+    *      for (size_t n = 0; n < map.bucket_count(); ++n) {
+    *          hottest = std::max(hottest, map.bucket_size(n));
+    *      }
+    *      for (auto iter = map.begin(map.bucket("Avery")); iter != map.end(map.bucket("Avery")); ++iter) {...}
+    *
+    * Complexity: O(1) for bucket, begin and end, O(bucket_size(n)) for bucket_size.
+    *
+    * Notes: while rehash_in_progress(), the buckets that haven't been moved yet keep their
+    * old contents, numbered from bucket_count() up as in debug(), and bucket(key) returns
+    * one of those for keys that are still there. A loop over [0, bucket_count()) then misses
+    * them; turning incremental_rehash off first finishes the rehash. Local iterators are
+    * invalidated by anything that invalidates the map's iterators.
+    */
+    size_t bucket(const K& key) const;
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    size_t bucket(const KeyLike& key) const;
+    size_t bucket_size(size_t n) const noexcept;
+    local_iterator begin(size_t n) noexcept;
+    local_iterator end(size_t n) noexcept;
+    const_local_iterator begin(size_t n) const noexcept;
+    const_local_iterator end(size_t n) const noexcept;
+
+    /*
+    * Returns a copy of the allocator the map was constructed with (or was given
+    * by an assignment that propagates allocators).
+    *
+    * Usage:
+    *      auto alloc = map.get_allocator();
+    *
+    * Complexity: O(1)
+    */
+    allocator_type get_allocator() const noexcept;
+
+    /*
+    * Returns a copy of the hash function the map uses.
+    *
+    * Usage:
+    *      auto hash = map.hash_function();
+    *      size_t code = hash(key);
+    *
+    * Complexity: O(1)
+    */
+    H hash_function() const;
+
     /*
     * Returns whether or not the HashMap contains the given key.
     *
@@ -212,6 +614,16 @@ public:
     */
     bool contains(const K& key) const noexcept;
 
+    /*
+    * Overload of contains for a key of any type KeyLike, if H is transparent.
+    *
+    * Usage:
+    *      HashMap<std::string, int, string_hash> map;    // see is_transparent_hash
+    *      if (map.contains("Avery")) { ... }             // no temporary std::string
+    */
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    bool contains(const KeyLike& key) const noexcept;
+
     /*
     * Returns a l-value reference to the mapped value given a key.
     * If no such element exists, throws exception of type std::out_of_range.
@@ -240,6 +652,14 @@ public:
     */
     const M& at(const K& key) const;
 
+    /*
+    * Overloads of at for a key of any type KeyLike, if H is transparent.
+    */
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    M& at(const KeyLike& key);
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    const M& at(const KeyLike& key) const;
+
     /*
     * Removes all K/M pairs the HashMap.
     *
@@ -254,7 +674,8 @@ public:
     * Notes: clear removes all the elements in the HashMap and frees the memory associated
     * with those elements, but the HashMap should still be in a valid state and is
     * ready to be inserted again, as if it were a newly constructed HashMap with no elements.
-    * The number of buckets should stay the same.
+    * The number of buckets should stay the same. The node slabs are freed as a whole,
+    * so clear makes one deallocation per slab rather than one per element.
     */
     void clear() noexcept;
 
@@ -296,6 +717,52 @@ public:
      */
     const_iterator find(const K& key) const;
 
+    /*
+    * Overloads of find for a key of any type KeyLike, if H is transparent.
+    *
+    * Usage:
+    *      HashMap<std::string, int, string_hash> map;    // see is_transparent_hash
+    *      auto iter = map.find(std::string_view{"Avery"});
+    */
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    iterator find(const KeyLike& key);
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    const_iterator find(const KeyLike& key) const;
+
+    /*
+    * Batched lookups: find_many writes find(key) to out for every key in [first, last), in
+    * order, and contains_many writes contains(key). They give the same answers as a loop
+    * of single lookups, only faster on a map much bigger than the cache.
+    *
+    * A single find waits for the bucket to arrive from memory, then for the node, before
+    * it can start on the next key. These work through kFindBatch keys at a time instead:
+    * hash them all and prefetch their buckets, then read the buckets and prefetch their
+    * front nodes, and only then walk the chains. The memory reads of a whole batch are
+    * in flight together rather than one after another. Tables of fewer than kFindBatchMin
+    * buckets fit in the cache, so they get a plain loop of lookups instead.
+    *
+    * Parameters: first, last - a forward range of keys, of type K (or anything find
+    *             accepts, if H is transparent). Each key is read twice.
+    *             out - where the results go: iterators (const_iterators if the map is const)
+    *             for find_many, bools for contains_many.
+    * Return value: out, advanced past the last result.
+    *
+    * Usage:
+    *      std::vector<bool> present;
+    *      map.contains_many(probe_keys.begin(), probe_keys.end(), std::back_inserter(present));
+    *
+    * Complexity: O(1) amortized average case per key, like find.
+    *
+    * Notes: like find, the non-const find_many moves kRehashStep buckets of an incremental
+    * rehash in progress, but only once per call.
+    */
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt find_many(ForwardIt first, ForwardIt last, OutputIt out);
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt find_many(ForwardIt first, ForwardIt last, OutputIt out) const;
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt contains_many(ForwardIt first, ForwardIt last, OutputIt out) const;
+
     /*
     * Inserts the K/M pair into the HashMap, if the key does not already exist.
     * If the key exists, then the operation is a no-op.
@@ -314,9 +781,83 @@ public:
     *      auto [iter2, insert2] = map.insert({3, "Anna"});  // no-op, iter2 points to {3, "Avery"}, insert2 = false
     *
     * Complexity: O(1) amortized average case
+    *
+    * Notes: if adding the element would push load_factor() above max_load_factor(), insert
+    * first rehashes to kGrowthFactor times as many buckets. Growing geometrically keeps the
+    * total rehash work over N inserts at O(N). Rehashing invalidates iterators.
     */
     std::pair<iterator, bool> insert(const value_type& value);
 
+    /*
+    * Same as above, but moves the mapped value out of value instead of copying it.
+    * (The key is const inside value_type, so it is still copied.)
+    *
+    * Usage:
+    *      std::vector<int> big(1000000);
+    *      map.insert({3, std::move(big)});    // no copy of the million ints
+    */
+    std::pair<iterator, bool> insert(value_type&& value);
+
+    /*
+    * Constructs a K/M pair in place from args, as std::pair<const K, M>(args...) would, and
+    * inserts it if its key is not in the map yet. Otherwise the pair is destroyed again.
+    *
+    * Parameters: args - forwarded to the constructor of value_type.
+    * Return value: the same as insert.
+    *
+    * Usage:
+    *      map.emplace(3, "Avery");
+    *      map.emplace(std::piecewise_construct, std::forward_as_tuple(3), std::forward_as_tuple(5, 'a'));
+    *
+    * Complexity: O(1) amortized average case
+    *
+    * Notes: the element is built directly in its node, so nothing is copied or moved. The
+    * key is only known once the element exists, so emplace builds it even if the key is
+    * already in the map. Use try_emplace when that matters.
+    */
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args);
+
+    /*
+    * If key is not in the map, inserts a K/M pair whose key is key and whose mapped value is
+    * constructed in place from args. If key is already in the map, does nothing at all:
+    * unlike emplace, neither the key nor args are touched.
+    *
+    * Parameters: key - the key, copied or moved into the map only if it is inserted.
+    *             args - forwarded to the constructor of M.
+    * Return value: the same as insert.
+    *
+    * Usage:
+    *      HashMap<std::string, std::vector<int>> map;
+    *      map.try_emplace("Avery", 1000, 0);  // inserts {"Avery", vector of 1000 zeros}
+    *      map.try_emplace("Avery", 5, 1);     // no-op, no vector is built
+    *
+    * Complexity: O(1) amortized average case
+    */
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const K& key, Args&&... args);
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(K&& key, Args&&... args);
+
+    /*
+    * Inserts {key, obj} if key is not in the map, otherwise assigns obj to key's mapped value.
+    *
+    * Parameters: key - the key, copied or moved into the map only if it is inserted.
+    *             obj - the mapped value, forwarded to M's constructor or assignment operator.
+    * Return value: pair<iterator, bool>: iterator to key's element, and true if it was
+    *      inserted, false if it was assigned.
+    *
+    * Usage:
+    *      map.insert_or_assign(3, "Avery");   // inserts {3, "Avery"}
+    *      map.insert_or_assign(3, "Anna");    // now {3, "Anna"}
+    *
+    * Complexity: O(1) amortized average case
+    */
+    template <typename Obj>
+    std::pair<iterator, bool> insert_or_assign(const K& key, Obj&& obj);
+    template <typename Obj>
+    std::pair<iterator, bool> insert_or_assign(K&& key, Obj&& obj);
+
     /*
     * Erases a K/M pair (if one exists) corresponding to given key from the HashMap.
     * This is a no-op if the key does not exist.
@@ -334,6 +875,12 @@ public:
     */
     bool erase(const K& key);
 
+    /*
+    * Overload of erase for a key of any type KeyLike, if H is transparent.
+    */
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    bool erase(const KeyLike& key);
+
     /*
     * Erases the K/M pair that pos points to.
     * Behavior is undefined if pos is not a valid and dereferencable iterator.
@@ -366,11 +913,13 @@ public:
     *
     * Complexity: O(N) amortized average case, O(N^2) worst case, N = number of elements
     *
-    * Notes: our minimal HashMap implementation does not support automatic rehashing, but
-    * std::unordered_map will automatically rehash, even if you rehash to
-    * a very small number of buckets. For this reason, std::unordered_map.rehash(0)
-    * is allowed and forces an unconditional rehash. We will not require this behavior.
-    * If you want, you could implement this.
+    * Notes: rehash uses exactly new_buckets buckets (rounded up to a power of two with
+    * mask_indexing or fibonacci_indexing), even if that puts load_factor() above
+    * max_load_factor(). The next insert will then grow the map again. If incremental_rehash()
+    * is on, rehash first finishes any rehash in progress and then only starts the new one,
+    * in O(new_buckets) time; the nodes move over during later operations. std::unordered_map
+    * instead never rehashes below size()/max_load_factor() buckets, which is why
+    * std::unordered_map.rehash(0) is allowed. We will not require this behavior.
     *
     * Previously, this function was part of the assignment. However, it's a fairly challenging
     * linked list problem, and students had a difficult time finding an elegant solution.
@@ -378,6 +927,36 @@ public:
     */
     void rehash(size_t new_buckets);
 
+    /*
+    * Like rehash(new_buckets), but moves the nodes with up to threads threads (the calling
+    * thread is one of them). Each node is moved all at once, even if incremental_rehash()
+    * is on.
+    *
+    * Parameters: new_buckets - the new number of buckets. Must be greater than 0.
+    *             threads - how many threads to use. 0 and 1 both mean just this one.
+    *
+    * Usage:
+    *      map.rehash(2 * map.bucket_count(), std::thread::hardware_concurrency());
+    *
+    * Exceptions: std::out_of_range if new_buckets = 0.
+    *
+    * Complexity: O(N + B) work, where N = size() and B = new_buckets, split evenly
+    * between the threads.
+    *
+    * Notes: no thread needs a lock. If new_buckets is a multiple of bucket_count(), the
+    * nodes of different old buckets always go to different new buckets, so thread t moves
+    * the nodes in the t-th slice of the old buckets straight into the new array. Otherwise
+    * the move takes two passes. First, thread t walks the t-th slice of the old buckets
+    * and sorts their nodes into one chain per slice of the new buckets, so each thread
+    * ends up with threads partial chains. Then thread t links the nodes in every thread's
+    * t-th partial chain into its own slice of the new buckets. Each thread gets at least
+    * kParallelMin elements, and no more threads run than std::thread::hardware_concurrency(),
+    * since relinking is bound by memory and extra threads only slow it down. Maps with
+    * fewer than 2 * kParallelMin elements, and maps whose hash function could throw while
+    * moving nodes (one that isn't noexcept, with hash codes not cached), use one thread.
+    */
+    void rehash(size_t new_buckets, size_t threads);
+
     /*
      * Returns an iterator to the first element.
      * This overload is used when the HashMap is non-const.
@@ -414,6 +993,89 @@ public:
      */
     const_iterator end() const noexcept;
 
+    /*
+    * Splits the buckets into parts contiguous ranges of about the same number of buckets.
+    * Walking every range in order visits every element once, in the same order as
+    * begin() to end(). Use it to split a loop over the map between threads yourself.
+    *
+    * Parameters: parts - how many ranges to return. 0 means 1, and there are never more
+    *             ranges than buckets.
+    *
+    * Usage:
+    *      std::vector<std::thread> pool;
+    *      for (auto range : map.bucket_ranges(4)) {
+    *          pool.emplace_back([range] {
+    *              for (auto& [key, value] : range) {...}
+    *          });
+    *      }
+    *
+    * Complexity: O(parts)
+    *
+    * Notes: the buckets are split by count, not by how many elements they hold, so the
+    * ranges are only as even as the hash function. While an incremental rehash is in
+    * progress, the buckets not yet moved come after the new ones, and land in the last
+    * ranges. Different ranges share no elements, so threads may modify mapped values in
+    * their own range, but nothing may insert, erase or rehash until they are done.
+    */
+    std::vector<bucket_range> bucket_ranges(size_t parts);
+    std::vector<const_bucket_range> bucket_ranges(size_t parts) const;
+
+    /*
+    * Calls fn(value) on every element, splitting the buckets between up to threads threads
+    * (the calling thread is one of them). fn gets a value_type&, or a const value_type&
+    * if the map is const, so it can modify mapped values.
+    *
+    * Parameters: fn - the function to call on each element. Calls on different elements
+    *             run concurrently, so fn must be safe to call from several threads.
+    *             threads - how many threads to use. 0 and 1 both mean just this one.
+    *
+    * Usage:
+    *      map.parallel_for_each([](auto& kv) { kv.second *= 2; });
+    *
+    * Exceptions: if a call to fn throws, the threads still finish their ranges and the
+    * first exception is rethrown here.
+    *
+    * Complexity: O(N + B) work, where N = size() and B = bucket_count(), split between
+    * the threads as bucket_ranges splits it.
+    *
+    * Notes: each thread gets at least kParallelMin elements, since starting threads costs
+    * more than a shorter loop, and no more threads run than std::thread::hardware_concurrency().
+    * The threads are started for each call.
+    */
+    template <typename Fn>
+    void parallel_for_each(Fn fn, size_t threads = std::thread::hardware_concurrency());
+    template <typename Fn>
+    void parallel_for_each(Fn fn, size_t threads = std::thread::hardware_concurrency()) const;
+
+    /*
+    * Returns init combined with map_fn(value) for every element. Each thread combines
+    * the results in its range of buckets, in iteration order, and then the threads'
+    * results are combined into init in range order.
+    *
+    * Parameters: init - the starting value, used exactly once.
+    *             map_fn - called as map_fn(const value_type&), returns something T can
+    *             be constructed from. Must be safe to call from several threads.
+    *             combine_fn - called as combine_fn(T, T) and returns T. Must be
+    *             associative, since the elements are grouped by range.
+    *             threads - how many threads to use, as in parallel_for_each.
+    *
+    * Usage:
+    *      long total = map.parallel_reduce(0L,
+    *                      [](const auto& kv) { return long(kv.second); },
+    *                      std::plus<>());
+    *
+    * Exceptions: as in parallel_for_each.
+    *
+    * Complexity: O(N + B) work, as in parallel_for_each, plus O(threads) combines.
+    *
+    * Notes: the grouping depends on threads and on the bucket layout, so a combine_fn that
+    * is only approximately associative (such as adding doubles) can give slightly
+    * different results for different thread counts.
+    */
+    template <typename T, typename MapFn, typename CombineFn>
+    T parallel_reduce(T init, MapFn map_fn, CombineFn combine_fn,
+                      size_t threads = std::thread::hardware_concurrency()) const;
+
     /*
     * Function that will print to std::cout the contents of the hash table as
     * linked lists, and also displays the size, number of buckets, and load factor.
@@ -449,9 +1111,32 @@ public:
      *      HashMap<char, int> map{vec.begin(), vec.end()};
      *
      * Complexity: O(N), where N = std::distance(first, last);
+     *
+     * Notes: if InputIt is at least a forward iterator, the map reserves room for all
+     * N elements up front, so it never rehashes while inserting them, and allocates all
+     * N nodes as one block. If the range has duplicate keys, the first one wins, as with insert.
+     */
+    template <typename InputIt>
+    HashMap(InputIt first, InputIt last, size_t bucket_count = kDefaultBuckets, const H& hash = H(),
+            const allocator_type& alloc = allocator_type());
+
+    /*
+     * Builds a HashMap from a range whose keys are known to be unique. Same as the range
+     * constructor, except that it doesn't check whether a key is already in the map, so
+     * each element is hashed once and linked straight into its bucket.
+     *
+     * Requirements: no two elements of [first, last) have equal keys. Otherwise the map
+     * ends up with duplicate keys, and its behavior is undefined.
+     *
+     * Usage:
+     *      std::vector<std::pair<int, std::string>> rows = load_table();  // primary keys
+     *      auto map = HashMap<int, std::string>::from_unique_range(rows.begin(), rows.end());
+     *
+     * Complexity: O(N), where N = std::distance(first, last), with no key comparisons.
      */
     template <typename InputIt>
-    HashMap(InputIt first, InputIt last, size_t bucket_count = kDefaultBuckets, const H& hash = H());
+    static HashMap from_unique_range(InputIt first, InputIt last, const H& hash = H(),
+                                     const allocator_type& alloc = allocator_type());
 
     /*
      * Initializer list constructor
@@ -471,7 +1156,8 @@ public:
      *
      * Also, you should check out the delegating constructor note in the .cpp file.
      */
-    HashMap(std::initializer_list<value_type> init, size_t bucket_count = kDefaultBuckets, const H& hash = H());
+    HashMap(std::initializer_list<value_type> init, size_t bucket_count = kDefaultBuckets, const H& hash = H(),
+            const allocator_type& alloc = allocator_type());
 
     /* Milestone 3 headers (declared for you) */
 
@@ -491,6 +1177,22 @@ public:
      */
     M& operator[](const K& key);
 
+    /*
+    * Same as above, but moves key into the map if it has to be inserted.
+    */
+    M& operator[](K&& key);
+
+    /*
+    * Overload of operator[] for a key of any type KeyLike, if H is transparent.
+    * A K is only constructed from key if key is not in the map yet.
+    *
+    * Usage:
+    *      HashMap<std::string, int, string_hash> map;    // see is_transparent_hash
+    *      ++map[std::string_view{"Avery"}];              // builds "Avery" once, on the first call
+    */
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    M& operator[](const KeyLike& key);
+
     /* Milestone 4 headers (you need to declare these) */
     // TODO: declare headers for copy constructor/assignment, move constructor/assignment
     /*
@@ -503,8 +1205,13 @@ public:
      * 		HashMap<char, int> rhs{{'a', 3}, {'b', 4}, {'c', 5}};
      * 		HashMap<char, int> map(rhs);
      *
-     * Complexity: O(N), where N = rhs.size();
+     * Complexity: O(N + B), where N = rhs.size() and B = rhs.bucket_count(). The copy has the
+     * same buckets as rhs, with every chain in the same order, so no key is hashed or compared.
+     * All N nodes come from one block.
      *
+     * Notes: the copy's allocator is std::allocator_traits<Allocator>::
+     * select_on_container_copy_construction(rhs.get_allocator()), as in the STL. For
+     * pmr::HashMap that is the default memory resource, not rhs's resource.
      */
     HashMap(const HashMap& rhs);
 
@@ -519,8 +1226,15 @@ public:
      * 		HashMap<char, int> map;
      * 		map = rhs;
      *
-     * Complexity: O(N), where N = rhs.size();
+     * Complexity: O(N + B), where N = size() + rhs.size() and B = rhs.bucket_count().
+     * Like the copy constructor, it clones rhs's buckets without hashing. The old elements
+     * are destroyed but their nodes' memory is kept, so copying a map over one of similar
+     * size needs no allocations apart from a larger bucket array.
      *
+     * Notes: the lhs takes rhs's allocator only if propagate_on_container_copy_assignment
+     * is true for Allocator. Otherwise it keeps its own. The lhs also takes a copy of rhs's
+     * hash function. If H can't be copy assigned and has state (a lambda with captures),
+     * the lhs keeps its own, and every element is inserted by hashing it instead.
      */
      HashMap& operator=(const HashMap& rhs);
 
@@ -534,8 +1248,9 @@ public:
       *		HashMap<char, int> rhs{{'a', 3}, {'b', 4}, {'c', 5}};
       *		HashMap<char, int> map(std::move(rhs)); // now rhs should be empty
       *
-      * Complexity: O(N), where N = rhs.size()
+      * Complexity: O(1). The bucket array itself is moved, and rhs is left with one empty bucket.
       *
+      * Notes: the new map takes rhs's allocator along with its nodes.
       */
       HashMap(HashMap&& rhs);
 
@@ -549,7 +1264,14 @@ public:
       * 		HashMap<char, int> map;
       * 		map = std::move(rhs); // now rhs should be empty
       *
-      * Complexity: O(N), where N = rhs.size();
+      * Complexity: O(N), where N = size() before the assignment (to clear the lhs).
+      *             The elements of rhs are not touched.
+      *
+      * Notes: the nodes of rhs can only be taken over if both maps allocate from the same
+      * place: either propagate_on_container_move_assignment is true for Allocator (the lhs
+      * then takes rhs's allocator), or the two allocators compare equal. Otherwise, such as
+      * for two pmr::HashMaps on different memory resources, every element is moved into
+      * a new node from the lhs's allocator, in O(N + rhs.size()).
       */
       HashMap& operator=(HashMap&& rhs);
 
@@ -566,7 +1288,9 @@ private:
     *      n->value = {3, 4};
     *      n->next = nullptr;
     */
-    struct node {
+    static constexpr bool kCacheHash = cache_hash_code<K, H>::value;
+
+    struct node : node_hash_code<kCacheHash> {
         value_type value;
         node* next;
 
@@ -578,6 +1302,16 @@ private:
         */
         node(const value_type& value = value_type(), node* next = nullptr) :
             value(value), next(next) {}
+
+        /*
+        * Constructs value in place from args, which are forwarded to value_type's constructor.
+        *
+        * Usage:
+        *      node* new_node = _pool.create(next_ptr, std::move(pair));
+        */
+        template <typename... Args>
+        node(node* next, Args&&... args) :
+            value(std::forward<Args>(args)...), next(next) {}
     };
 
     /*
@@ -590,6 +1324,51 @@ private:
     */
     using node_pair = std::pair<typename HashMap::node*, typename HashMap::node*>;
 
+    /*
+    * Type alias for the array of buckets, which allocates from the map's Allocator.
+    */
+    using allocator_traits = std::allocator_traits<Allocator>;
+    using bucket_array_type = std::vector<node*, typename allocator_traits::template rebind_alloc<node*>>;
+
+    /*
+    * The words of the occupancy bitmap (see _occupied), one bit per bucket. A table with
+    * at most 256 buckets keeps its words inline, so small and moved-from maps don't
+    * allocate a bitmap; larger ones keep the words in a vector from the map's allocator.
+    * Inline words past the last bucket stay zero.
+    */
+    class occupancy_bitmap {
+    public:
+        using allocator_type = typename allocator_traits::template rebind_alloc<uint64_t>;
+        static constexpr size_t kInlineWords = 4;
+
+        occupancy_bitmap(size_t bucket_count, const allocator_type& alloc) : _words(alloc) {
+            if (bucket_count > 64 * kInlineWords) _words.assign((bucket_count + 63) / 64, 0);
+        }
+
+        uint64_t* data() noexcept { return _words.empty() ? _inline.data() : _words.data(); }
+        const uint64_t* data() const noexcept { return _words.empty() ? _inline.data() : _words.data(); }
+        size_t size() const noexcept { return _words.empty() ? kInlineWords : _words.size(); }
+        allocator_type get_allocator() const noexcept { return _words.get_allocator(); }
+
+        void set(size_t bucket) noexcept { data()[bucket / 64] |= uint64_t{1} << (bucket % 64); }
+        void reset(size_t bucket) noexcept { data()[bucket / 64] &= ~(uint64_t{1} << (bucket % 64)); }
+        void clear() noexcept { std::fill(data(), data() + size(), 0); }
+
+        void assign(const occupancy_bitmap& rhs) {
+            _words.assign(rhs._words.begin(), rhs._words.end());
+            _inline = rhs._inline;
+        }
+
+    private:
+        std::vector<uint64_t, allocator_type> _words;
+        std::array<uint64_t, kInlineWords> _inline{};
+    };
+
+    /*
+    * The bucket indexing policy, see modulo_indexing.
+    */
+    using indexing = typename Storage::indexing;
+
     /*
     * Finds the node N with given key, and returns a node_pair consisting of
     * the node whose's next is N, and N. If node is not found, {nullptr, nullptr}
@@ -614,15 +1393,121 @@ private:
     *
     * Hint: on the assignment, you should NOT need to call this function.
     */
-    node_pair find_node(const K& key) const;
+    template <typename KeyLike>
+    node_pair find_node(const KeyLike& key) const;
+
+    /*
+    * Same as above, when the caller already has hash = _hash_function(key).
+    */
+    template <typename KeyLike>
+    node_pair find_node(const KeyLike& key, size_t hash) const;
 
     /*
-    * Finds the first bucket in _buckets_array that is non-empty.
+    * Looks up every key in [first, last), kFindBatch keys at a time (see find_many), or one
+    * at a time below kFindBatchMin buckets, and
+    * calls found(node, bucket) for each in order: node is the key's node, or nullptr if
+    * the key is not in the map, and bucket is the key's bucket as in bucket_index.
+    */
+    template <typename ForwardIt, typename Found>
+    void find_batched(ForwardIt first, ForwardIt last, Found found) const;
+
+    /*
+    * Inserts a new element constructed from args, unless key is already in the map. key must
+    * be equal to the key of the element args would construct, and is used to look it up
+    * before anything is constructed. insert, try_emplace and operator[] all go through this.
+    */
+    template <typename KeyLike, typename... Args>
+    std::pair<iterator, bool> emplace_key(const KeyLike& key, Args&&... args);
+
+    /*
+    * Grows the bucket array if one more element would exceed max_load_factor().
+    */
+    void grow_for_insert();
+
+    /*
+    * Links a new node constructed from args into the bucket for hash, without checking
+    * whether its key is already in the map, and returns it. hash must be its key's hash code.
+    */
+    template <typename... Args>
+    node* emplace_new(size_t hash, Args&&... args);
+
+    /*
+    * Inserts every element of [first, last), skipping the duplicate check if unique.
+    * For forward ranges, reserves buckets and nodes for all of them first.
+    */
+    template <typename InputIt>
+    void insert_range(InputIt first, InputIt last, bool unique);
+
+    /*
+    * Destroys every node but keeps the pool's slabs, so new nodes reuse the memory.
+    * Leaves the bucket arrays as they are, all empty.
+    */
+    void destroy_nodes() noexcept;
+
+    /*
+    * Makes this map's buckets (and any rehash in progress) an exact copy of rhs's, copying
+    * chains node by node in order, without hashing or comparing keys. The map must be empty
+    * and its hash function must put every key in the same bucket as rhs's.
+    */
+    void clone_from(const HashMap& rhs);
+
+    /*
+    * Finds the first non-empty bucket, counting the buckets of _old_buckets_array
+    * after those of _buckets_array (see bucket_index).
     *
     * Hint: on the assignment, you should NOT need to call this function.
     */
     size_t first_not_empty_bucket() const noexcept;
 
+    /*
+    * Returns the bucket holding keys with the given hash code. Buckets [0, bucket_count())
+    * are in _buckets_array. While an incremental rehash is in progress, keys whose old bucket
+    * has not been moved yet are still in _old_buckets_array, at index bucket_count() + their
+    * old bucket.
+    */
+    size_t bucket_index(size_t hash) const noexcept;
+
+    /*
+    * Returns the hash code of n's key: the cached one if kCacheHash, otherwise computed.
+    * store_hash caches hash in n (and does nothing if hashes aren't cached).
+    */
+    size_t node_hash(const node* n) const;
+    static void store_hash(node* n, size_t hash) noexcept;
+
+    /*
+    * Returns a reference to the front pointer of bucket (numbered as in bucket_index).
+    */
+    node*& bucket_slot(size_t bucket) noexcept;
+
+    /*
+    * Moves up to count buckets from _old_buckets_array into _buckets_array, and frees
+    * the old array once it is empty. Does nothing if no rehash is in progress.
+    */
+    void migrate_buckets(size_t count);
+
+    /*
+    * Calls fn(t) for every t in [0, threads), each on its own thread, with fn(0) on the
+    * calling thread, and returns once every call has. If a thread can't be started, its
+    * call runs on the calling thread instead. If a call throws, the first exception is
+    * rethrown once every call has returned.
+    */
+    template <typename Fn>
+    static void run_on_threads(size_t threads, const Fn& fn);
+
+    /*
+    * Returns how many threads rehash(new_buckets, threads), parallel_for_each and
+    * parallel_reduce should use when asked for threads: at least 1, at most one per
+    * kParallelMin elements, and at most std::thread::hardware_concurrency() (if known).
+    */
+    size_t parallel_threads(size_t threads) const noexcept;
+
+    /*
+    * Removes key's node from its chain without moving any buckets, so iterators to
+    * other elements stay valid. hash is key's hash code. Returns false if key is not in the map.
+    */
+    template <typename KeyLike>
+    bool unlink(const KeyLike& key, size_t hash);
+
     /*
     * Creates an iterator that points to the element curr->value.
     *
@@ -630,6 +1515,26 @@ private:
     */
     iterator make_iterator(node* curr);
 
+    /*
+    * Iterator hooks: bucket_end is one past the last bucket (both tables, see bucket_index),
+    * next_occupied returns the first non-empty bucket at or after bucket (or bucket_end()),
+    * bucket_front returns the first node in the given bucket (nullptr if the bucket is empty),
+    * and next_in_bucket returns the node after curr in its chain.
+    * HashMapIterator walks the table through these, so it works with every storage policy.
+    */
+    size_t bucket_end() const noexcept;
+    size_t next_occupied(size_t bucket) const noexcept;
+    node* bucket_front(size_t bucket) noexcept;
+    static node* next_in_bucket(node* curr) noexcept;
+
+    /*
+    * Keep _occupied in step with _buckets_array. sync_occupied updates bucket's bit after
+    * its chain changed (and ignores old buckets); rebuild_occupied recomputes every bit,
+    * splitting the words between threads threads, once _occupied is sized for the new array.
+    */
+    void sync_occupied(size_t bucket) noexcept;
+    void rebuild_occupied(size_t threads);
+
     /* Private member variables */
 
     /*
@@ -659,7 +1564,50 @@ private:
     *      node* ptr = _buckets_array[index];          // _buckets_array is array of node*
     *      const auto& [key, mapped] = ptr->value;     // each node* contains a value that is a pair
     */
-    std::vector<node*> _buckets_array;
+    bucket_array_type _buckets_array;
+
+    /*
+    * One bit per bucket of _buckets_array, set iff that bucket is non-empty, 64 buckets to
+    * a word. Iteration jumps between set bits with count-trailing-zeros, so walking a map
+    * with N elements in B buckets touches O(N + B / 64) memory rather than O(N + B).
+    *
+    * Usage:
+    *      bool occupied = _occupied.data()[index / 64] >> (index % 64) & 1;
+    */
+    occupancy_bitmap _occupied;
+
+    /*
+    * The bucket array from before an incremental rehash. Its buckets [0, _migrated) have
+    * already been moved into _buckets_array. Empty unless rehash_in_progress().
+    */
+    bucket_array_type _old_buckets_array;
+    size_t _migrated;
+
+    /*
+    * instance variable: _pool, where every node of this map is allocated.
+    * insert takes nodes from it, erase gives them back, and clear frees all of it.
+    *
+    * Usage:
+    *      node* n = _pool.create(value, next);    // instead of new node(value, next)
+    *      _pool.destroy(n);                       // instead of delete n
+    */
+    NodePool<node, Allocator> _pool;
+
+    /*
+    * instance variable: _incremental_rehash, whether rehash moves nodes incrementally.
+    */
+    bool _incremental_rehash;
+
+    /*
+    * instance variable: _max_load_factor, the load factor insert is not allowed to exceed.
+    */
+    float _max_load_factor;
+
+    /*
+    * Returns the smallest number of buckets that can hold count elements
+    * without exceeding _max_load_factor (at least 1).
+    */
+    size_t min_bucket_count(size_t count) const noexcept;
 
     /*
     * A constant for the default number of buckets for the default constructor.
@@ -667,13 +1615,57 @@ private:
     static const size_t kDefaultBuckets = 10;
 
     /*
-     * A private type alias used by the iterator class so it can traverse
-     * the buckets.
-     */
-    using bucket_array_type = decltype(_buckets_array);
+    * A constant for how much insert multiplies bucket_count() by when the map needs to grow.
+    */
+    static const size_t kGrowthFactor = 2;
+
+    /*
+    * A constant for how many old buckets each insert, find and erase(key) moves during an
+    * incremental rehash. After growing from B buckets, the next growth is at least
+    * B * max_load_factor() inserts away, so the old array is usually empty long before.
+    * If it isn't, the next rehash finishes moving it first.
+    */
+    static const size_t kRehashStep = 4;
+
+    /*
+    * A constant for how many keys find_many and contains_many look up together. Enough
+    * to keep the memory system busy, few enough that the prefetched buckets and nodes
+    * are still in the L1 cache when the batch gets to them.
+    */
+    static const size_t kFindBatch = 16;
+
+    /*
+    * A constant for the smallest bucket_count() at which find_many and contains_many
+    * batch their lookups. A smaller table stays in the cache, where a plain loop of
+    * lookups is faster than hashing and prefetching a batch ahead.
+    */
+    static const size_t kFindBatchMin = 1 << 13;
+
+    /*
+    * A constant for how many elements each thread of rehash(new_buckets, threads),
+    * parallel_for_each and parallel_reduce gets at least. Starting a thread takes about
+    * 20 us and rehashing moves a node in about 7 ns, so this gives each thread around
+    * 0.4 ms of work, well above what it costs to start.
+    */
+    static const size_t kParallelMin = 1 << 16;
 
 };
 
+/*
+* HashMap whose nodes and buckets come from a std::pmr::memory_resource, like the
+* std::pmr containers. Handy for maps that only live for one request: allocate from
+* a std::pmr::monotonic_buffer_resource and throw the whole buffer away afterwards.
+*
+* Usage:
+*      std::byte buffer[4096];
+*      std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer));
+*      pmr::HashMap<std::string, int> map(&arena);
+*/
+namespace pmr {
+    template <typename K, typename M, typename H = std::hash<K>, typename Storage = chained_storage>
+    using HashMap = ::HashMap<K, M, H, Storage, std::pmr::polymorphic_allocator<std::pair<const K, M>>>;
+}
+
 /*
 * Ask compiler to put the template implementation here.
 *
@@ -682,4 +1674,33 @@ private:
 */
 #include "hashmap.cpp"
 
+/*
+* The other storage policies are partial specializations of HashMap.
+*/
+#include "hashmap_robin_hood.h"
+#include "hashmap_swiss.h"
+#include "hashmap_dense.h"
+
+/*
+* The thread-safe variants: one map built on the chained layout, and one split into
+* independently locked HashMaps.
+*/
+#include "hashmap_concurrent.h"
+#include "hashmap_sharded.h"
+
+/*
+* Snapshots: save_snapshot writes a HashMap to a file that MappedHashMap maps and reads in place.
+*/
+#include "hashmap_snapshot.h"
+
+/*
+* A read-only map built once from a HashMap, with a minimal perfect hash.
+*/
+#include "hashmap_frozen.h"
+
+/*
+* A fixed-capacity map built by a constexpr constructor, for tables known at compile time.
+*/
+#include "hashmap_static.h"
+
 #endif // HASHMAP_H
@@ -0,0 +1,544 @@
+/*
+* Assignment 2 (extension): ConcurrentHashMap
+*
+* A thread-safe map with the same layout as the chained HashMap in hashmap.h: an array
+* of buckets, each holding a singly linked chain of nodes, and every node caching its
+* key's hash. Writers lock one of a fixed array of kStripes mutexes (lock stripes), each
+* guarding a subset of the buckets, so writers working on different stripes never wait
+* for each other. Readers take no locks at all: bucket heads and next pointers are
+* atomic, and erased nodes are freed through epoch-based reclamation (hashmap_epoch.h).
+*/
+
+#ifndef HASHMAP_CONCURRENT_H
+#define HASHMAP_CONCURRENT_H
+
+#include <algorithm>        // for std::max
+#include <array>            // for the stripe array
+#include <atomic>           // for the bucket heads, next pointers and counts
+#include <cstdint>          // for uint64_t
+#include <functional>       // for std::hash
+#include <mutex>            // for std::mutex, std::lock_guard
+#include <optional>         // for the result of find
+#include <thread>           // for std::this_thread::yield
+#include <utility>          // for std::pair, std::forward
+#include <vector>           // for the bucket array and retired lists
+#include "hashmap.h"
+#include "hashmap_epoch.h"
+#include "hashmap_node_pool.h"
+
+/*
+* Template class for a thread-safe HashMap with striped-lock writers and lock-free readers.
+*
+* Layout: the bucket count is a power of two, at least kStripes, and a key's bucket is
+* the low bits of its hash (mask_indexing). Its stripe is the low log2(kStripes) bits
+* of the same hash, so stripe i guards buckets i, i + kStripes, i + 2 * kStripes, ...
+* and a key's stripe doesn't depend on the bucket count. A writer hashes the key, locks
+* that one stripe and then works on the bucket like the chained HashMap does.
+*
+* A key never changes stripe, so its node always comes from and goes back to that
+* stripe's NodePool, and the pools need no locks of their own.
+*
+* Readers: find and contains pin the current thread in the epoch domain and walk the
+* chain with acquire loads. Writers fully build a node before publishing it with a
+* release store, and never change a published node's key or value: update swaps in an
+* updated copy of the node instead. A node a writer unlinks is retired to its stripe,
+* labelled with the epoch, and destroyed by a later writer on that stripe once no
+* reader can still see it.
+*
+* Growing: each stripe keeps its own element count on its own cache line. An insert
+* grows the map once its stripe holds more elements than the stripe has buckets (a load
+* factor of 1). Growing locks every stripe in order, so it waits for all running writers
+* and blocks new ones, then doubles the bucket count without hashing any key. Old bucket
+* i splits into new buckets i and i + n, so the new table starts out with each head
+* pointing at the first node for it in old chain i, and is published right away: a
+* reader walking a shared chain passes some nodes of the sibling bucket, but it reaches
+* every node of its own. The chains are then unzipped one link per chain at a time, with
+* an epoch grace period in between, so no reader is ever standing on a run of nodes that
+* a link is changed to skip (relativistic resizing, as in Triplett, McKenney and Walpole).
+* Readers never wait and never look twice; only the grow waits, for readers already pinned.
+*
+* There are no iterators and find returns a copy: a reference into the map could be
+* invalidated by another thread at any time. To change a value in place, use update.
+*
+* Usage:
+*      ConcurrentHashMap<std::string, int> map;
+*      // from any number of threads:
+*      map.insert({"Avery", 3});
+*      map.update("Avery", [](int& value) { ++value; });
+*      std::optional<int> value = map.find("Avery");   // 4
+*      map.erase("Avery");
+*/
+template <typename K, typename M, typename H = std::hash<K>>
+class ConcurrentHashMap {
+public:
+    using key_type = K;
+    using mapped_type = M;
+    using value_type = std::pair<const K, M>;
+
+    /*
+    * The number of lock stripes. Enough that 32 threads rarely want the same stripe,
+    * and a power of two so a key's stripe is a mask of its hash.
+    */
+    static constexpr size_t kStripes = 64;
+
+    /*
+    * Creates an empty map with at least bucket_count buckets, rounded up to a power of
+    * two and to kStripes.
+    */
+    ConcurrentHashMap();
+    explicit ConcurrentHashMap(size_t bucket_count, const H& hash = H());
+
+    /*
+    * Not copyable or movable: the mutexes can't move, and copying would have to lock
+    * every stripe of both maps.
+    */
+    ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+    ConcurrentHashMap& operator=(const ConcurrentHashMap&) = delete;
+
+    /*
+    * Destroys every element, including erased ones still waiting to be reclaimed. No
+    * other thread may be using the map.
+    */
+    ~ConcurrentHashMap();
+
+    /*
+    * Returns the number of elements. This adds up the per-stripe counts without
+    * locking, so while other threads insert or erase it is only a snapshot.
+    *
+    * Complexity: O(kStripes)
+    */
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    /*
+    * Returns the number of buckets. Locks one stripe, which is enough to keep the map
+    * from growing while it reads the count.
+    */
+    size_t bucket_count() const;
+
+    /*
+    * Inserts value if its key is not already in the map. Returns whether it was
+    * inserted; if not, the map is unchanged.
+    *
+    * Complexity: O(1) amortized. The insert that grows the map is O(N).
+    */
+    bool insert(const value_type& value);
+    bool insert(value_type&& value);
+
+    /*
+    * Returns a copy of key's mapped value, or std::nullopt if key is not in the map.
+    * Takes no locks and walks the chain once, so it never waits for a writer, even one
+    * that is growing the map.
+    *
+    * Complexity: O(1) average
+    */
+    std::optional<M> find(const K& key) const;
+    bool contains(const K& key) const;
+
+    /*
+    * Copies key's element, calls fn(mapped) on the copy's mapped value and then swaps
+    * the copy in, all while holding key's stripe. Other writers can't interleave, and a
+    * concurrent find sees the whole old value or the whole new one. Returns false,
+    * without calling fn, if key is not in the map.
+    *
+    * Usage:
+    *      map.update("Avery", [](int& count) { ++count; });    // an atomic increment
+    *
+    * Notes: fn must not use this map, since its stripe is still locked. K and M must
+    * be copy constructible.
+    */
+    template <typename Fn>
+    bool update(const K& key, Fn&& fn);
+
+    /*
+    * Removes key from the map. Returns whether it was there. The element is destroyed
+    * later, once no reader can still be looking at it.
+    *
+    * Complexity: O(1) average
+    */
+    bool erase(const K& key);
+
+    /*
+    * Removes every element. Locks every stripe, like growing the map.
+    */
+    void clear();
+
+private:
+    struct node {
+        value_type value;
+        size_t hash;
+        std::atomic<node*> next;
+
+        template <typename Value>
+        node(Value&& value, size_t hash, node* next) :
+            value(std::forward<Value>(value)), hash{hash}, next{next} { }
+    };
+
+    using table = std::vector<std::atomic<node*>>;
+
+    /*
+    * Memory that was unlinked during epoch, and is freed once the domain says so.
+    */
+    template <typename T>
+    struct retired {
+        T* ptr;
+        uint64_t epoch;
+    };
+
+    /*
+    * A mutex, the pool for the nodes in the stripe's buckets, the nodes erased from
+    * them that readers may still see, and the number of live nodes, padded to its own
+    * cache line so threads on neighbouring stripes don't slow each other down.
+    * Everything but the count only changes under the mutex; the count is atomic so
+    * size() can read it without.
+    */
+    struct alignas(64) stripe {
+        mutable std::mutex mutex;
+        NodePool<node> pool;
+        std::vector<retired<node>> retired_nodes;
+        std::atomic<size_t> size{0};
+    };
+
+    /*
+    * Locks every stripe, always in index order so two of these can't deadlock. A
+    * writer on one stripe never waits for a second one, so it can't deadlock with
+    * this either.
+    */
+    class all_stripes_lock {
+    public:
+        explicit all_stripes_lock(const ConcurrentHashMap& map) : _map{map} {
+            for (auto& s : _map._stripes) s.mutex.lock();
+        }
+        ~all_stripes_lock() {
+            for (auto& s : _map._stripes) s.mutex.unlock();
+        }
+    private:
+        const ConcurrentHashMap& _map;
+    };
+
+    /*
+    * A stripe frees its retired nodes once it has this many.
+    */
+    static constexpr size_t kReclaimBatch = 64;
+
+    stripe& stripe_for(size_t hash) const noexcept;
+    std::atomic<node*>& bucket_head(size_t hash) const noexcept;
+    std::atomic<node*>* find_link(const K& key, size_t hash) const;
+    node* find_published(const K& key, size_t hash) const;
+    template <typename Value>
+    bool insert_value(Value&& value);
+    void retire(stripe& s, node* n);
+    void reclaim(stripe& s, bool everything) noexcept;
+    void grow(size_t observed_bucket_count);
+    static void wait_for_readers() noexcept;
+
+    std::atomic<table*> _table;
+    mutable std::array<stripe, kStripes> _stripes;
+    H _hash_function;
+};
+
+template <typename K, typename M, typename H>
+ConcurrentHashMap<K, M, H>::ConcurrentHashMap() : ConcurrentHashMap{kStripes} { }
+
+template <typename K, typename M, typename H>
+ConcurrentHashMap<K, M, H>::ConcurrentHashMap(size_t bucket_count, const H& hash) :
+    _table{new table(mask_indexing::bucket_count(std::max(bucket_count, kStripes)))},
+    _hash_function{hash} {
+}
+
+template <typename K, typename M, typename H>
+ConcurrentHashMap<K, M, H>::~ConcurrentHashMap() {
+    table* buckets = _table.load(std::memory_order_relaxed);
+    for (auto& head : *buckets) {
+        for (node* curr = head.load(std::memory_order_relaxed); curr != nullptr; ) {
+            node* trash = std::exchange(curr, curr->next.load(std::memory_order_relaxed));
+            stripe_for(trash->hash).pool.destroy(trash);
+        }
+    }
+    delete buckets;
+    for (auto& s : _stripes) {
+        reclaim(s, true);
+    }
+}
+
+template <typename K, typename M, typename H>
+size_t ConcurrentHashMap<K, M, H>::size() const noexcept {
+    size_t total = 0;
+    for (const auto& s : _stripes) {
+        total += s.size.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+template <typename K, typename M, typename H>
+bool ConcurrentHashMap<K, M, H>::empty() const noexcept {
+    return size() == 0;
+}
+
+template <typename K, typename M, typename H>
+size_t ConcurrentHashMap<K, M, H>::bucket_count() const {
+    std::lock_guard lock(_stripes[0].mutex);
+    return _table.load(std::memory_order_relaxed)->size();
+}
+
+template <typename K, typename M, typename H>
+bool ConcurrentHashMap<K, M, H>::insert(const value_type& value) {
+    return insert_value(value);
+}
+
+template <typename K, typename M, typename H>
+bool ConcurrentHashMap<K, M, H>::insert(value_type&& value) {
+    return insert_value(std::move(value));
+}
+
+template <typename K, typename M, typename H>
+std::optional<M> ConcurrentHashMap<K, M, H>::find(const K& key) const {
+    size_t hash = _hash_function(key);
+    auto guard = EpochDomain::global().pin();
+    node* found = find_published(key, hash);
+    return found != nullptr ? std::optional<M>(found->value.second) : std::nullopt;
+}
+
+template <typename K, typename M, typename H>
+bool ConcurrentHashMap<K, M, H>::contains(const K& key) const {
+    size_t hash = _hash_function(key);
+    auto guard = EpochDomain::global().pin();
+    return find_published(key, hash) != nullptr;
+}
+
+template <typename K, typename M, typename H>
+template <typename Fn>
+bool ConcurrentHashMap<K, M, H>::update(const K& key, Fn&& fn) {
+    size_t hash = _hash_function(key);
+    auto& s = stripe_for(hash);
+    std::lock_guard lock(s.mutex);
+    std::atomic<node*>* link = find_link(key, hash);
+    if (link == nullptr) return false;
+
+    node* old = link->load(std::memory_order_relaxed);
+    node* copy = s.pool.create(old->value, hash, old->next.load(std::memory_order_relaxed));
+    try {
+        std::forward<Fn>(fn)(copy->value.second);
+    } catch (...) {
+        s.pool.destroy(copy);
+        throw;
+    }
+    link->store(copy, std::memory_order_release);
+    retire(s, old);
+    return true;
+}
+
+template <typename K, typename M, typename H>
+bool ConcurrentHashMap<K, M, H>::erase(const K& key) {
+    size_t hash = _hash_function(key);
+    auto& s = stripe_for(hash);
+    std::lock_guard lock(s.mutex);
+    std::atomic<node*>* link = find_link(key, hash);
+    if (link == nullptr) return false;
+
+    // the erased node keeps its next pointer, so a reader standing on it carries on
+    node* trash = link->load(std::memory_order_relaxed);
+    link->store(trash->next.load(std::memory_order_relaxed), std::memory_order_release);
+    s.size.fetch_sub(1, std::memory_order_relaxed);
+    retire(s, trash);
+    return true;
+}
+
+template <typename K, typename M, typename H>
+void ConcurrentHashMap<K, M, H>::clear() {
+    all_stripes_lock lock(*this);
+    for (auto& head : *_table.load(std::memory_order_relaxed)) {
+        node* curr = head.exchange(nullptr, std::memory_order_release);
+        while (curr != nullptr) {
+            node* trash = std::exchange(curr, curr->next.load(std::memory_order_relaxed));
+            retire(stripe_for(trash->hash), trash);
+        }
+    }
+    for (auto& s : _stripes) {
+        s.size.store(0, std::memory_order_relaxed);
+    }
+}
+
+template <typename K, typename M, typename H>
+typename ConcurrentHashMap<K, M, H>::stripe&
+ConcurrentHashMap<K, M, H>::stripe_for(size_t hash) const noexcept {
+    return _stripes[hash & (kStripes - 1)];
+}
+
+/*
+* Only valid while holding a stripe: that keeps the map from growing.
+*/
+template <typename K, typename M, typename H>
+std::atomic<typename ConcurrentHashMap<K, M, H>::node*>&
+ConcurrentHashMap<K, M, H>::bucket_head(size_t hash) const noexcept {
+    table& buckets = *_table.load(std::memory_order_relaxed);
+    return buckets[mask_indexing::index(hash, buckets.size())];
+}
+
+/*
+* Returns the link (a bucket head or a next pointer) that points to the node holding
+* key, or nullptr. The caller must hold key's stripe.
+*/
+template <typename K, typename M, typename H>
+std::atomic<typename ConcurrentHashMap<K, M, H>::node*>*
+ConcurrentHashMap<K, M, H>::find_link(const K& key, size_t hash) const {
+    std::atomic<node*>* link = &bucket_head(hash);
+    for (node* curr = link->load(std::memory_order_relaxed); curr != nullptr;
+         curr = link->load(std::memory_order_relaxed)) {
+        if (curr->hash == hash && curr->value.first == key) {
+            return link;
+        }
+        link = &curr->next;
+    }
+    return nullptr;
+}
+
+/*
+* Returns the node holding key, or nullptr, without locking. The caller must be pinned.
+* The table may be the old one of a grow in progress, or the new one with its chains
+* still zipped together; either way every node for hash is reachable from its head.
+*/
+template <typename K, typename M, typename H>
+typename ConcurrentHashMap<K, M, H>::node*
+ConcurrentHashMap<K, M, H>::find_published(const K& key, size_t hash) const {
+    const table& buckets = *_table.load(std::memory_order_acquire);
+    const auto& head = buckets[mask_indexing::index(hash, buckets.size())];
+    for (node* curr = head.load(std::memory_order_acquire); curr != nullptr;
+         curr = curr->next.load(std::memory_order_acquire)) {
+        if (curr->hash == hash && curr->value.first == key) {
+            return curr;
+        }
+    }
+    return nullptr;
+}
+
+/*
+* Inserts value unless its key is already there. Grows the map afterwards if the
+* stripe got too full.
+*/
+template <typename K, typename M, typename H>
+template <typename Value>
+bool ConcurrentHashMap<K, M, H>::insert_value(Value&& value) {
+    size_t hash = _hash_function(value.first);
+    size_t observed_bucket_count;
+    {
+        auto& s = stripe_for(hash);
+        std::lock_guard lock(s.mutex);
+        if (find_link(value.first, hash) != nullptr) {
+            return false;
+        }
+        auto& head = bucket_head(hash);
+        head.store(s.pool.create(std::forward<Value>(value), hash, head.load(std::memory_order_relaxed)),
+                   std::memory_order_release);
+        size_t stripe_size = s.size.fetch_add(1, std::memory_order_relaxed) + 1;
+        observed_bucket_count = _table.load(std::memory_order_relaxed)->size();
+        if (stripe_size <= observed_bucket_count / kStripes) {
+            return true;
+        }
+    }
+    grow(observed_bucket_count);
+    return true;
+}
+
+/*
+* Hands n, already unlinked, to its stripe to destroy later. The caller holds s.
+*/
+template <typename K, typename M, typename H>
+void ConcurrentHashMap<K, M, H>::retire(stripe& s, node* n) {
+    s.retired_nodes.push_back({n, EpochDomain::global().epoch()});
+    if (s.retired_nodes.size() >= kReclaimBatch) {
+        EpochDomain::global().try_advance();
+        reclaim(s, false);
+    }
+}
+
+/*
+* Destroys the stripe's retired nodes that no reader can see any more, or all of them
+* if everything is true. They were retired in epoch order, so those are a prefix.
+*/
+template <typename K, typename M, typename H>
+void ConcurrentHashMap<K, M, H>::reclaim(stripe& s, bool everything) noexcept {
+    auto& domain = EpochDomain::global();
+    auto first_kept = s.retired_nodes.begin();
+    while (first_kept != s.retired_nodes.end() && (everything || domain.can_free(first_kept->epoch))) {
+        s.pool.destroy(first_kept->ptr);
+        ++first_kept;
+    }
+    s.retired_nodes.erase(s.retired_nodes.begin(), first_kept);
+}
+
+/*
+* Doubles the bucket count, unless another thread already grew the map after this
+* thread saw observed_bucket_count buckets. See the class comment for how readers keep
+* finding every key; the caller must not be pinned, or waiting for readers never ends.
+*/
+template <typename K, typename M, typename H>
+void ConcurrentHashMap<K, M, H>::grow(size_t observed_bucket_count) {
+    all_stripes_lock lock(*this);
+    table* old_buckets = _table.load(std::memory_order_relaxed);
+    if (old_buckets->size() != observed_bucket_count) return;
+
+    // point each new head at the first node for it in its old chain, and publish
+    size_t new_bucket_count = 2 * observed_bucket_count;
+    auto* buckets = new table(new_bucket_count);
+    auto index_of = [&](const node* n) { return mask_indexing::index(n->hash, new_bucket_count); };
+    for (auto& old_head : *old_buckets) {
+        for (node* curr = old_head.load(std::memory_order_relaxed); curr != nullptr;
+             curr = curr->next.load(std::memory_order_relaxed)) {
+            auto& head = (*buckets)[index_of(curr)];
+            if (head.load(std::memory_order_relaxed) == nullptr) head.store(curr, std::memory_order_relaxed);
+        }
+    }
+    _table.store(buckets, std::memory_order_release);
+
+    // once no reader has the old table, its heads serve as each chain's place in the
+    // unzipping: the start of the next run of nodes that share a new bucket
+    wait_for_readers();
+    auto& cursors = *old_buckets;
+    size_t active = cursors.size();
+    while (true) {
+        bool changed = false;
+        for (size_t i = 0; i < active; ) {
+            node* last = cursors[i].load(std::memory_order_relaxed);
+            node* next = last == nullptr ? nullptr : last->next.load(std::memory_order_relaxed);
+            while (next != nullptr && index_of(next) == index_of(last)) {
+                last = std::exchange(next, next->next.load(std::memory_order_relaxed));
+            }
+            if (next == nullptr) {
+                // this chain is unzipped
+                cursors[i].store(cursors[--active].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                continue;
+            }
+            // link the end of this run past the next run, to the next node of its own bucket
+            node* skip = next;
+            while (skip != nullptr && index_of(skip) != index_of(last)) {
+                skip = skip->next.load(std::memory_order_relaxed);
+            }
+            last->next.store(skip, std::memory_order_release);
+            cursors[i].store(next, std::memory_order_relaxed);
+            changed = true;
+            ++i;
+        }
+        if (!changed) break;
+        // readers of the next run's bucket may be on this run until they finish
+        wait_for_readers();
+    }
+    delete old_buckets;
+}
+
+/*
+* Returns once every reader that was pinned when it was called has unpinned, so none
+* of them can still be standing on a link changed before the call.
+*/
+template <typename K, typename M, typename H>
+void ConcurrentHashMap<K, M, H>::wait_for_readers() noexcept {
+    // the links changed so far must be visible to anyone who pins after the epoch read
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto& domain = EpochDomain::global();
+    uint64_t start = domain.epoch();
+    while (!domain.can_free(start)) {
+        if (!domain.try_advance()) std::this_thread::yield();
+    }
+}
+
+#endif // HASHMAP_CONCURRENT_H
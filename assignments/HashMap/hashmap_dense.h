@@ -0,0 +1,1100 @@
+/*
+* Assignment 2 (extension): HashMap with the dense_storage policy
+*
+* A compact, insertion-ordered layout for HashMap, in the style of CPython's dict,
+* and small_storage<N>, the same layout with its first N elements kept inside the
+* map object. The public interface is identical to the chained HashMap in hashmap.h, so the
+* comments there apply to every member function declared below. This file only
+* documents the layout and the places where it behaves differently.
+*/
+
+#ifndef HASHMAP_DENSE_H
+#define HASHMAP_DENSE_H
+
+#include <algorithm>        // for std::max
+#include <cmath>            // for std::ceil
+#include <cstdint>          // for uint32_t, uint64_t
+#include <memory>           // for std::allocator, in small_vector
+#include <new>              // for placement new
+#include <stdexcept>        // for std::out_of_range, std::length_error
+#include <tuple>            // for std::forward_as_tuple
+#include <type_traits>      // for std::conditional_t, std::is_nothrow_move_constructible_v
+#include <utility>          // for std::piecewise_construct, std::forward
+#include <vector>           // for the entry and index arrays
+#include "hashmap.h"
+
+/*
+* A vector that keeps its first N elements in an array inside the object, and only
+* moves them to the heap once it needs room for more. It has just the operations
+* the dense HashMap uses on its entries. Moving one steals the heap array, or moves
+* the elements one by one while they are inline.
+*/
+template <typename T, size_t N>
+class small_vector {
+public:
+    small_vector() noexcept : _data{inline_data()}, _size{0}, _capacity{N} { }
+    small_vector(small_vector&& rhs) : small_vector() { take(rhs); }
+    small_vector& operator=(small_vector&& rhs) {
+        if (this != &rhs) {
+            release_storage();
+            take(rhs);
+        }
+        return *this;
+    }
+    small_vector(const small_vector&) = delete;
+    small_vector& operator=(const small_vector&) = delete;
+    ~small_vector() { release_storage(); }
+
+    size_t size() const noexcept { return _size; }
+    bool is_inline() const noexcept { return _data == inline_data(); }
+    T& operator[](size_t index) noexcept { return _data[index]; }
+    const T& operator[](size_t index) const noexcept { return _data[index]; }
+    T* begin() noexcept { return _data; }
+    T* end() noexcept { return _data + _size; }
+    const T* begin() const noexcept { return _data; }
+    const T* end() const noexcept { return _data + _size; }
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (_size == _capacity) {
+            reallocate(2 * _capacity, std::forward<Args>(args)...);
+        } else {
+            new (_data + _size) T(std::forward<Args>(args)...);
+        }
+        return _data[_size++];
+    }
+
+    void pop_back() noexcept {
+        _data[--_size].~T();
+    }
+
+    void clear() noexcept {
+        while (_size > 0) pop_back();
+    }
+
+    void reserve(size_t count) {
+        if (count > _capacity) {
+            reallocate(count);
+        }
+    }
+
+private:
+    T* inline_data() noexcept { return reinterpret_cast<T*>(_inline); }
+    const T* inline_data() const noexcept { return reinterpret_cast<const T*>(_inline); }
+
+    // destroys the elements and frees the heap array, leaving an empty inline vector
+    void release_storage() noexcept {
+        clear();
+        if (!is_inline()) {
+            std::allocator<T>().deallocate(_data, _capacity);
+        }
+        _data = inline_data();
+        _capacity = N;
+    }
+
+    /*
+    * Moves the elements to a new heap array of count slots. Given args, it first builds
+    * one more element from them just past the moved ones (without counting it in _size),
+    * before anything moves, since args may refer to one of the elements.
+    */
+    template <typename... Args>
+    void reallocate(size_t count, Args&&... args) {
+        T* data = std::allocator<T>().allocate(count);
+        try {
+            if constexpr (sizeof...(Args) > 0) new (data + _size) T(std::forward<Args>(args)...);
+        } catch (...) {
+            std::allocator<T>().deallocate(data, count);
+            throw;
+        }
+        size_t moved = 0;
+        try {
+            for (; moved < _size; ++moved) new (data + moved) T(std::move(_data[moved]));
+        } catch (...) {
+            while (moved > 0) data[--moved].~T();
+            if constexpr (sizeof...(Args) > 0) data[_size].~T();
+            std::allocator<T>().deallocate(data, count);
+            throw;
+        }
+        size_t size = _size;
+        release_storage();
+        _data = data;
+        _size = size;
+        _capacity = count;
+    }
+
+    // takes rhs's elements into this empty inline vector, leaving rhs empty
+    void take(small_vector& rhs) {
+        if (!rhs.is_inline()) {
+            _data = rhs._data;
+            _size = rhs._size;
+            _capacity = rhs._capacity;
+            rhs._data = rhs.inline_data();
+            rhs._size = 0;
+            rhs._capacity = N;
+            return;
+        }
+        for (auto& element : rhs) {
+            emplace_back(std::move(element));
+        }
+        rhs.clear();
+    }
+
+    alignas(T) unsigned char _inline[N * sizeof(T)];
+    T* _data;
+    size_t _size;
+    size_t _capacity;
+};
+
+/*
+* Template class for a HashMap using dense_storage.
+*
+* Layout: the elements live in one std::vector of entries, in insertion order, each
+* next to its key's hash code. A separate index table of 32-bit entry numbers does
+* the hashing: a key's home slot comes from Fibonacci hashing (as in robin_hood_storage),
+* and a lookup probes linearly from there, comparing the cached hash code and then
+* the key of each entry it meets, until it reaches an empty slot.
+*
+* Iterating is a linear scan of the entries, so it reads contiguous memory instead
+* of following a pointer per element, and it visits the elements in the order they
+* were inserted. The index table costs 4 bytes per slot.
+*
+* Erasing destroys the element but leaves its entry behind as a tombstone, so no
+* other element moves. Tombstones are compacted away the next time the index table
+* is rebuilt, which keeps the surviving elements in insertion order: that happens
+* when an insert runs out of room, and then at the same size if at least half of
+* the entries are tombstones.
+*
+* Differences from chained_storage:
+*      - bucket_count() is the number of index slots, a power of two (at least 8).
+*      - the table grows automatically before the entries (tombstones included)
+*        exceed max_load_factor() of the slots. The default is 3/4, and the largest
+*        allowed value is 7/8, since probing needs empty slots to stop at.
+*        rehash(n) rounds n up to a power of two that can hold size() elements.
+*      - iteration order is insertion order. Erasing a key and inserting it again
+*        moves it to the end.
+*      - insert invalidates iterators only when it rebuilds the table. Erase never
+*        moves elements, so iterators to other elements stay valid.
+*      - a map holds at most 2^32 - 2 entries.
+*
+* small_storage<N> (basic_dense_storage<N>) keeps the first N entries in an array
+* inside the map object instead of on the heap, and builds no index table for them:
+* a lookup compares the cached hash code of each entry in turn, which for a handful
+* of entries is as fast as hashing into a table. Constructing the map, and filling
+* it with up to N elements, allocates nothing. Once an insert would need an (N + 1)th
+* entry, the map moves its entries to the heap and builds the index table, and from
+* then on behaves exactly like dense_storage. The iterators walk entry positions
+* either way, and insertion order carries over. While the map is small:
+*      - bucket_count() is 0, and the bucket_count given to a constructor is ignored.
+*        reserve(count) with count > N, or rehash, builds the index table early.
+*      - erase leaves tombstones as above. An insert that finds no free inline entry
+*        compacts them away if that makes room.
+*
+* Usage:
+*      HashMap<std::string, int, std::hash<std::string>, dense_storage> map;
+*      map.insert({"Avery", 3});
+*      map.insert({"Anna", 2});
+*      for (const auto& [name, count] : map) {...}     // Avery, then Anna
+*
+*      HashMap<std::string, int, std::hash<std::string>, small_storage<4>> tiny;   // no allocation
+*/
+template <typename K, typename M, typename H, typename A, size_t N>
+class HashMap<K, M, H, basic_dense_storage<N>, A> {
+    static_assert(std::is_same_v<A, std::allocator<std::pair<const K, M>>>,
+                  "HashMap: only chained_storage supports custom allocators");
+
+public:
+    using value_type = std::pair<const K, M>;
+    using allocator_type = A;
+    using iterator = HashMapIterator<HashMap, false>;
+    using const_iterator = HashMapIterator<HashMap, true>;
+
+    friend class HashMapIterator<HashMap, false>;
+    friend class HashMapIterator<HashMap, true>;
+
+    template <typename KeyLike>
+    using if_transparent = std::enable_if_t<is_transparent_hash<H>::value &&
+                                            !std::is_convertible_v<const KeyLike&, iterator> &&
+                                            !std::is_convertible_v<const KeyLike&, const_iterator>>;
+
+    HashMap();
+    explicit HashMap(size_t bucket_count, const H& hash = H());
+
+    template <typename InputIt>
+    HashMap(InputIt first, InputIt last, size_t bucket_count = kDefaultBuckets, const H& hash = H());
+    HashMap(std::initializer_list<value_type> init, size_t bucket_count = kDefaultBuckets, const H& hash = H());
+    template <typename InputIt>
+    static HashMap from_unique_range(InputIt first, InputIt last, const H& hash = H(),
+                                     const allocator_type& alloc = allocator_type());
+
+    HashMap(const HashMap& rhs);
+    HashMap& operator=(const HashMap& rhs);
+    HashMap(HashMap&& rhs);
+    HashMap& operator=(HashMap&& rhs);
+    ~HashMap() = default;
+
+    inline size_t size() const noexcept;
+    inline bool empty() const noexcept;
+    inline float load_factor() const noexcept;
+    inline size_t bucket_count() const noexcept;
+    allocator_type get_allocator() const noexcept;
+    H hash_function() const;
+    float max_load_factor() const noexcept;
+    void max_load_factor(float ml);
+    void reserve(size_t count);
+
+    bool contains(const K& key) const noexcept;
+    M& at(const K& key);
+    const M& at(const K& key) const;
+    M& operator[](const K& key);
+    M& operator[](K&& key);
+
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    bool contains(const KeyLike& key) const noexcept;
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    M& at(const KeyLike& key);
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    const M& at(const KeyLike& key) const;
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    M& operator[](const KeyLike& key);
+
+    iterator find(const K& key);
+    const_iterator find(const K& key) const;
+    std::pair<iterator, bool> insert(const value_type& value);
+    std::pair<iterator, bool> insert(value_type&& value);
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args);
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const K& key, Args&&... args);
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(K&& key, Args&&... args);
+    template <typename Obj>
+    std::pair<iterator, bool> insert_or_assign(const K& key, Obj&& obj);
+    template <typename Obj>
+    std::pair<iterator, bool> insert_or_assign(K&& key, Obj&& obj);
+    bool erase(const K& key);
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    iterator find(const KeyLike& key);
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    const_iterator find(const KeyLike& key) const;
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    bool erase(const KeyLike& key);
+    iterator erase(const_iterator pos);
+    void clear() noexcept;
+
+    /*
+    * Rebuilds the index table with at least new_buckets slots, rounded up to a power
+    * of two and to the capacity needed for size() elements. Also compacts away every
+    * tombstone, keeping the elements in insertion order.
+    *
+    * Exceptions: std::out_of_range if new_buckets = 0.
+    */
+    void rehash(size_t new_buckets);
+
+    iterator begin() noexcept;
+    iterator end() noexcept;
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+
+    /*
+    * Prints every entry in insertion order, with the index slot that points to it.
+    */
+    void debug() const;
+
+private:
+    /*
+    * An entry either holds an element (live) or is a tombstone left by erase. The
+    * element lives in an anonymous union so tombstones don't hold a K or M. The hash
+    * code is kept so lookups can skip most wrong keys without comparing them, and so
+    * rebuilding the index never calls the hash function. Moving an entry moves its K
+    * and M, so it is noexcept when those moves are, and growing _entries can't fail
+    * half way.
+    */
+    struct entry {
+        size_t hash;
+        bool live;
+        union { value_type value; };
+
+        template <typename... Args>
+        explicit entry(size_t hash, Args&&... args) :
+            hash{hash}, live{true}, value(std::forward<Args>(args)...) {}
+        entry(entry&& rhs) noexcept(std::is_nothrow_move_constructible_v<K> &&
+                                    std::is_nothrow_move_constructible_v<M>) :
+            hash{rhs.hash}, live{rhs.live} {
+            if (live) new (&value) value_type(release(rhs.value));
+        }
+        ~entry() {
+            if (live) value.~value_type();
+        }
+
+        void destroy() noexcept {
+            value.~value_type();
+            live = false;
+        }
+    };
+
+    /*
+    * HashMapIterator treats every entry as a bucket holding at most one node,
+    * so iterating walks the entries in order.
+    */
+    using node = entry;
+
+    /*
+    * dense_storage keeps its entries in a std::vector; small_storage<N> keeps the first
+    * N of them inline.
+    */
+    using entry_vector = std::conditional_t<N == 0, std::vector<entry>, small_vector<entry, N>>;
+
+    static std::pair<K, M> release(value_type& value) {
+        return {std::move(const_cast<K&>(value.first)), std::move(value.second)};
+    }
+
+    size_t home_slot(size_t hash) const noexcept;
+    template <typename KeyLike>
+    size_t find_slot(const KeyLike& key, size_t hash) const;
+    size_t find_insert_slot(size_t hash) const noexcept;
+    size_t slot_of(size_t position) const noexcept;
+    template <typename KeyLike>
+    size_t find_entry(const KeyLike& key) const;
+    template <typename KeyLike>
+    size_t find_entry(const KeyLike& key, size_t hash) const;
+    template <typename KeyLike>
+    size_t scan(const KeyLike& key, size_t hash) const;
+    template <typename KeyLike>
+    bool erase_key(const KeyLike& key);
+    void erase_entry(size_t position);
+    void erase_slot(size_t index);
+    void compact();
+    void rebuild(size_t new_capacity);
+    size_t growth_limit(size_t capacity) const noexcept;
+    size_t entry_limit() const noexcept;
+    size_t min_capacity(size_t count) const noexcept;
+    template <typename KeyLike, typename... Args>
+    std::pair<iterator, bool> emplace_key(const KeyLike& key, Args&&... args);
+    template <typename... Args>
+    size_t emplace_new(size_t hash, Args&&... args);
+    template <typename... Args>
+    size_t append(Args&&... args);
+    iterator make_iterator(size_t position);
+
+    size_t bucket_end() const noexcept;
+    size_t next_occupied(size_t bucket) const noexcept;
+    node* bucket_front(size_t bucket) noexcept;
+    static node* next_in_bucket(node* curr) noexcept;
+
+    size_t _size;
+    H _hash_function;
+
+    /*
+    * _capacity is the number of index slots (a power of two), and _shift is
+    * 64 - log2(_capacity). Each slot is kEmpty, kDeleted (a tombstone, so probes
+    * continue past it), or the position of an entry in _entries. _entries has room
+    * for growth_limit(_capacity) entries, so appending never reallocates it between
+    * rebuilds. _capacity is 0, with no slots, while a small_storage map is small and
+    * in a moved-from map; lookups then scan the (at most N) entries.
+    */
+    size_t _capacity;
+    int _shift;
+    std::vector<uint32_t> _index;
+    entry_vector _entries;
+    float _max_load_factor;
+
+    static const size_t kDefaultBuckets = 10;
+    static constexpr size_t kMinCapacity = 8;
+    static constexpr uint32_t kEmpty = 0xFFFFFFFF;
+    static constexpr uint32_t kDeleted = 0xFFFFFFFE;
+    static constexpr float kDefaultMaxLoadFactor = 0.75f;
+    static constexpr float kMaxLoadFactor = 0.875f;
+    static constexpr uint64_t kFibonacciMultiplier = 11400714819323198485ull;
+};
+
+template <typename K, typename M, typename H, typename A, size_t N>
+HashMap<K, M, H, basic_dense_storage<N>, A>::HashMap() : HashMap{kDefaultBuckets} { }
+
+template <typename K, typename M, typename H, typename A, size_t N>
+HashMap<K, M, H, basic_dense_storage<N>, A>::HashMap(size_t bucket_count, const H& hash) :
+    _size{0},
+    _hash_function{hash},
+    _capacity{0},
+    _shift{64},
+    _max_load_factor{kDefaultMaxLoadFactor} {
+    // a small_storage map builds its index table only once it outgrows its inline entries
+    if (N == 0) {
+        rebuild(bucket_count);
+    }
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename InputIt>
+HashMap<K, M, H, basic_dense_storage<N>, A>::HashMap(InputIt first, InputIt last, size_t bucket_count, const H& hash) :
+    HashMap(bucket_count, hash) {
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+        reserve(std::distance(first, last));
+    }
+    for (auto iter = first; iter != last; ++iter) {
+        emplace_key(iter->first, *iter);
+    }
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename InputIt>
+HashMap<K, M, H, basic_dense_storage<N>, A>
+HashMap<K, M, H, basic_dense_storage<N>, A>::from_unique_range(InputIt first, InputIt last, const H& hash, const allocator_type&) {
+    HashMap map(kDefaultBuckets, hash);
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+        map.reserve(std::distance(first, last));
+    }
+    for (auto iter = first; iter != last; ++iter) {
+        map.emplace_new(map._hash_function(iter->first), *iter);
+    }
+    return map;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+HashMap<K, M, H, basic_dense_storage<N>, A>::HashMap(std::initializer_list<value_type> init, size_t bucket_count,
+    const H& hash) : HashMap(init.begin(), init.end(), bucket_count, hash) { }
+
+// the copy leaves out rhs's tombstones and indexes the cached hash codes, so nothing is rehashed
+template <typename K, typename M, typename H, typename A, size_t N>
+HashMap<K, M, H, basic_dense_storage<N>, A>::HashMap(const HashMap& rhs) :
+    _size{0},
+    _hash_function{rhs._hash_function},
+    _capacity{0},
+    _shift{64},
+    _max_load_factor{rhs._max_load_factor} {
+    if (rhs._capacity != 0) {
+        rebuild(rhs._capacity);
+    }
+    for (const auto& curr : rhs._entries) {
+        if (curr.live) {
+            append(curr.hash, curr.value);
+        }
+    }
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+HashMap<K, M, H, basic_dense_storage<N>, A>& HashMap<K, M, H, basic_dense_storage<N>, A>::operator=(const HashMap& rhs) {
+    if (&rhs != this) {
+        *this = HashMap(rhs);
+    }
+    return *this;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+HashMap<K, M, H, basic_dense_storage<N>, A>::HashMap(HashMap&& rhs) :
+    _size{rhs._size},
+    _hash_function{std::move(rhs._hash_function)},
+    _capacity{rhs._capacity},
+    _shift{rhs._shift},
+    _index{std::move(rhs._index)},
+    _entries{std::move(rhs._entries)},
+    _max_load_factor{rhs._max_load_factor} {
+    rhs._size = 0;
+    rhs._capacity = 0;
+    rhs._index.clear();
+    rhs._entries.clear();
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+HashMap<K, M, H, basic_dense_storage<N>, A>& HashMap<K, M, H, basic_dense_storage<N>, A>::operator=(HashMap&& rhs) {
+    if (this != &rhs) {
+        _size = rhs._size;
+        _hash_function = std::move(rhs._hash_function);
+        _capacity = rhs._capacity;
+        _shift = rhs._shift;
+        _index = std::move(rhs._index);
+        _entries = std::move(rhs._entries);
+        _max_load_factor = rhs._max_load_factor;
+        rhs._size = 0;
+        rhs._capacity = 0;
+        rhs._index.clear();
+        rhs._entries.clear();
+    }
+    return *this;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+inline size_t HashMap<K, M, H, basic_dense_storage<N>, A>::size() const noexcept {
+    return _size;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+inline bool HashMap<K, M, H, basic_dense_storage<N>, A>::empty() const noexcept {
+    return size() == 0;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+inline float HashMap<K, M, H, basic_dense_storage<N>, A>::load_factor() const noexcept {
+    return bucket_count() == 0 ? 0 : static_cast<float>(size())/bucket_count();
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+inline size_t HashMap<K, M, H, basic_dense_storage<N>, A>::bucket_count() const noexcept {
+    return _capacity;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+typename HashMap<K, M, H, basic_dense_storage<N>, A>::allocator_type
+HashMap<K, M, H, basic_dense_storage<N>, A>::get_allocator() const noexcept {
+    return allocator_type();
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+H HashMap<K, M, H, basic_dense_storage<N>, A>::hash_function() const {
+    return _hash_function;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+float HashMap<K, M, H, basic_dense_storage<N>, A>::max_load_factor() const noexcept {
+    return _max_load_factor;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+void HashMap<K, M, H, basic_dense_storage<N>, A>::max_load_factor(float ml) {
+    if (!(ml > 0)) {
+        throw std::out_of_range("HashMap<K, M, H, dense_storage, A>::max_load_factor: ml must be positive.");
+    }
+    _max_load_factor = std::min(ml, kMaxLoadFactor);
+    if (_capacity != 0 && _entries.size() > growth_limit(_capacity)) {
+        rebuild(min_capacity(_size));
+    }
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+void HashMap<K, M, H, basic_dense_storage<N>, A>::reserve(size_t count) {
+    // tombstones take up room until the next rebuild
+    if (_entries.size() - _size + count > entry_limit()) {
+        if (_capacity == 0 && count <= N) {
+            compact();
+        } else {
+            rebuild(std::max(_capacity, min_capacity(count)));
+        }
+    }
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+bool HashMap<K, M, H, basic_dense_storage<N>, A>::contains(const K& key) const noexcept {
+    return find_entry(key) != _entries.size();
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+M& HashMap<K, M, H, basic_dense_storage<N>, A>::at(const K& key) {
+    size_t position = find_entry(key);
+    if (position == _entries.size()) {
+        throw std::out_of_range("HashMap<K, M, H, dense_storage, A>::at: key not found");
+    }
+    return _entries[position].value.second;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+const M& HashMap<K, M, H, basic_dense_storage<N>, A>::at(const K& key) const {
+    // see static_cast/const_cast trick explained in hashmap.cpp.
+    return static_cast<const M&>(const_cast<HashMap*>(this)->at(key));
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+M& HashMap<K, M, H, basic_dense_storage<N>, A>::operator[](const K& key) {
+    return try_emplace(key).first->second;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+M& HashMap<K, M, H, basic_dense_storage<N>, A>::operator[](K&& key) {
+    return try_emplace(std::move(key)).first->second;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+typename HashMap<K, M, H, basic_dense_storage<N>, A>::iterator HashMap<K, M, H, basic_dense_storage<N>, A>::find(const K& key) {
+    return make_iterator(find_entry(key));
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+typename HashMap<K, M, H, basic_dense_storage<N>, A>::const_iterator
+HashMap<K, M, H, basic_dense_storage<N>, A>::find(const K& key) const {
+    // see static_cast/const_cast trick explained in hashmap.cpp.
+    return static_cast<const_iterator>(const_cast<HashMap*>(this)->find(key));
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+std::pair<typename HashMap<K, M, H, basic_dense_storage<N>, A>::iterator, bool>
+HashMap<K, M, H, basic_dense_storage<N>, A>::insert(const value_type& value) {
+    return emplace_key(value.first, value);
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+std::pair<typename HashMap<K, M, H, basic_dense_storage<N>, A>::iterator, bool>
+HashMap<K, M, H, basic_dense_storage<N>, A>::insert(value_type&& value) {
+    return emplace_key(value.first, std::move(value));
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename... Args>
+std::pair<typename HashMap<K, M, H, basic_dense_storage<N>, A>::iterator, bool>
+HashMap<K, M, H, basic_dense_storage<N>, A>::emplace(Args&&... args) {
+    // the key is part of the element, so build it first. Its key is copied, not moved,
+    // into the entry (it is const), so key stays valid while emplace_key moves element.
+    value_type element(std::forward<Args>(args)...);
+    return emplace_key(element.first, std::move(element));
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename... Args>
+std::pair<typename HashMap<K, M, H, basic_dense_storage<N>, A>::iterator, bool>
+HashMap<K, M, H, basic_dense_storage<N>, A>::try_emplace(const K& key, Args&&... args) {
+    return emplace_key(key, std::piecewise_construct, std::forward_as_tuple(key),
+                       std::forward_as_tuple(std::forward<Args>(args)...));
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename... Args>
+std::pair<typename HashMap<K, M, H, basic_dense_storage<N>, A>::iterator, bool>
+HashMap<K, M, H, basic_dense_storage<N>, A>::try_emplace(K&& key, Args&&... args) {
+    return emplace_key(key, std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                       std::forward_as_tuple(std::forward<Args>(args)...));
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename Obj>
+std::pair<typename HashMap<K, M, H, basic_dense_storage<N>, A>::iterator, bool>
+HashMap<K, M, H, basic_dense_storage<N>, A>::insert_or_assign(const K& key, Obj&& obj) {
+    auto result = try_emplace(key, std::forward<Obj>(obj));
+    if (!result.second) {
+        result.first->second = std::forward<Obj>(obj);
+    }
+    return result;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename Obj>
+std::pair<typename HashMap<K, M, H, basic_dense_storage<N>, A>::iterator, bool>
+HashMap<K, M, H, basic_dense_storage<N>, A>::insert_or_assign(K&& key, Obj&& obj) {
+    auto result = try_emplace(std::move(key), std::forward<Obj>(obj));
+    if (!result.second) {
+        result.first->second = std::forward<Obj>(obj);
+    }
+    return result;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename KeyLike, typename... Args>
+std::pair<typename HashMap<K, M, H, basic_dense_storage<N>, A>::iterator, bool>
+HashMap<K, M, H, basic_dense_storage<N>, A>::emplace_key(const KeyLike& key, Args&&... args) {
+    size_t hash = _hash_function(key);
+    size_t position = find_entry(key, hash);
+    if (position != _entries.size()) {
+        return {make_iterator(position), false};
+    }
+    return {make_iterator(emplace_new(hash, std::forward<Args>(args)...)), true};
+}
+
+/*
+* Inserts a new element constructed from args, whose key (with hash code hash) must not
+* be in the map yet, and returns its entry's position.
+*/
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename... Args>
+size_t HashMap<K, M, H, basic_dense_storage<N>, A>::emplace_new(size_t hash, Args&&... args) {
+    if (_entries.size() + 1 > entry_limit()) {
+        // args may refer into the entries that compacting or growing moves, as in
+        // try_emplace(key, map.at(other)), so build the new entry before making room
+        entry element(hash, std::forward<Args>(args)...);
+        size_t max_size = entry_limit();
+        if (_capacity == 0 && _size + 1 <= max_size) {
+            // a small map that still fits inline once its tombstones are gone
+            compact();
+        } else {
+            // if at least half of the entries are tombstones, compacting at the same size is enough
+            rebuild(_size + 1 <= max_size / 2 ? _capacity : std::max(2 * _capacity, min_capacity(_size + 1)));
+        }
+        return append(std::move(element));
+    }
+    return append(hash, std::forward<Args>(args)...);
+}
+
+/*
+* Adds an entry built from args (a hash code and the element's constructor arguments,
+* or a whole entry) at the end and points a free index slot at it. The caller makes
+* sure there is room. The entry is constructed first, so a throwing constructor leaves
+* the map untouched.
+*/
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename... Args>
+size_t HashMap<K, M, H, basic_dense_storage<N>, A>::append(Args&&... args) {
+    _entries.emplace_back(std::forward<Args>(args)...);
+    size_t position = _entries.size() - 1;
+    if (_capacity != 0) {
+        _index[find_insert_slot(_entries[position].hash)] = static_cast<uint32_t>(position);
+    }
+    ++_size;
+    return position;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+bool HashMap<K, M, H, basic_dense_storage<N>, A>::erase(const K& key) {
+    return erase_key(key);
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename KeyLike, typename>
+bool HashMap<K, M, H, basic_dense_storage<N>, A>::contains(const KeyLike& key) const noexcept {
+    return find_entry(key) != _entries.size();
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename KeyLike, typename>
+M& HashMap<K, M, H, basic_dense_storage<N>, A>::at(const KeyLike& key) {
+    size_t position = find_entry(key);
+    if (position == _entries.size()) {
+        throw std::out_of_range("HashMap<K, M, H, dense_storage, A>::at: key not found");
+    }
+    return _entries[position].value.second;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename KeyLike, typename>
+const M& HashMap<K, M, H, basic_dense_storage<N>, A>::at(const KeyLike& key) const {
+    // see static_cast/const_cast trick explained in hashmap.cpp.
+    return static_cast<const M&>(const_cast<HashMap*>(this)->at(key));
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename KeyLike, typename>
+M& HashMap<K, M, H, basic_dense_storage<N>, A>::operator[](const KeyLike& key) {
+    // only build a K when key is not in the map yet
+    return emplace_key(key, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple()).first->second;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename KeyLike, typename>
+typename HashMap<K, M, H, basic_dense_storage<N>, A>::iterator HashMap<K, M, H, basic_dense_storage<N>, A>::find(const KeyLike& key) {
+    return make_iterator(find_entry(key));
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename KeyLike, typename>
+typename HashMap<K, M, H, basic_dense_storage<N>, A>::const_iterator HashMap<K, M, H, basic_dense_storage<N>, A>::find(const KeyLike& key) const {
+    // see static_cast/const_cast trick explained in hashmap.cpp.
+    return static_cast<const_iterator>(const_cast<HashMap*>(this)->find(key));
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename KeyLike, typename>
+bool HashMap<K, M, H, basic_dense_storage<N>, A>::erase(const KeyLike& key) {
+    return erase_key(key);
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+typename HashMap<K, M, H, basic_dense_storage<N>, A>::iterator HashMap<K, M, H, basic_dense_storage<N>, A>::erase(const_iterator pos) {
+    erase_entry(pos._bucket);
+    return make_iterator(pos._bucket + 1);
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+void HashMap<K, M, H, basic_dense_storage<N>, A>::clear() noexcept {
+    _entries.clear();
+    std::fill(_index.begin(), _index.end(), kEmpty);
+    _size = 0;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+void HashMap<K, M, H, basic_dense_storage<N>, A>::rehash(size_t new_buckets) {
+    if (new_buckets == 0) {
+        throw std::out_of_range("HashMap<K, M, H, dense_storage, A>::rehash: new_bucket_count must be positive.");
+    }
+    rebuild(std::max(new_buckets, min_capacity(_size)));
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+typename HashMap<K, M, H, basic_dense_storage<N>, A>::iterator HashMap<K, M, H, basic_dense_storage<N>, A>::begin() noexcept {
+    return make_iterator(0);
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+typename HashMap<K, M, H, basic_dense_storage<N>, A>::iterator HashMap<K, M, H, basic_dense_storage<N>, A>::end() noexcept {
+    return make_iterator(_entries.size());
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+typename HashMap<K, M, H, basic_dense_storage<N>, A>::const_iterator HashMap<K, M, H, basic_dense_storage<N>, A>::begin() const noexcept {
+    return static_cast<const_iterator>(const_cast<HashMap*>(this)->begin());
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+typename HashMap<K, M, H, basic_dense_storage<N>, A>::const_iterator HashMap<K, M, H, basic_dense_storage<N>, A>::end() const noexcept {
+    return static_cast<const_iterator>(const_cast<HashMap*>(this)->end());
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+void HashMap<K, M, H, basic_dense_storage<N>, A>::debug() const {
+    std::cout << std::setw(30) << std::setfill('-') << '\n' << std::setfill(' ')
+          << "Printing debug information for your HashMap implementation (dense_storage)\n"
+          << "Size: " << size() << std::setw(15) << std::right
+          << "Slots: " << bucket_count() << std::setw(20) << std::right
+          << "(load factor: " << std::setprecision(2) << load_factor() << ") \n\n";
+
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        std::cout << "[" << std::setw(3) << i << "]:";
+        if (!_entries[i].live) {
+            std::cout << " (deleted)";
+        } else {
+            const auto& [key, mapped] = _entries[i].value;
+            // next line will not compile if << not supported for K or M
+            std::cout << " " << key << ":" << mapped;
+            if (_capacity != 0) {
+                std::cout << " (slot " << slot_of(i) << ")";
+            } else {
+                std::cout << " (inline)";
+            }
+        }
+        std::cout << " /" << '\n';
+    }
+    std::cout << std::setw(30) << std::setfill('-') << '\n' << std::setfill(' ');
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+size_t HashMap<K, M, H, basic_dense_storage<N>, A>::home_slot(size_t hash) const noexcept {
+    return static_cast<size_t>((static_cast<uint64_t>(hash) * kFibonacciMultiplier) >> _shift);
+}
+
+/*
+* Returns the index slot that points to key's entry, or _capacity if key is not in the map.
+* Only entries whose cached hash code equals hash have their key compared.
+*/
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename KeyLike>
+size_t HashMap<K, M, H, basic_dense_storage<N>, A>::find_slot(const KeyLike& key, size_t hash) const {
+    if (_capacity == 0) {
+        return _capacity;
+    }
+    size_t mask = _capacity - 1;
+    for (size_t index = home_slot(hash); ; index = (index + 1) & mask) {
+        uint32_t position = _index[index];
+        if (position == kEmpty) {
+            return _capacity;
+        }
+        if (position != kDeleted && _entries[position].hash == hash && _entries[position].value.first == key) {
+            return index;
+        }
+    }
+}
+
+/*
+* Returns the first empty or deleted slot on hash's probe sequence. The growth
+* policy keeps at least one slot empty, so the probe always ends.
+*/
+template <typename K, typename M, typename H, typename A, size_t N>
+size_t HashMap<K, M, H, basic_dense_storage<N>, A>::find_insert_slot(size_t hash) const noexcept {
+    size_t mask = _capacity - 1;
+    size_t index = home_slot(hash);
+    while (_index[index] != kEmpty && _index[index] != kDeleted) {
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+/*
+* Returns the index slot that points to the live entry at position.
+*/
+template <typename K, typename M, typename H, typename A, size_t N>
+size_t HashMap<K, M, H, basic_dense_storage<N>, A>::slot_of(size_t position) const noexcept {
+    size_t mask = _capacity - 1;
+    size_t index = home_slot(_entries[position].hash);
+    while (_index[index] != position) {
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+/*
+* Returns the position of key's entry, or _entries.size() if key is not in the map.
+* hash is key's hash code.
+*/
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename KeyLike>
+size_t HashMap<K, M, H, basic_dense_storage<N>, A>::find_entry(const KeyLike& key) const {
+    return find_entry(key, _hash_function(key));
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename KeyLike>
+size_t HashMap<K, M, H, basic_dense_storage<N>, A>::find_entry(const KeyLike& key, size_t hash) const {
+    if (_capacity == 0) {
+        return scan(key, hash);
+    }
+    size_t index = find_slot(key, hash);
+    return index == _capacity ? _entries.size() : _index[index];
+}
+
+/*
+* Finds key in a map with no index table by checking every entry in order, comparing
+* the cached hash code before the key. Returns the position, or _entries.size().
+*/
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename KeyLike>
+size_t HashMap<K, M, H, basic_dense_storage<N>, A>::scan(const KeyLike& key, size_t hash) const {
+    for (size_t position = 0; position < _entries.size(); ++position) {
+        const entry& curr = _entries[position];
+        if (curr.live && curr.hash == hash && curr.value.first == key) {
+            return position;
+        }
+    }
+    return _entries.size();
+}
+
+/*
+* Erases key's element, if there is one. Returns whether there was.
+*/
+template <typename K, typename M, typename H, typename A, size_t N>
+template <typename KeyLike>
+bool HashMap<K, M, H, basic_dense_storage<N>, A>::erase_key(const KeyLike& key) {
+    size_t hash = _hash_function(key);
+    if (_capacity == 0) {
+        size_t position = scan(key, hash);
+        if (position == _entries.size()) {
+            return false;
+        }
+        erase_entry(position);
+        return true;
+    }
+    size_t index = find_slot(key, hash);
+    if (index == _capacity) {
+        return false;
+    }
+    erase_slot(index);
+    return true;
+}
+
+/*
+* Erases the element at entry position. Without an index table there is no slot to clear.
+*/
+template <typename K, typename M, typename H, typename A, size_t N>
+void HashMap<K, M, H, basic_dense_storage<N>, A>::erase_entry(size_t position) {
+    if (_capacity == 0) {
+        _entries[position].destroy();
+        --_size;
+    } else {
+        erase_slot(slot_of(position));
+    }
+}
+
+/*
+* Destroys the element and leaves its entry as a tombstone. The slot can go straight
+* back to kEmpty if the next slot is empty: no probe ever continued past it.
+* Otherwise a lookup may need to continue past it, so the slot becomes kDeleted.
+*/
+template <typename K, typename M, typename H, typename A, size_t N>
+void HashMap<K, M, H, basic_dense_storage<N>, A>::erase_slot(size_t index) {
+    _entries[_index[index]].destroy();
+    _index[index] = _index[(index + 1) & (_capacity - 1)] == kEmpty ? kEmpty : kDeleted;
+    --_size;
+}
+
+/*
+* Moves the live entries to the front, keeping their order, and drops the tombstones.
+*/
+template <typename K, typename M, typename H, typename A, size_t N>
+void HashMap<K, M, H, basic_dense_storage<N>, A>::compact() {
+    size_t kept = 0;
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        if (!_entries[i].live) continue;
+        if (i != kept) {
+            new (&_entries[kept].value) value_type(release(_entries[i].value));
+            _entries[kept].hash = _entries[i].hash;
+            _entries[kept].live = true;
+            _entries[i].destroy();
+        }
+        ++kept;
+    }
+    while (_entries.size() > kept) {
+        _entries.pop_back();
+    }
+}
+
+/*
+* Compacts the entries and indexes them in a fresh table with at least new_capacity
+* slots, rounded up to a power of two. Both allocations come first, so if either
+* throws the map is left as it was.
+*/
+template <typename K, typename M, typename H, typename A, size_t N>
+void HashMap<K, M, H, basic_dense_storage<N>, A>::rebuild(size_t new_capacity) {
+    size_t capacity = kMinCapacity;
+    int shift = 61;
+    while (capacity < new_capacity || growth_limit(capacity) < _size) {
+        capacity *= 2;
+        --shift;
+    }
+    if (growth_limit(capacity) >= kDeleted) {
+        throw std::length_error("HashMap<K, M, H, dense_storage, A>::rebuild: too many elements");
+    }
+
+    _entries.reserve(growth_limit(capacity));
+    std::vector<uint32_t> index(capacity, kEmpty);
+
+    compact();
+    _capacity = capacity;
+    _shift = shift;
+    _index.swap(index);
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        _index[find_insert_slot(_entries[i].hash)] = static_cast<uint32_t>(i);
+    }
+}
+
+/*
+* Returns how many entries (tombstones included) a table with capacity slots may hold.
+*/
+template <typename K, typename M, typename H, typename A, size_t N>
+size_t HashMap<K, M, H, basic_dense_storage<N>, A>::growth_limit(size_t capacity) const noexcept {
+    return static_cast<size_t>(capacity * _max_load_factor);
+}
+
+/*
+* Returns how many entries (tombstones included) the map may hold before it must
+* rebuild: N while a small_storage map has no index table.
+*/
+template <typename K, typename M, typename H, typename A, size_t N>
+size_t HashMap<K, M, H, basic_dense_storage<N>, A>::entry_limit() const noexcept {
+    return _capacity == 0 ? N : growth_limit(_capacity);
+}
+
+/*
+* Returns the number of slots needed to hold count elements without
+* exceeding the max load factor.
+*/
+template <typename K, typename M, typename H, typename A, size_t N>
+size_t HashMap<K, M, H, basic_dense_storage<N>, A>::min_capacity(size_t count) const noexcept {
+    return static_cast<size_t>(std::ceil(count / _max_load_factor));
+}
+
+/*
+* Returns an iterator to the first element at or after entry position (end() if there is none).
+*/
+template <typename K, typename M, typename H, typename A, size_t N>
+typename HashMap<K, M, H, basic_dense_storage<N>, A>::iterator HashMap<K, M, H, basic_dense_storage<N>, A>::make_iterator(size_t position) {
+    position = next_occupied(position);
+    return {this, position < _entries.size() ? &_entries[position] : nullptr, position};
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+size_t HashMap<K, M, H, basic_dense_storage<N>, A>::bucket_end() const noexcept {
+    return _entries.size();
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+size_t HashMap<K, M, H, basic_dense_storage<N>, A>::next_occupied(size_t position) const noexcept {
+    while (position < _entries.size() && !_entries[position].live) {
+        ++position;
+    }
+    return position;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+typename HashMap<K, M, H, basic_dense_storage<N>, A>::node* HashMap<K, M, H, basic_dense_storage<N>, A>::bucket_front(size_t bucket) noexcept {
+    return _entries[bucket].live ? &_entries[bucket] : nullptr;
+}
+
+template <typename K, typename M, typename H, typename A, size_t N>
+typename HashMap<K, M, H, basic_dense_storage<N>, A>::node* HashMap<K, M, H, basic_dense_storage<N>, A>::next_in_bucket(node*) noexcept {
+    return nullptr; // an entry holds at most one element
+}
+
+#endif // HASHMAP_DENSE_H
@@ -0,0 +1,201 @@
+/*
+* Assignment 2 (extension): epoch-based memory reclamation
+*
+* Lets readers walk a data structure without locks while writers unlink parts of it.
+* A writer can't free what it unlinks right away, since a reader may still be looking
+* at it. Instead it retires the memory, labelled with the current epoch, and frees it
+* once every reader that could have seen it has finished.
+*/
+
+#ifndef HASHMAP_EPOCH_H
+#define HASHMAP_EPOCH_H
+
+#include <atomic>       // for the epoch counters
+#include <cstdint>      // for uint64_t
+#include <limits>       // for std::numeric_limits
+#include <utility>      // for std::exchange
+
+/*
+* The process-wide epoch domain.
+*
+* Every thread that reads gets a record, the first time it pins, that says whether it is
+* reading and which epoch it saw when it started. The global epoch can only move from e
+* to e + 1 once every thread that is reading has seen e. So memory unlinked during epoch
+* r can't be reachable by any reader once the epoch is r + 2: everyone reading then
+* started after it was unlinked.
+*
+* Usage:
+*      // reader
+*      {
+*          auto guard = EpochDomain::global().pin();
+*          node* curr = head.load(std::memory_order_acquire);     // safe to use until guard ends
+*      }
+*
+*      // writer, after unlinking n
+*      retired.push_back({n, EpochDomain::global().epoch()});
+*      ...
+*      EpochDomain::global().try_advance();
+*      if (EpochDomain::global().can_free(retired.front().epoch)) { ... free it ... }
+*
+* Notes: the domain only tracks epochs. Whoever retires memory keeps it in their own
+* list and frees it, so it can free it however it allocated it (such as into a
+* NodePool, under the lock that guards the pool). A thread's record is reused by a
+* later thread once it exits.
+*/
+class EpochDomain {
+    struct record;
+
+public:
+    /*
+    * A pin on the current thread's record. Pins nest: the thread stays pinned until
+    * its outermost guard is destroyed.
+    */
+    class guard {
+    public:
+        guard(const guard&) = delete;
+        guard& operator=(const guard&) = delete;
+        ~guard();
+
+    private:
+        friend class EpochDomain;
+        explicit guard(record& rec) noexcept : _rec{rec} { }
+        record& _rec;
+    };
+
+    /*
+    * Returns the domain shared by every map in the process.
+    */
+    static EpochDomain& global();
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+    ~EpochDomain();
+
+    /*
+    * Marks the current thread as reading until the returned guard is destroyed.
+    * Anything the thread reaches while pinned stays allocated until then.
+    *
+    * Complexity: O(1). The thread's first pin also looks for a free record.
+    */
+    guard pin();
+
+    /*
+    * Returns the current global epoch. Label memory with this after unlinking it.
+    */
+    uint64_t epoch() const noexcept;
+
+    /*
+    * Moves the global epoch on by one if every pinned thread has seen the current one.
+    * Returns whether it did.
+    *
+    * Complexity: O(T), where T = the number of threads that have ever pinned.
+    */
+    bool try_advance() noexcept;
+
+    /*
+    * Returns whether memory retired with retire_epoch is unreachable by every reader.
+    */
+    bool can_free(uint64_t retire_epoch) const noexcept;
+
+private:
+    static constexpr uint64_t kIdle = std::numeric_limits<uint64_t>::max();
+
+    /*
+    * One thread's record, on its own cache line since its owner writes it on every pin.
+    * Records are never freed while the domain lives, so try_advance can walk the list
+    * without locks; a record whose thread exited has in_use = false and can be taken.
+    */
+    struct alignas(64) record {
+        std::atomic<uint64_t> epoch{kIdle};     // the epoch seen by the current pin, or kIdle
+        std::atomic<bool> in_use{true};
+        size_t depth = 0;                       // nesting of guards, only used by the owner
+        record* next = nullptr;
+    };
+
+    /*
+    * Gives the record back when its thread exits.
+    */
+    struct thread_record {
+        record* rec;
+        ~thread_record() { rec->in_use.store(false, std::memory_order_release); }
+    };
+
+    EpochDomain() = default;
+    record& local();
+    record* acquire_record();
+
+    std::atomic<uint64_t> _epoch{0};
+    std::atomic<record*> _records{nullptr};
+};
+
+inline EpochDomain& EpochDomain::global() {
+    static EpochDomain domain;
+    return domain;
+}
+
+inline EpochDomain::~EpochDomain() {
+    record* curr = _records.load(std::memory_order_acquire);
+    while (curr != nullptr) {
+        delete std::exchange(curr, curr->next);
+    }
+}
+
+inline EpochDomain::guard EpochDomain::pin() {
+    record& rec = local();
+    if (rec.depth++ == 0) {
+        rec.epoch.store(_epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        // the pin must be visible to try_advance before any of this thread's reads
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+    return guard(rec);
+}
+
+inline EpochDomain::guard::~guard() {
+    if (--_rec.depth == 0) {
+        _rec.epoch.store(kIdle, std::memory_order_release);
+    }
+}
+
+inline uint64_t EpochDomain::epoch() const noexcept {
+    return _epoch.load(std::memory_order_seq_cst);
+}
+
+inline bool EpochDomain::try_advance() noexcept {
+    uint64_t current = _epoch.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (record* curr = _records.load(std::memory_order_acquire); curr != nullptr; curr = curr->next) {
+        uint64_t seen = curr->epoch.load(std::memory_order_acquire); // pairs with the unpin
+        if (seen != kIdle && seen != current) {
+            return false;
+        }
+    }
+    return _epoch.compare_exchange_strong(current, current + 1, std::memory_order_seq_cst);
+}
+
+inline bool EpochDomain::can_free(uint64_t retire_epoch) const noexcept {
+    return epoch() >= retire_epoch + 2;
+}
+
+inline EpochDomain::record& EpochDomain::local() {
+    // one record per thread: global() is the only instance
+    thread_local thread_record mine{acquire_record()};
+    return *mine.rec;
+}
+
+/*
+* Takes the record of a thread that has exited, or adds a new one to the front of the list.
+*/
+inline EpochDomain::record* EpochDomain::acquire_record() {
+    for (record* curr = _records.load(std::memory_order_acquire); curr != nullptr; curr = curr->next) {
+        bool expected = false;
+        if (curr->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            return curr;
+        }
+    }
+    record* fresh = new record;
+    fresh->next = _records.load(std::memory_order_relaxed);
+    while (!_records.compare_exchange_weak(fresh->next, fresh, std::memory_order_release)) { }
+    return fresh;
+}
+
+#endif // HASHMAP_EPOCH_H
@@ -0,0 +1,324 @@
+/*
+* Assignment 2 (extension): FrozenHashMap
+*
+* A read-only map built once from a HashMap. It finds a minimal perfect hash function
+* for the keys, one that sends each of the N keys to its own slot in [0, N), and lays
+* the elements out in one array in slot order. A lookup then never probes or follows
+* a chain: it hashes the key, reads the key's slot and compares the one key there.
+*/
+
+#ifndef HASHMAP_FROZEN_H
+#define HASHMAP_FROZEN_H
+
+#include <algorithm>        // for std::stable_sort, std::max, std::find
+#include <cstdint>          // for uint16_t, uint32_t, uint64_t
+#include <functional>       // for std::hash
+#include <stdexcept>        // for std::out_of_range, std::invalid_argument, std::length_error
+#include <utility>          // for std::pair
+#include <vector>           // for the pilot and slot arrays
+#include "hashmap.h"
+
+/*
+* Template class for a read-only map with a minimal perfect hash.
+*
+* The perfect hash is built hash-and-displace style (CHD, PTHash). Every key's hash
+* code is mixed with a seed, and the mixed code picks one of about N / 3 groups. Each
+* group gets a pilot: a number that, mixed with the code of each key in the group,
+* sends all of them to positions no other key has taken. Groups are placed largest
+* first, trying pilots 0, 1, 2, ... until one works. There are a few more positions
+* than keys (about N + N / 64), so even the last groups find free ones quickly. The
+* keys whose positions are past the last slot are then moved into the slots left free,
+* and _remap records where each went.
+*
+* So a lookup is one call to the hash function, a read of its group's pilot, a read of
+* its slot and one key compare, plus a read of _remap for about one key in 64. The
+* pilots are 2 bytes for every 3 keys (under 700 KB for a million keys), small enough
+* to stay in cache, so the slot is usually the only read that goes to memory. A miss
+* lands on some key's slot, and the compare rejects it.
+*
+* Usage:
+*      HashMap<std::string, int> counts = count_words(corpus);
+*      auto frozen = FrozenHashMap<std::string, int>::build(counts);
+*      if (frozen.contains("Avery")) std::cout << frozen.at("Avery");
+*
+* Notes: no two keys may have the same hash code, since no pilot could ever separate
+* them; build throws std::invalid_argument if they do. Elements are iterated in slot
+* order, which is unrelated to the order of the HashMap they were built from.
+*/
+template <typename K, typename M, typename H = std::hash<K>>
+class FrozenHashMap {
+public:
+    using value_type = std::pair<const K, M>;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+    using iterator = const_iterator;
+
+    /*
+    * Builds a FrozenHashMap holding a copy of every element of map, hashed with map's
+    * hash function.
+    *
+    * Complexity: O(N) expected time, and O(N) extra memory while building.
+    *
+    * Exceptions: std::invalid_argument if two keys have the same hash code.
+    */
+    template <typename S, typename A>
+    static FrozenHashMap build(const HashMap<K, M, H, S, A>& map);
+
+    /*
+    * Builds an empty map.
+    */
+    explicit FrozenHashMap(const H& hash = H());
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    /*
+    * Lookups, as for HashMap.
+    *
+    * Complexity: O(1) worst case: one hash, two array reads (three for about one key in
+    * 64) and one key compare.
+    */
+    bool contains(const K& key) const;
+    const_iterator find(const K& key) const;
+    const M& at(const K& key) const;
+
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+
+private:
+    template <typename Element>
+    bool place(const std::vector<std::pair<uint64_t, const Element*>>& keys, uint64_t seed,
+               std::vector<const Element*>& slots);
+    uint64_t mixed_code(const K& key) const;
+    size_t slot_of(uint64_t mixed) const noexcept;
+
+    static size_t position_of(uint64_t mixed, uint32_t pilot, size_t positions) noexcept;
+
+    static uint64_t mix(uint64_t x) noexcept;
+    static size_t reduce(uint64_t x, size_t range) noexcept;
+
+    /*
+    * _pilots[g] is group g's pilot. _slots holds the elements in slot order. Positions
+    * run from 0 to _slots.size() + _remap.size(); the key at position p >= _slots.size()
+    * lives in slot _remap[p - _slots.size()]. _seed is mixed into every hash code;
+    * build tries another one if some group finds no pilot.
+    */
+    std::vector<uint16_t> _pilots;
+    std::vector<value_type> _slots;
+    std::vector<uint32_t> _remap;
+    uint64_t _seed = 0;
+    H _hash_function;
+
+    static constexpr size_t kMaxSize = 0x80000000;
+    static constexpr uint32_t kMaxPilot = 1 << 16;
+    static constexpr size_t kKeysPerGroup = 3;
+    static constexpr size_t kSpareDivisor = 64;
+    static constexpr uint64_t kFibonacciMultiplier = 11400714819323198485ull;
+};
+
+template <typename K, typename M, typename H>
+FrozenHashMap<K, M, H>::FrozenHashMap(const H& hash) : _hash_function{hash} { }
+
+template <typename K, typename M, typename H>
+template <typename S, typename A>
+FrozenHashMap<K, M, H> FrozenHashMap<K, M, H>::build(const HashMap<K, M, H, S, A>& map) {
+    using element = typename HashMap<K, M, H, S, A>::value_type;
+    if (map.size() >= kMaxSize) {
+        throw std::length_error("FrozenHashMap::build: too many elements");
+    }
+
+    FrozenHashMap frozen(map.hash_function());
+    std::vector<std::pair<uint64_t, const element*>> keys;
+    keys.reserve(map.size());
+    for (const auto& curr : map) {
+        keys.push_back({frozen._hash_function(curr.first), &curr});
+    }
+    std::vector<const element*> slots;
+    for (uint64_t seed = 0; !frozen.place(keys, seed, slots); ++seed) { }
+
+    frozen._slots.reserve(slots.size());
+    for (const auto* curr : slots) {
+        frozen._slots.emplace_back(*curr);
+    }
+    return frozen;
+}
+
+template <typename K, typename M, typename H>
+size_t FrozenHashMap<K, M, H>::size() const noexcept {
+    return _slots.size();
+}
+
+template <typename K, typename M, typename H>
+bool FrozenHashMap<K, M, H>::empty() const noexcept {
+    return size() == 0;
+}
+
+template <typename K, typename M, typename H>
+bool FrozenHashMap<K, M, H>::contains(const K& key) const {
+    return find(key) != end();
+}
+
+template <typename K, typename M, typename H>
+typename FrozenHashMap<K, M, H>::const_iterator FrozenHashMap<K, M, H>::find(const K& key) const {
+    if (_slots.empty()) {
+        return end();
+    }
+    size_t slot = slot_of(mixed_code(key));
+    return _slots[slot].first == key ? begin() + slot : end();
+}
+
+template <typename K, typename M, typename H>
+const M& FrozenHashMap<K, M, H>::at(const K& key) const {
+    auto found = find(key);
+    if (found == end()) {
+        throw std::out_of_range("FrozenHashMap::at: key not found");
+    }
+    return found->second;
+}
+
+template <typename K, typename M, typename H>
+typename FrozenHashMap<K, M, H>::const_iterator FrozenHashMap<K, M, H>::begin() const noexcept {
+    return _slots.begin();
+}
+
+template <typename K, typename M, typename H>
+typename FrozenHashMap<K, M, H>::const_iterator FrozenHashMap<K, M, H>::end() const noexcept {
+    return _slots.end();
+}
+
+/*
+* Tries to find pilots for every group with seed, filling _pilots, _remap, _seed and
+* slots (the element for each slot). Returns false if some group found no pilot, so
+* the caller can try the next seed.
+*/
+template <typename K, typename M, typename H>
+template <typename Element>
+bool FrozenHashMap<K, M, H>::place(const std::vector<std::pair<uint64_t, const Element*>>& keys,
+                                   uint64_t seed, std::vector<const Element*>& slots) {
+    size_t size = keys.size();
+    size_t positions = size + size / kSpareDivisor + 1;
+    size_t groups = std::max<size_t>(size / kKeysPerGroup, 1);
+    _seed = seed;
+    _pilots.assign(groups, 0);
+    slots.assign(size, nullptr);
+
+    // bucket the keys by group (a counting sort: groups are dense small integers),
+    // then order the non-empty groups by size, largest first
+    std::vector<std::pair<uint64_t, uint64_t>> mixed(size); // (group, mixed code)
+    std::vector<size_t> group_start(groups + 1, 0);
+    for (size_t i = 0; i < size; ++i) {
+        uint64_t code = mix(keys[i].first ^ seed);
+        mixed[i] = {reduce(code, groups), code};
+        ++group_start[mixed[i].first + 1];
+    }
+    for (size_t g = 0; g < groups; ++g) group_start[g + 1] += group_start[g];
+    std::vector<size_t> order(size);
+    std::vector<size_t> fill(group_start.begin(), group_start.end() - 1);
+    for (size_t i = 0; i < size; ++i) order[fill[mixed[i].first]++] = i;
+    std::vector<std::pair<size_t, size_t>> runs; // [first, last) of each group in order
+    for (size_t g = 0; g < groups; ++g) {
+        if (group_start[g] != group_start[g + 1]) runs.push_back({group_start[g], group_start[g + 1]});
+    }
+    std::stable_sort(runs.begin(), runs.end(), [](const auto& a, const auto& b) {
+        return a.second - a.first > b.second - b.first;
+    });
+
+    // one bit per position, so trying a pilot reads a few cache lines at most
+    std::vector<uint64_t> used((positions + 63) / 64, 0);
+    auto is_used = [&](size_t position) { return (used[position / 64] >> (position % 64)) & 1; };
+    std::vector<std::pair<size_t, const Element*>> past_end; // keys with positions >= size
+    std::vector<size_t> taken;
+    for (auto [first, last] : runs) {
+        size_t group = mixed[order[first]].first;
+        for (size_t i = first; i < last; ++i) {
+            for (size_t j = first; j < i; ++j) {
+                if (mixed[order[i]].second == mixed[order[j]].second) {
+                    throw std::invalid_argument("FrozenHashMap::build: two keys have the same hash code");
+                }
+            }
+        }
+
+        uint32_t pilot = 0;
+        for (; pilot < kMaxPilot; ++pilot) {
+            taken.clear();
+            for (size_t i = first; i < last; ++i) {
+                size_t position = position_of(mixed[order[i]].second, pilot, positions);
+                if (is_used(position) || std::find(taken.begin(), taken.end(), position) != taken.end()) break;
+                taken.push_back(position);
+            }
+            if (taken.size() == last - first) break;
+        }
+        if (pilot == kMaxPilot) {
+            return false;
+        }
+        _pilots[group] = static_cast<uint16_t>(pilot);
+        for (size_t i = first; i < last; ++i) {
+            size_t position = taken[i - first];
+            used[position / 64] |= uint64_t{1} << (position % 64);
+            if (position < size) {
+                slots[position] = keys[order[i]].second;
+            } else {
+                past_end.push_back({position, keys[order[i]].second});
+            }
+        }
+    }
+
+    // every key past the end takes one of the slots left free, as many as there are
+    _remap.assign(positions - size, 0);
+    size_t next_free = 0;
+    for (auto [position, element] : past_end) {
+        while (slots[next_free] != nullptr) ++next_free;
+        slots[next_free] = element;
+        _remap[position - size] = static_cast<uint32_t>(next_free);
+    }
+    return true;
+}
+
+template <typename K, typename M, typename H>
+uint64_t FrozenHashMap<K, M, H>::mixed_code(const K& key) const {
+    return mix(_hash_function(key) ^ _seed);
+}
+
+template <typename K, typename M, typename H>
+size_t FrozenHashMap<K, M, H>::slot_of(uint64_t mixed) const noexcept {
+    uint16_t pilot = _pilots[reduce(mixed, _pilots.size())];
+    size_t position = position_of(mixed, pilot, _slots.size() + _remap.size());
+    if (position >= _slots.size()) { // rare, so the branch predicts well
+        return _remap[position - _slots.size()];
+    }
+    return position;
+}
+
+/*
+* Returns the position pilot sends the key with code mixed to. mixed is already well
+* mixed, so one multiply suffices to make positions for different pilots look
+* independent; a lookup waits on this after reading the pilot, so it is kept short.
+*/
+template <typename K, typename M, typename H>
+size_t FrozenHashMap<K, M, H>::position_of(uint64_t mixed, uint32_t pilot, size_t positions) noexcept {
+    return reduce((mixed ^ (pilot * kFibonacciMultiplier)) * kFibonacciMultiplier, positions);
+}
+
+/*
+* The 64-bit finalizer from MurmurHash3: every input bit affects every output bit,
+* so even an identity hash function spreads over the groups and slots.
+*/
+template <typename K, typename M, typename H>
+uint64_t FrozenHashMap<K, M, H>::mix(uint64_t x) noexcept {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+/*
+* Maps x to [0, range) with a multiply and a shift instead of a division (Lemire's
+* fast range reduction), using the top bits of x.
+*/
+template <typename K, typename M, typename H>
+size_t FrozenHashMap<K, M, H>::reduce(uint64_t x, size_t range) noexcept {
+    return static_cast<size_t>((static_cast<unsigned __int128>(x) * range) >> 64);
+}
+
+#endif // HASHMAP_FROZEN_H
@@ -12,8 +12,9 @@
 #include <iterator>     // for std::forward_iterator_tag
 #include <functional>   // for std::conditional_t
 
-// forward declaration for the HashMap class
-template <typename K, typename M, typename H> class HashMap;
+// forward declarations for the HashMap class and the bucket ranges below
+template <typename K, typename M, typename H, typename Storage, typename Allocator> class HashMap;
+template <typename Map, bool IsConst> class HashMapBucketRange;
 
 /*
 * Template class for a HashMapIterator
@@ -22,7 +23,14 @@ template <typename K, typename M, typename H> class HashMap;
 * IsConst = whether this is a const_iterator class.
 *
 * Concept requirements:
-* - Map must be a valid class HashMap<K, M, H>
+* - Map must be a valid class HashMap<K, M, H, Storage, Allocator>
+*
+* The iterator does not know how Map lays out its elements. It walks the table
+* bucket by bucket through four members that every storage policy provides:
+*      Map::bucket_end()            - one past the last bucket index to walk
+*      Map::next_occupied(bucket)   - first non-empty bucket at or after this one, or bucket_end()
+*      Map::bucket_front(bucket)    - first node in that bucket, or nullptr if it is empty
+*      Map::next_in_bucket(node)    - node after this one in the same bucket, or nullptr
 */
 template <typename Map, bool IsConst = true>
 class HashMapIterator {
@@ -52,6 +60,7 @@ public:
     friend Map;
     friend HashMapIterator<Map, true>;
     friend HashMapIterator<Map, false>;
+    friend HashMapBucketRange<Map, IsConst>;
 
     /*
      * Conversion operator: converts any iterator (iterator or const_iterator) to a const_iterator.
@@ -69,7 +78,7 @@ public:
      * because that gives the client write access the map itself is const.
      */
     operator HashMapIterator<Map, true>() const {
-        return HashMapIterator<Map, true>(_buckets_array, _node, _bucket);
+        return HashMapIterator<Map, true>(_map, _node, _bucket);
     }
 
     /*
@@ -136,14 +145,9 @@ private:
     using node = typename Map::node;
 
     /*
-     * Determines what is the type of the _buckets_array that the HashMap is using.
+     * Instance variable: a pointer to the HashMap this iterator is for.
      */
-    using bucket_array_type = typename Map::bucket_array_type;
-
-    /*
-     * Instance variable: a pointer to the _buckets_array of the HashMap this iterator is for.
-     */
-    bucket_array_type* _buckets_array;
+    Map* _map;
 
     /*
      * Instance variable: pointer to the node that stores the element this iterator is currently pointing to.
@@ -161,15 +165,15 @@ private:
      * In the short answers, you will think about why the only iterator constructor is private,
      * and how you are still able to create iterators.
      */
-    HashMapIterator(bucket_array_type* buckets_array, node* node, size_t bucket);
+    HashMapIterator(Map* map, node* node, size_t bucket);
 
 };
 
 
 template <typename Map, bool IsConst>
-HashMapIterator<Map, IsConst>::HashMapIterator(bucket_array_type* buckets_array, node* node,
+HashMapIterator<Map, IsConst>::HashMapIterator(Map* map, node* node,
     size_t bucket) :
-    _buckets_array(buckets_array),
+    _map(map),
     _node(node),
     _bucket(bucket) { }
 
@@ -193,13 +197,11 @@ typename HashMapIterator<Map, IsConst>::pointer HashMapIterator<Map, IsConst>::o
 
 template <typename Map, bool IsConst>
 HashMapIterator<Map, IsConst>& HashMapIterator<Map, IsConst>::operator++() {
-    _node = _node->next; // _node can't be nullptr - that would be incrementing end()
+    _node = Map::next_in_bucket(_node); // _node can't be nullptr - that would be incrementing end()
     if (_node == nullptr) { // if you reach the end of the bucket, find the next bucket
-        for (++_bucket; _bucket < _buckets_array->size(); ++_bucket) {
-            _node = (*_buckets_array)[_bucket];
-            if (_node != nullptr) {
-                return *this;
-            }
+        _bucket = _map->next_occupied(_bucket + 1);
+        if (_bucket < _map->bucket_end()) {
+            _node = _map->bucket_front(_bucket);
         }
     }
     return *this;
@@ -222,4 +224,139 @@ bool operator!=(const HashMapIterator<Map, IsConst>& lhs, const HashMapIterator<
     return !(lhs == rhs);
 }
 
+/*
+* Template class for a local iterator: walks the elements of a single bucket, like
+* std::unordered_map::local_iterator. HashMap::begin(n) and end(n) return these.
+*
+* Map = the type of HashMap this class is a local iterator for.
+* IsConst = whether this is a const_local_iterator class.
+*
+* Usage:
+*      for (auto iter = map.begin(n); iter != map.end(n); ++iter) {...}
+*
+* Notes: the end of every bucket compares equal, since it is just the end of a chain.
+* Compare only iterators into the same bucket.
+*/
+template <typename Map, bool IsConst = true>
+class HashMapLocalIterator {
+public:
+    using value_type        =   std::conditional_t<IsConst, const typename Map::value_type, typename Map::value_type>;
+    using iterator_category =   std::forward_iterator_tag;
+    using difference_type   =   std::ptrdiff_t;
+    using pointer           =   value_type*;
+    using reference         =   value_type&;
+
+    friend Map;
+    friend HashMapLocalIterator<Map, true>;
+    friend HashMapLocalIterator<Map, false>;
+
+    /*
+    * Converts a local_iterator to a const_local_iterator, like HashMapIterator does.
+    */
+    operator HashMapLocalIterator<Map, true>() const {
+        return HashMapLocalIterator<Map, true>(_node);
+    }
+
+    reference operator*() const { return _node->value; }
+    pointer operator->() const { return &(_node->value); }
+
+    HashMapLocalIterator<Map, IsConst>& operator++() {
+        _node = Map::next_in_bucket(_node); // _node can't be nullptr - that would be incrementing end(n)
+        return *this;
+    }
+
+    HashMapLocalIterator<Map, IsConst> operator++(int) {
+        auto copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    friend bool operator==(const HashMapLocalIterator<Map, IsConst>& lhs, const HashMapLocalIterator<Map, IsConst>& rhs) {
+        return lhs._node == rhs._node;
+    }
+
+    friend bool operator!=(const HashMapLocalIterator<Map, IsConst>& lhs, const HashMapLocalIterator<Map, IsConst>& rhs) {
+        return !(lhs == rhs);
+    }
+
+private:
+    using node = typename Map::node;
+
+    explicit HashMapLocalIterator(node* node) : _node(node) { }
+
+    /*
+    * Instance variable: the element this iterator points to, or nullptr at the end of the bucket.
+    */
+    node* _node;
+};
+
+/*
+* Template class for a range of a HashMap's buckets: the elements in buckets [first, last),
+* in the order the map's iterators visit them. HashMap::bucket_ranges hands these out so
+* that each thread can walk its own part of the map with an ordinary range-for.
+*
+* Map = the type of HashMap this is a range of.
+* IsConst = whether the range's iterators are const_iterators.
+*
+* Usage:
+*      auto ranges = map.bucket_ranges(4);
+*      // on thread t:
+*      for (auto& [key, value] : ranges[t]) {...}
+*
+* Notes: begin() and end() look for the first non-empty bucket at or after first and last,
+* so each takes time proportional to the run of empty buckets it skips (a 64th of it for
+* the chained map, which keeps a bitmap of them). The range is invalidated by anything
+* that invalidates the map's iterators.
+*/
+template <typename Map, bool IsConst = true>
+class HashMapBucketRange {
+public:
+    using iterator = HashMapIterator<Map, IsConst>;
+
+    iterator begin() const;
+    iterator end() const;
+    bool empty() const;
+
+    /*
+    * The buckets this range covers, numbered as Map numbers them while iterating.
+    */
+    size_t first_bucket() const noexcept { return _first; }
+    size_t last_bucket() const noexcept { return _last; }
+
+private:
+    friend Map;
+    HashMapBucketRange(Map* map, size_t first, size_t last) : _map(map), _first(first), _last(last) { }
+
+    /*
+    * Returns an iterator to the first element in a bucket at or after bucket, or end().
+    */
+    iterator iterator_from(size_t bucket) const;
+
+    Map* _map;
+    size_t _first;
+    size_t _last;
+};
+
+template <typename Map, bool IsConst>
+typename HashMapBucketRange<Map, IsConst>::iterator HashMapBucketRange<Map, IsConst>::begin() const {
+    return iterator_from(_first);
+}
+
+template <typename Map, bool IsConst>
+typename HashMapBucketRange<Map, IsConst>::iterator HashMapBucketRange<Map, IsConst>::end() const {
+    return iterator_from(_last);
+}
+
+template <typename Map, bool IsConst>
+bool HashMapBucketRange<Map, IsConst>::empty() const {
+    return _map->next_occupied(_first) >= _last;
+}
+
+template <typename Map, bool IsConst>
+typename HashMapBucketRange<Map, IsConst>::iterator
+HashMapBucketRange<Map, IsConst>::iterator_from(size_t bucket) const {
+    bucket = _map->next_occupied(bucket);
+    return iterator(_map, bucket < _map->bucket_end() ? _map->bucket_front(bucket) : nullptr, bucket);
+}
+
 #endif // HASHMAPITERATOR_H
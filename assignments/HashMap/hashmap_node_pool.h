@@ -0,0 +1,235 @@
+/*
+* Assignment 2 (extension): NodePool template interface and implementation
+*
+* A slab allocator for the nodes of the chained HashMap. Instead of one new/delete
+* per element, the pool carves nodes out of large contiguous blocks (slabs), and
+* recycles erased nodes through a free list. Nodes inserted together end up next
+* to each other in memory, and freeing the whole map frees a handful of slabs
+* instead of one allocation per element.
+*/
+
+#ifndef HASHMAP_NODE_POOL_H
+#define HASHMAP_NODE_POOL_H
+
+#include <algorithm>    // for std::min
+#include <cstddef>      // for size_t
+#include <memory>       // for std::allocator, std::allocator_traits
+#include <new>          // for placement new
+#include <utility>      // for std::forward, std::exchange
+
+/*
+* Template class for a NodePool
+*
+* Node = the type of object the pool hands out.
+* Allocator = where the slabs come from; if not provided, defaults to std::allocator<Node>.
+*      It is rebound to the pool's slot type. Every byte the pool uses is in a slab:
+*      the slabs are chained together through their first slot.
+*
+* Usage:
+*      NodePool<node> pool;
+*      node* n = pool.create(value, next);     // constructs a node in pooled memory
+*      pool.destroy(n);                        // destroys it, its memory goes on the free list
+*      pool.release();                         // frees every slab at once
+*
+* Notes: the pool never returns memory for a single node to the system. Memory is
+* freed by release() and by the destructor, which frees all slabs, so every node
+* must already be destroyed by then. The pool is movable but not copyable, since
+* nodes belong to exactly one map.
+*/
+template <typename Node, typename Allocator = std::allocator<Node>>
+class NodePool {
+public:
+    explicit NodePool(const Allocator& alloc = Allocator());
+    ~NodePool();
+
+    NodePool(const NodePool& rhs) = delete;
+    NodePool& operator=(const NodePool& rhs) = delete;
+
+    /*
+    * Moving steals every slab (and so every live node) from rhs, leaving it empty.
+    * The move constructor also takes rhs's allocator. Move assignment first releases
+    * this pool's slabs, and takes rhs's allocator only if the allocator says it
+    * propagates on move assignment. Otherwise the two allocators must compare equal,
+    * since this pool will free rhs's slabs (the caller checks this).
+    */
+    NodePool(NodePool&& rhs) noexcept;
+    NodePool& operator=(NodePool&& rhs) noexcept;
+
+    /*
+    * Returns the allocator the slabs come from.
+    */
+    Allocator get_allocator() const noexcept;
+
+    /*
+    * Constructs a Node from args in a recycled slot if there is one, otherwise in the
+    * next unused slot of the newest slab, allocating a new slab when that one is full.
+    *
+    * Complexity: O(1) amortized
+    */
+    template <typename... Args>
+    Node* create(Args&&... args);
+
+    /*
+    * Makes sure the next count calls to create need no allocation: if the newest slab
+    * has fewer than count unused slots left, allocates one slab of exactly count slots.
+    * The unused rest of the old newest slab is skipped until release(). The free list is
+    * left alone, so its slots are still handed out first.
+    *
+    * Usage:
+    *      pool.reserve(n);    // then n nodes come out of one contiguous block
+    *
+    * Complexity: O(1)
+    */
+    void reserve(size_t count);
+
+    /*
+    * Destroys n and puts its memory on the free list. n must come from this pool.
+    *
+    * Complexity: O(1)
+    */
+    void destroy(Node* n) noexcept;
+
+    /*
+    * Frees every slab. Every node handed out must already have been destroyed.
+    *
+    * Complexity: O(number of slabs)
+    */
+    void release() noexcept;
+
+private:
+    /*
+    * One slot of a slab: either storage for a live Node, or a link in the free list.
+    */
+    union slot {
+        slot* next;
+        alignas(Node) unsigned char storage[sizeof(Node)];
+        struct {
+            slot* previous; // first slot of the previous slab
+            size_t size;    // number of slots in this slab
+        } slab;             // only used in the first slot of a slab
+    };
+
+    using slot_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<slot>;
+    using slot_traits = std::allocator_traits<slot_allocator>;
+
+    slot_allocator _allocator;
+    slot* _last_slab = nullptr;     // first slot of the newest slab
+    slot* _free_list = nullptr;     // most recently destroyed slot first
+    slot* _next = nullptr;          // next never-used slot of the newest slab
+    slot* _end = nullptr;           // one past the newest slab
+    size_t _slab_size = kMinSlabSize;
+
+    /*
+    * Slabs double in size from kMinSlabSize up to kMaxSlabSize nodes, so small maps
+    * stay small and large maps need few allocations.
+    */
+    static constexpr size_t kMinSlabSize = 16;
+    static constexpr size_t kMaxSlabSize = 8192;
+
+    /*
+    * Allocates a slab of size slots (including the header slot) and makes it the newest.
+    */
+    void add_slab(size_t size);
+};
+
+template <typename Node, typename Allocator>
+NodePool<Node, Allocator>::NodePool(const Allocator& alloc) :
+    _allocator{alloc} { }
+
+template <typename Node, typename Allocator>
+NodePool<Node, Allocator>::~NodePool() {
+    release();
+}
+
+template <typename Node, typename Allocator>
+NodePool<Node, Allocator>::NodePool(NodePool&& rhs) noexcept :
+    _allocator{rhs._allocator},
+    _last_slab{std::exchange(rhs._last_slab, nullptr)},
+    _free_list{std::exchange(rhs._free_list, nullptr)},
+    _next{std::exchange(rhs._next, nullptr)},
+    _end{std::exchange(rhs._end, nullptr)},
+    _slab_size{std::exchange(rhs._slab_size, kMinSlabSize)} { }
+
+template <typename Node, typename Allocator>
+NodePool<Node, Allocator>& NodePool<Node, Allocator>::operator=(NodePool&& rhs) noexcept {
+    if (this != &rhs) {
+        release();
+        if constexpr (slot_traits::propagate_on_container_move_assignment::value) {
+            _allocator = std::move(rhs._allocator);
+        }
+        _last_slab = std::exchange(rhs._last_slab, nullptr);
+        _free_list = std::exchange(rhs._free_list, nullptr);
+        _next = std::exchange(rhs._next, nullptr);
+        _end = std::exchange(rhs._end, nullptr);
+        _slab_size = std::exchange(rhs._slab_size, kMinSlabSize);
+    }
+    return *this;
+}
+
+template <typename Node, typename Allocator>
+Allocator NodePool<Node, Allocator>::get_allocator() const noexcept {
+    return Allocator(_allocator);
+}
+
+template <typename Node, typename Allocator>
+template <typename... Args>
+Node* NodePool<Node, Allocator>::create(Args&&... args) {
+    slot* curr;
+    if (_free_list != nullptr) {
+        curr = _free_list;
+        _free_list = curr->next;
+    } else {
+        if (_next == _end) {
+            add_slab(_slab_size);
+            _slab_size = std::min(2 * _slab_size, kMaxSlabSize);
+        }
+        curr = _next++;
+    }
+
+    try {
+        return new (curr->storage) Node(std::forward<Args>(args)...);
+    } catch (...) {
+        curr->next = _free_list; // don't lose the slot if Node's constructor throws
+        _free_list = curr;
+        throw;
+    }
+}
+
+template <typename Node, typename Allocator>
+void NodePool<Node, Allocator>::reserve(size_t count) {
+    if (static_cast<size_t>(_end - _next) < count) {
+        add_slab(count + 1); // one more for the slab's header
+    }
+}
+
+template <typename Node, typename Allocator>
+void NodePool<Node, Allocator>::add_slab(size_t size) {
+    slot* first = slot_traits::allocate(_allocator, size);
+    first->slab = {_last_slab, size};
+    _last_slab = first;
+    _next = first + 1;
+    _end = first + size;
+}
+
+template <typename Node, typename Allocator>
+void NodePool<Node, Allocator>::destroy(Node* n) noexcept {
+    n->~Node();
+    slot* curr = reinterpret_cast<slot*>(n);
+    curr->next = _free_list;
+    _free_list = curr;
+}
+
+template <typename Node, typename Allocator>
+void NodePool<Node, Allocator>::release() noexcept {
+    while (_last_slab != nullptr) {
+        slot* previous = _last_slab->slab.previous;
+        slot_traits::deallocate(_allocator, _last_slab, _last_slab->slab.size);
+        _last_slab = previous;
+    }
+    _free_list = nullptr;
+    _next = nullptr;
+    _end = nullptr;
+    _slab_size = kMinSlabSize;
+}
+
+#endif // HASHMAP_NODE_POOL_H
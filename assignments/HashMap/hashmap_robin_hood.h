@@ -0,0 +1,804 @@
+/*
+* Assignment 2 (extension): HashMap with the robin_hood_storage policy
+*
+* A flat, open-addressed layout for HashMap. The public interface is identical
+* to the chained HashMap in hashmap.h, so the comments there apply to every
+* member function declared below. This file only documents the layout and
+* the places where it behaves differently.
+*/
+
+#ifndef HASHMAP_ROBIN_HOOD_H
+#define HASHMAP_ROBIN_HOOD_H
+
+#include <algorithm>        // for std::max
+#include <cmath>            // for std::ceil
+#include <cstdint>          // for uint32_t, uint64_t
+#include <new>              // for placement new
+#include <stdexcept>        // for std::out_of_range
+#include <tuple>            // for std::forward_as_tuple
+#include <utility>          // for std::piecewise_construct, std::forward
+#include <vector>           // for the slot array
+#include "hashmap.h"
+
+/*
+* Template class for a HashMap using robin_hood_storage.
+*
+* Layout: every element lives directly in one std::vector of slots, so there are
+* no nodes and no next pointers. A key's home slot comes from multiplying its
+* hash by 2^64 / golden ratio and keeping the top bits (Fibonacci hashing), which
+* spreads out weak hash functions. If the home slot is taken, the key goes in
+* the next free slot to the right.
+*
+* Each slot remembers its distance from its home slot. When an insert meets an
+* element that is closer to its home than the new key, the new key takes that
+* slot and the other element moves further right (Robin Hood displacement).
+* This keeps probe runs short. A lookup can stop at the first element that is
+* closer to home than the key it is looking for.
+*
+* The table never wraps around. Probe runs that go past the last home slot
+* continue into overflow slots appended to the end of the array. So slot order
+* is iteration order, and erase can shift the rest of a run one slot left
+* (backward-shift deletion) instead of leaving tombstones.
+*
+* Differences from chained_storage:
+*      - bucket_count() is the number of slots, including the overflow slots.
+*      - the table grows automatically (doubling) before size() exceeds
+*        max_load_factor() times the number of home slots. The default is 0.875,
+*        and values above 1 are treated as 1 since a home slot holds one element.
+*        rehash(n) rounds n up to a power of two that can hold size() elements.
+*      - insert may move elements, and erase moves the elements after the
+*        erased one in its probe run. Both invalidate iterators to the moved
+*        elements. erase(pos) still returns an iterator to the element that
+*        followed pos, so erasing while iterating works as before.
+*
+* Usage:
+*      HashMap<std::string, int, std::hash<std::string>, robin_hood_storage> map;
+*      map.insert({"Avery", 3});
+*/
+template <typename K, typename M, typename H, typename A>
+class HashMap<K, M, H, robin_hood_storage, A> {
+    static_assert(std::is_same_v<A, std::allocator<std::pair<const K, M>>>,
+                  "HashMap: only chained_storage supports custom allocators");
+
+public:
+    using value_type = std::pair<const K, M>;
+    using allocator_type = A;
+    using iterator = HashMapIterator<HashMap, false>;
+    using const_iterator = HashMapIterator<HashMap, true>;
+
+    friend class HashMapIterator<HashMap, false>;
+    friend class HashMapIterator<HashMap, true>;
+
+    template <typename KeyLike>
+    using if_transparent = std::enable_if_t<is_transparent_hash<H>::value &&
+                                            !std::is_convertible_v<const KeyLike&, iterator> &&
+                                            !std::is_convertible_v<const KeyLike&, const_iterator>>;
+
+    HashMap();
+    explicit HashMap(size_t bucket_count, const H& hash = H());
+
+    template <typename InputIt>
+    HashMap(InputIt first, InputIt last, size_t bucket_count = kDefaultBuckets, const H& hash = H());
+    HashMap(std::initializer_list<value_type> init, size_t bucket_count = kDefaultBuckets, const H& hash = H());
+    template <typename InputIt>
+    static HashMap from_unique_range(InputIt first, InputIt last, const H& hash = H(),
+                                     const allocator_type& alloc = allocator_type());
+
+    HashMap(const HashMap& rhs);
+    HashMap& operator=(const HashMap& rhs);
+    HashMap(HashMap&& rhs);
+    HashMap& operator=(HashMap&& rhs);
+    ~HashMap() = default;
+
+    inline size_t size() const noexcept;
+    inline bool empty() const noexcept;
+    inline float load_factor() const noexcept;
+    inline size_t bucket_count() const noexcept;
+    allocator_type get_allocator() const noexcept;
+    H hash_function() const;
+    float max_load_factor() const noexcept;
+    void max_load_factor(float ml);
+    void reserve(size_t count);
+
+    bool contains(const K& key) const noexcept;
+    M& at(const K& key);
+    const M& at(const K& key) const;
+    M& operator[](const K& key);
+    M& operator[](K&& key);
+
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    bool contains(const KeyLike& key) const noexcept;
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    M& at(const KeyLike& key);
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    const M& at(const KeyLike& key) const;
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    M& operator[](const KeyLike& key);
+
+    iterator find(const K& key);
+    const_iterator find(const K& key) const;
+    std::pair<iterator, bool> insert(const value_type& value);
+    std::pair<iterator, bool> insert(value_type&& value);
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args);
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const K& key, Args&&... args);
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(K&& key, Args&&... args);
+    template <typename Obj>
+    std::pair<iterator, bool> insert_or_assign(const K& key, Obj&& obj);
+    template <typename Obj>
+    std::pair<iterator, bool> insert_or_assign(K&& key, Obj&& obj);
+    bool erase(const K& key);
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    iterator find(const KeyLike& key);
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    const_iterator find(const KeyLike& key) const;
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    bool erase(const KeyLike& key);
+    iterator erase(const_iterator pos);
+    void clear() noexcept;
+
+    /*
+    * Rebuilds the table with at least new_buckets home slots, rounded up to a power
+    * of two and to the capacity needed for size() elements.
+    *
+    * Exceptions: std::out_of_range if new_buckets = 0.
+    */
+    void rehash(size_t new_buckets);
+
+    iterator begin() noexcept;
+    iterator end() noexcept;
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+
+    /*
+    * Prints every slot with its element and its distance from the element's home slot.
+    */
+    void debug() const;
+
+private:
+    /*
+    * A slot either is empty (dist == 0) or holds one element that sits dist - 1 slots
+    * to the right of its home slot. The element lives in an anonymous union so
+    * empty slots never construct a K or M.
+    */
+    struct slot {
+        uint32_t dist;
+        union { value_type value; };
+
+        slot() noexcept : dist{0} {}
+        slot(slot&& rhs) : dist{rhs.dist} {
+            if (dist != 0) new (&value) value_type(release(rhs.value));
+        }
+        ~slot() {
+            if (dist != 0) value.~value_type();
+        }
+
+        void destroy() noexcept {
+            value.~value_type();
+            dist = 0;
+        }
+    };
+
+    /*
+    * HashMapIterator treats every slot as a bucket holding at most one node.
+    */
+    using node = slot;
+
+    /*
+    * Moves both halves out of an element that is about to be destroyed. The key
+    * is only const so clients can't change it in place; nothing can observe the
+    * moved-from key before the element is destroyed.
+    */
+    static std::pair<K, M> release(value_type& value) {
+        return {std::move(const_cast<K&>(value.first)), std::move(value.second)};
+    }
+
+    size_t home_slot(size_t hash) const noexcept;
+    template <typename KeyLike>
+    size_t find_slot(const KeyLike& key) const;
+    template <typename KeyLike>
+    size_t find_slot(const KeyLike& key, size_t hash) const;
+    size_t place(std::pair<K, M>&& element, size_t hash);
+    void erase_slot(size_t index);
+    void rebuild(size_t new_capacity);
+    size_t min_capacity(size_t count) const noexcept;
+    template <typename KeyLike, typename... Args>
+    std::pair<iterator, bool> emplace_key(const KeyLike& key, Args&&... args);
+    template <typename... Args>
+    size_t emplace_new(size_t hash, Args&&... args);
+    iterator make_iterator(size_t index);
+
+    size_t bucket_end() const noexcept;
+    size_t next_occupied(size_t bucket) const noexcept;
+    node* bucket_front(size_t bucket) noexcept;
+    static node* next_in_bucket(node* curr) noexcept;
+
+    size_t _size;
+    H _hash_function;
+
+    /*
+    * _capacity is the number of home slots (a power of two), and _shift is
+    * 64 - log2(_capacity). A moved-from map has _capacity == 0 and no slots.
+    */
+    size_t _capacity;
+    int _shift;
+    std::vector<slot> _slots;
+    float _max_load_factor;
+
+    static const size_t kDefaultBuckets = 10;
+    static constexpr size_t kMinCapacity = 4;
+    static constexpr float kDefaultMaxLoadFactor = 0.875f;
+    static constexpr uint64_t kFibonacciMultiplier = 11400714819323198485ull;
+};
+
+template <typename K, typename M, typename H, typename A>
+HashMap<K, M, H, robin_hood_storage, A>::HashMap() : HashMap{kDefaultBuckets} { }
+
+template <typename K, typename M, typename H, typename A>
+HashMap<K, M, H, robin_hood_storage, A>::HashMap(size_t bucket_count, const H& hash) :
+    _size{0},
+    _hash_function{hash},
+    _capacity{0},
+    _shift{64},
+    _max_load_factor{kDefaultMaxLoadFactor} {
+    rebuild(bucket_count);
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename InputIt>
+HashMap<K, M, H, robin_hood_storage, A>::HashMap(InputIt first, InputIt last, size_t bucket_count, const H& hash) :
+    HashMap(bucket_count, hash) {
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+        reserve(std::distance(first, last));
+    }
+    for (auto iter = first; iter != last; ++iter) {
+        emplace_key(iter->first, *iter);
+    }
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename InputIt>
+HashMap<K, M, H, robin_hood_storage, A>
+HashMap<K, M, H, robin_hood_storage, A>::from_unique_range(InputIt first, InputIt last, const H& hash, const allocator_type&) {
+    HashMap map(kDefaultBuckets, hash);
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+        map.reserve(std::distance(first, last));
+    }
+    for (auto iter = first; iter != last; ++iter) {
+        map.emplace_new(map._hash_function(iter->first), *iter);
+    }
+    return map;
+}
+
+template <typename K, typename M, typename H, typename A>
+HashMap<K, M, H, robin_hood_storage, A>::HashMap(std::initializer_list<value_type> init, size_t bucket_count,
+    const H& hash) : HashMap(init.begin(), init.end(), bucket_count, hash) { }
+
+// the copy keeps rhs's exact layout, so nothing is rehashed
+template <typename K, typename M, typename H, typename A>
+HashMap<K, M, H, robin_hood_storage, A>::HashMap(const HashMap& rhs) :
+    _size{rhs._size},
+    _hash_function{rhs._hash_function},
+    _capacity{rhs._capacity},
+    _shift{rhs._shift},
+    _slots(rhs._slots.size()),
+    _max_load_factor{rhs._max_load_factor} {
+    for (size_t i = 0; i < _slots.size(); ++i) {
+        if (rhs._slots[i].dist != 0) {
+            new (&_slots[i].value) value_type(rhs._slots[i].value);
+            _slots[i].dist = rhs._slots[i].dist;
+        }
+    }
+}
+
+template <typename K, typename M, typename H, typename A>
+HashMap<K, M, H, robin_hood_storage, A>& HashMap<K, M, H, robin_hood_storage, A>::operator=(const HashMap& rhs) {
+    if (&rhs != this) {
+        *this = HashMap(rhs);
+    }
+    return *this;
+}
+
+template <typename K, typename M, typename H, typename A>
+HashMap<K, M, H, robin_hood_storage, A>::HashMap(HashMap&& rhs) :
+    _size{rhs._size},
+    _hash_function{std::move(rhs._hash_function)},
+    _capacity{rhs._capacity},
+    _shift{rhs._shift},
+    _slots{std::move(rhs._slots)},
+    _max_load_factor{rhs._max_load_factor} {
+    rhs._size = 0;
+    rhs._capacity = 0;
+    rhs._slots.clear();
+}
+
+template <typename K, typename M, typename H, typename A>
+HashMap<K, M, H, robin_hood_storage, A>& HashMap<K, M, H, robin_hood_storage, A>::operator=(HashMap&& rhs) {
+    if (this != &rhs) {
+        _size = rhs._size;
+        _hash_function = std::move(rhs._hash_function);
+        _capacity = rhs._capacity;
+        _shift = rhs._shift;
+        _slots = std::move(rhs._slots);
+        _max_load_factor = rhs._max_load_factor;
+        rhs._size = 0;
+        rhs._capacity = 0;
+        rhs._slots.clear();
+    }
+    return *this;
+}
+
+template <typename K, typename M, typename H, typename A>
+inline size_t HashMap<K, M, H, robin_hood_storage, A>::size() const noexcept {
+    return _size;
+}
+
+template <typename K, typename M, typename H, typename A>
+inline bool HashMap<K, M, H, robin_hood_storage, A>::empty() const noexcept {
+    return size() == 0;
+}
+
+template <typename K, typename M, typename H, typename A>
+inline float HashMap<K, M, H, robin_hood_storage, A>::load_factor() const noexcept {
+    return bucket_count() == 0 ? 0 : static_cast<float>(size())/bucket_count();
+}
+
+template <typename K, typename M, typename H, typename A>
+inline size_t HashMap<K, M, H, robin_hood_storage, A>::bucket_count() const noexcept {
+    return _slots.size();
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, robin_hood_storage, A>::allocator_type
+HashMap<K, M, H, robin_hood_storage, A>::get_allocator() const noexcept {
+    return allocator_type();
+}
+
+template <typename K, typename M, typename H, typename A>
+H HashMap<K, M, H, robin_hood_storage, A>::hash_function() const {
+    return _hash_function;
+}
+
+template <typename K, typename M, typename H, typename A>
+float HashMap<K, M, H, robin_hood_storage, A>::max_load_factor() const noexcept {
+    return _max_load_factor;
+}
+
+template <typename K, typename M, typename H, typename A>
+void HashMap<K, M, H, robin_hood_storage, A>::max_load_factor(float ml) {
+    if (!(ml > 0)) {
+        throw std::out_of_range("HashMap<K, M, H, robin_hood_storage, A>::max_load_factor: ml must be positive.");
+    }
+    _max_load_factor = std::min(ml, 1.0f);
+    if (_size > _capacity * _max_load_factor) {
+        rebuild(min_capacity(_size));
+    }
+}
+
+template <typename K, typename M, typename H, typename A>
+void HashMap<K, M, H, robin_hood_storage, A>::reserve(size_t count) {
+    if (count > _capacity * _max_load_factor) {
+        rebuild(min_capacity(count));
+    }
+}
+
+template <typename K, typename M, typename H, typename A>
+bool HashMap<K, M, H, robin_hood_storage, A>::contains(const K& key) const noexcept {
+    return find_slot(key) != _slots.size();
+}
+
+template <typename K, typename M, typename H, typename A>
+M& HashMap<K, M, H, robin_hood_storage, A>::at(const K& key) {
+    size_t index = find_slot(key);
+    if (index == _slots.size()) {
+        throw std::out_of_range("HashMap<K, M, H, robin_hood_storage, A>::at: key not found");
+    }
+    return _slots[index].value.second;
+}
+
+template <typename K, typename M, typename H, typename A>
+const M& HashMap<K, M, H, robin_hood_storage, A>::at(const K& key) const {
+    // see static_cast/const_cast trick explained in hashmap.cpp.
+    return static_cast<const M&>(const_cast<HashMap*>(this)->at(key));
+}
+
+template <typename K, typename M, typename H, typename A>
+M& HashMap<K, M, H, robin_hood_storage, A>::operator[](const K& key) {
+    return try_emplace(key).first->second;
+}
+
+template <typename K, typename M, typename H, typename A>
+M& HashMap<K, M, H, robin_hood_storage, A>::operator[](K&& key) {
+    return try_emplace(std::move(key)).first->second;
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, robin_hood_storage, A>::iterator HashMap<K, M, H, robin_hood_storage, A>::find(const K& key) {
+    return make_iterator(find_slot(key));
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, robin_hood_storage, A>::const_iterator
+HashMap<K, M, H, robin_hood_storage, A>::find(const K& key) const {
+    // see static_cast/const_cast trick explained in hashmap.cpp.
+    return static_cast<const_iterator>(const_cast<HashMap*>(this)->find(key));
+}
+
+template <typename K, typename M, typename H, typename A>
+std::pair<typename HashMap<K, M, H, robin_hood_storage, A>::iterator, bool>
+HashMap<K, M, H, robin_hood_storage, A>::insert(const value_type& value) {
+    return emplace_key(value.first, value);
+}
+
+template <typename K, typename M, typename H, typename A>
+std::pair<typename HashMap<K, M, H, robin_hood_storage, A>::iterator, bool>
+HashMap<K, M, H, robin_hood_storage, A>::insert(value_type&& value) {
+    return emplace_key(value.first, std::move(value));
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename... Args>
+std::pair<typename HashMap<K, M, H, robin_hood_storage, A>::iterator, bool>
+HashMap<K, M, H, robin_hood_storage, A>::emplace(Args&&... args) {
+    // the key is part of the element, so build it first. Its key is copied, not moved,
+    // into the slot (it is const), so key stays valid while emplace_key moves element.
+    value_type element(std::forward<Args>(args)...);
+    return emplace_key(element.first, std::move(element));
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename... Args>
+std::pair<typename HashMap<K, M, H, robin_hood_storage, A>::iterator, bool>
+HashMap<K, M, H, robin_hood_storage, A>::try_emplace(const K& key, Args&&... args) {
+    return emplace_key(key, std::piecewise_construct, std::forward_as_tuple(key),
+                       std::forward_as_tuple(std::forward<Args>(args)...));
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename... Args>
+std::pair<typename HashMap<K, M, H, robin_hood_storage, A>::iterator, bool>
+HashMap<K, M, H, robin_hood_storage, A>::try_emplace(K&& key, Args&&... args) {
+    return emplace_key(key, std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                       std::forward_as_tuple(std::forward<Args>(args)...));
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename Obj>
+std::pair<typename HashMap<K, M, H, robin_hood_storage, A>::iterator, bool>
+HashMap<K, M, H, robin_hood_storage, A>::insert_or_assign(const K& key, Obj&& obj) {
+    auto result = try_emplace(key, std::forward<Obj>(obj));
+    if (!result.second) {
+        result.first->second = std::forward<Obj>(obj);
+    }
+    return result;
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename Obj>
+std::pair<typename HashMap<K, M, H, robin_hood_storage, A>::iterator, bool>
+HashMap<K, M, H, robin_hood_storage, A>::insert_or_assign(K&& key, Obj&& obj) {
+    auto result = try_emplace(std::move(key), std::forward<Obj>(obj));
+    if (!result.second) {
+        result.first->second = std::forward<Obj>(obj);
+    }
+    return result;
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike, typename... Args>
+std::pair<typename HashMap<K, M, H, robin_hood_storage, A>::iterator, bool>
+HashMap<K, M, H, robin_hood_storage, A>::emplace_key(const KeyLike& key, Args&&... args) {
+    size_t hash = _hash_function(key);
+    size_t index = find_slot(key, hash);
+    if (index != _slots.size()) {
+        return {make_iterator(index), false};
+    }
+
+    return {make_iterator(emplace_new(hash, std::forward<Args>(args)...)), true};
+}
+
+/*
+* Inserts a new element constructed from args, whose key (with hash code hash) must not
+* be in the map yet, and returns its slot.
+*/
+template <typename K, typename M, typename H, typename A>
+template <typename... Args>
+size_t HashMap<K, M, H, robin_hood_storage, A>::emplace_new(size_t hash, Args&&... args) {
+    // place carries the element along the probe run, so it is built once outside the table
+    std::pair<K, M> element(std::forward<Args>(args)...);
+    if (_size + 1 > _capacity * _max_load_factor) {
+        rebuild(std::max({2 * _capacity, kMinCapacity, min_capacity(_size + 1)}));
+    }
+    size_t index = place(std::move(element), hash);
+    ++_size;
+    return index;
+}
+
+template <typename K, typename M, typename H, typename A>
+bool HashMap<K, M, H, robin_hood_storage, A>::erase(const K& key) {
+    size_t index = find_slot(key);
+    if (index == _slots.size()) {
+        return false;
+    }
+    erase_slot(index);
+    return true;
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike, typename>
+bool HashMap<K, M, H, robin_hood_storage, A>::contains(const KeyLike& key) const noexcept {
+    return find_slot(key) != _slots.size();
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike, typename>
+M& HashMap<K, M, H, robin_hood_storage, A>::at(const KeyLike& key) {
+    size_t index = find_slot(key);
+    if (index == _slots.size()) {
+        throw std::out_of_range("HashMap<K, M, H, robin_hood_storage, A>::at: key not found");
+    }
+    return _slots[index].value.second;
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike, typename>
+const M& HashMap<K, M, H, robin_hood_storage, A>::at(const KeyLike& key) const {
+    // see static_cast/const_cast trick explained in hashmap.cpp.
+    return static_cast<const M&>(const_cast<HashMap*>(this)->at(key));
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike, typename>
+M& HashMap<K, M, H, robin_hood_storage, A>::operator[](const KeyLike& key) {
+    // only build a K when key is not in the map yet
+    return emplace_key(key, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple()).first->second;
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike, typename>
+typename HashMap<K, M, H, robin_hood_storage, A>::iterator HashMap<K, M, H, robin_hood_storage, A>::find(const KeyLike& key) {
+    return make_iterator(find_slot(key));
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike, typename>
+typename HashMap<K, M, H, robin_hood_storage, A>::const_iterator HashMap<K, M, H, robin_hood_storage, A>::find(const KeyLike& key) const {
+    // see static_cast/const_cast trick explained in hashmap.cpp.
+    return static_cast<const_iterator>(const_cast<HashMap*>(this)->find(key));
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike, typename>
+bool HashMap<K, M, H, robin_hood_storage, A>::erase(const KeyLike& key) {
+    size_t index = find_slot(key);
+    if (index == _slots.size()) {
+        return false;
+    }
+    erase_slot(index);
+    return true;
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, robin_hood_storage, A>::iterator
+HashMap<K, M, H, robin_hood_storage, A>::erase(const_iterator pos) {
+    // backward shift moves the element that followed pos into pos's slot,
+    // so the next element is the first full slot at or after pos.
+    erase_slot(pos._bucket);
+    return make_iterator(pos._bucket);
+}
+
+template <typename K, typename M, typename H, typename A>
+void HashMap<K, M, H, robin_hood_storage, A>::clear() noexcept {
+    for (auto& curr : _slots) {
+        if (curr.dist != 0) {
+            curr.destroy();
+        }
+    }
+    _size = 0;
+}
+
+template <typename K, typename M, typename H, typename A>
+void HashMap<K, M, H, robin_hood_storage, A>::rehash(size_t new_buckets) {
+    if (new_buckets == 0) {
+        throw std::out_of_range("HashMap<K, M, H, robin_hood_storage, A>::rehash: new_bucket_count must be positive.");
+    }
+    rebuild(std::max(new_buckets, min_capacity(_size)));
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, robin_hood_storage, A>::iterator HashMap<K, M, H, robin_hood_storage, A>::begin() noexcept {
+    return make_iterator(0);
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, robin_hood_storage, A>::iterator HashMap<K, M, H, robin_hood_storage, A>::end() noexcept {
+    return make_iterator(_slots.size());
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, robin_hood_storage, A>::const_iterator
+HashMap<K, M, H, robin_hood_storage, A>::begin() const noexcept {
+    return static_cast<const_iterator>(const_cast<HashMap*>(this)->begin());
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, robin_hood_storage, A>::const_iterator
+HashMap<K, M, H, robin_hood_storage, A>::end() const noexcept {
+    return static_cast<const_iterator>(const_cast<HashMap*>(this)->end());
+}
+
+template <typename K, typename M, typename H, typename A>
+void HashMap<K, M, H, robin_hood_storage, A>::debug() const {
+    std::cout << std::setw(30) << std::setfill('-') << '\n' << std::setfill(' ')
+          << "Printing debug information for your HashMap implementation (robin_hood_storage)\n"
+          << "Size: " << size() << std::setw(15) << std::right
+          << "Slots: " << bucket_count() << std::setw(20) << std::right
+          << "(load factor: " << std::setprecision(2) << load_factor() << ") \n\n";
+
+    for (size_t i = 0; i < bucket_count(); ++i) {
+        std::cout << "[" << std::setw(3) << i << "]:";
+        if (_slots[i].dist != 0) {
+            const auto& [key, mapped] = _slots[i].value;
+            // next line will not compile if << not supported for K or M
+            std::cout << " " << key << ":" << mapped << " (distance " << _slots[i].dist - 1 << ")";
+        }
+        std::cout << " /" << '\n';
+    }
+    std::cout << std::setw(30) << std::setfill('-') << '\n' << std::setfill(' ');
+}
+
+template <typename K, typename M, typename H, typename A>
+size_t HashMap<K, M, H, robin_hood_storage, A>::home_slot(size_t hash) const noexcept {
+    return _capacity == 0 ? 0 : static_cast<size_t>((static_cast<uint64_t>(hash) * kFibonacciMultiplier) >> _shift);
+}
+
+/*
+* Returns the index of the slot holding key, or _slots.size() if key is not in the map.
+* The probe stops at the first slot whose element is closer to its home than key
+* would be at that point. Robin Hood ordering guarantees key is not further right.
+*/
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike>
+size_t HashMap<K, M, H, robin_hood_storage, A>::find_slot(const KeyLike& key) const {
+    return find_slot(key, _hash_function(key));
+}
+
+/*
+* As above, for a caller that already has key's hash code (and needs it again).
+*/
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike>
+size_t HashMap<K, M, H, robin_hood_storage, A>::find_slot(const KeyLike& key, size_t hash) const {
+    size_t index = home_slot(hash);
+    for (uint32_t dist = 1; index < _slots.size() && _slots[index].dist >= dist; ++index, ++dist) {
+        if (_slots[index].value.first == key) {
+            return index;
+        }
+    }
+    return _slots.size();
+}
+
+/*
+* Places element (whose key must not be in the map yet) and returns the index it ended
+* up in. Elements it displaces are carried right until an empty slot is found,
+* appending overflow slots if the run reaches the end of the array.
+*/
+template <typename K, typename M, typename H, typename A>
+size_t HashMap<K, M, H, robin_hood_storage, A>::place(std::pair<K, M>&& element, size_t hash) {
+    std::pair<K, M> carry = std::move(element);
+    bool displaced_any = false;
+    size_t placed = 0;
+    size_t index = home_slot(hash);
+    for (uint32_t dist = 1; ; ++index, ++dist) {
+        if (index == _slots.size()) {
+            _slots.emplace_back();
+        }
+        slot& curr = _slots[index];
+        if (curr.dist == 0) {
+            new (&curr.value) value_type(std::move(carry));
+            curr.dist = dist;
+            return displaced_any ? placed : index;
+        }
+        if (curr.dist < dist) {
+            std::pair<K, M> displaced = release(curr.value);
+            curr.value.~value_type();
+            new (&curr.value) value_type(std::move(carry));
+            std::swap(curr.dist, dist);
+            carry = std::move(displaced);
+            if (!displaced_any) {
+                displaced_any = true;
+                placed = index;
+            }
+        }
+    }
+}
+
+/*
+* Backward-shift deletion: every following element in the probe run (dist > 1)
+* moves one slot left, closer to its home. No tombstones are left behind.
+*/
+template <typename K, typename M, typename H, typename A>
+void HashMap<K, M, H, robin_hood_storage, A>::erase_slot(size_t index) {
+    _slots[index].destroy();
+    for (size_t next = index + 1; next < _slots.size() && _slots[next].dist > 1; ++index, ++next) {
+        new (&_slots[index].value) value_type(release(_slots[next].value));
+        _slots[index].dist = _slots[next].dist - 1;
+        _slots[next].destroy();
+    }
+    --_size;
+}
+
+/*
+* Moves every element into a fresh array with at least new_capacity home slots
+* (rounded up to a power of two) plus log2(capacity) overflow slots.
+*/
+template <typename K, typename M, typename H, typename A>
+void HashMap<K, M, H, robin_hood_storage, A>::rebuild(size_t new_capacity) {
+    size_t capacity = kMinCapacity;
+    int shift = 62;
+    while (capacity < new_capacity) {
+        capacity *= 2;
+        --shift;
+    }
+
+    std::vector<slot> old_slots = std::move(_slots);
+    _capacity = capacity;
+    _shift = shift;
+    _slots = std::vector<slot>(capacity + (64 - shift));
+    for (auto& curr : old_slots) {
+        if (curr.dist != 0) {
+            size_t hash = _hash_function(curr.value.first);
+            place(release(curr.value), hash);
+        }
+    }
+}
+
+/*
+* Returns the number of home slots needed to hold count elements without
+* exceeding the max load factor.
+*/
+template <typename K, typename M, typename H, typename A>
+size_t HashMap<K, M, H, robin_hood_storage, A>::min_capacity(size_t count) const noexcept {
+    return static_cast<size_t>(std::ceil(count / _max_load_factor));
+}
+
+/*
+* Returns an iterator to the first element at or after slot index (end() if there is none).
+*/
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, robin_hood_storage, A>::iterator
+HashMap<K, M, H, robin_hood_storage, A>::make_iterator(size_t index) {
+    index = next_occupied(index);
+    return {this, index < _slots.size() ? &_slots[index] : nullptr, index};
+}
+
+template <typename K, typename M, typename H, typename A>
+size_t HashMap<K, M, H, robin_hood_storage, A>::bucket_end() const noexcept {
+    return bucket_count();
+}
+
+template <typename K, typename M, typename H, typename A>
+size_t HashMap<K, M, H, robin_hood_storage, A>::next_occupied(size_t index) const noexcept {
+    while (index < _slots.size() && _slots[index].dist == 0) {
+        ++index;
+    }
+    return index;
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, robin_hood_storage, A>::node*
+HashMap<K, M, H, robin_hood_storage, A>::bucket_front(size_t bucket) noexcept {
+    return _slots[bucket].dist != 0 ? &_slots[bucket] : nullptr;
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, robin_hood_storage, A>::node*
+HashMap<K, M, H, robin_hood_storage, A>::next_in_bucket(node*) noexcept {
+    return nullptr; // a slot holds at most one element
+}
+
+#endif // HASHMAP_ROBIN_HOOD_H
@@ -0,0 +1,359 @@
+/*
+* Assignment 2 (extension): ShardedHashMap
+*
+* A thread-safe map made of N independent HashMaps (shards), each behind its own lock.
+* Threads working on keys in different shards never wait for each other, and a job that
+* reads the whole map can take the shards one at a time, or several at once in
+* parallel, without stopping writers on the other shards.
+*/
+
+#ifndef HASHMAP_SHARDED_H
+#define HASHMAP_SHARDED_H
+
+#include <algorithm>        // for std::max, std::min
+#include <atomic>           // for handing out shards to worker threads
+#include <exception>        // for std::exception_ptr
+#include <functional>       // for std::hash
+#include <memory>           // for std::unique_ptr
+#include <mutex>            // for std::mutex, std::lock_guard
+#include <optional>         // for the result of find
+#include <stdexcept>        // for std::out_of_range
+#include <system_error>     // for std::system_error, when a worker thread can't start
+#include <thread>           // for std::thread
+#include <utility>          // for std::forward
+#include <vector>           // for the worker threads
+#include "hashmap.h"
+
+/*
+* Template class for a HashMap split into independently locked shards.
+*
+* Routing: a key's shard is the top log2(shard_count()) bits of its hash times 2^64 /
+* golden ratio, the same mix fibonacci_indexing uses. Each shard is a chained HashMap,
+* which picks buckets with the whole hash (modulo_indexing), so keys that share a shard
+* still spread over all of its buckets. The shard count is a power of two.
+*
+* Each shard is a mutex and a HashMap, aligned to its own cache lines, so threads
+* working on neighbouring shards don't slow each other down.
+*
+* Shard-local access: for_each_shard and with_shard hand out a shard's HashMap while
+* holding that shard's lock, so callers can iterate it, or use any HashMap member, at
+* full speed. Nothing else is locked meanwhile.
+*
+* Usage:
+*      ShardedHashMap<std::string, long> counts;
+*      // from any number of threads:
+*      counts.upsert("Avery", [](long& count) { ++count; });
+*      // later, summing the shards in parallel on 8 threads:
+*      std::atomic<long> total = 0;
+*      counts.for_each_shard([&](const auto& shard) {
+*          long sum = 0;
+*          for (const auto& [key, count] : shard) sum += count;
+*          total += sum;
+*      }, 8);
+*/
+template <typename K, typename M, typename H = std::hash<K>>
+class ShardedHashMap {
+public:
+    using key_type = K;
+    using mapped_type = M;
+    using value_type = std::pair<const K, M>;
+    using shard_type = HashMap<K, M, H>;
+
+    /*
+    * Creates an empty map with at least shard_count shards, rounded up to a power of two.
+    * The default is one shard per hardware thread.
+    *
+    * Exceptions: std::out_of_range if shard_count is 0.
+    */
+    ShardedHashMap();
+    explicit ShardedHashMap(size_t shard_count, const H& hash = H());
+
+    /*
+    * Not copyable or movable, since the shards' mutexes can't be.
+    */
+    ShardedHashMap(const ShardedHashMap&) = delete;
+    ShardedHashMap& operator=(const ShardedHashMap&) = delete;
+    ~ShardedHashMap() = default;
+
+    size_t shard_count() const noexcept;
+
+    /*
+    * Returns the index of the shard key belongs to.
+    */
+    size_t shard_index(const K& key) const;
+
+    /*
+    * Returns the number of elements. Locks each shard in turn, so while other threads
+    * insert or erase it is only a snapshot.
+    *
+    * Complexity: O(shard_count())
+    */
+    size_t size() const;
+    bool empty() const;
+
+    /*
+    * Inserts value if its key is not already in the map. Returns whether it was inserted.
+    */
+    bool insert(const value_type& value);
+
+    /*
+    * Returns a copy of key's mapped value, or std::nullopt if key is not in the map.
+    */
+    std::optional<M> find(const K& key) const;
+    bool contains(const K& key) const;
+
+    /*
+    * Calls fn(mapped) on key's mapped value while holding key's shard. Returns false,
+    * without calling fn, if key is not in the map.
+    *
+    * Notes: fn must not use this map, since the shard is still locked.
+    */
+    template <typename Fn>
+    bool update(const K& key, Fn&& fn);
+
+    /*
+    * Like update, but first inserts key with a default-constructed mapped value if it
+    * is not in the map.
+    *
+    * Usage:
+    *      counts.upsert("Avery", [](long& count) { ++count; });  // counts from zero
+    */
+    template <typename Fn>
+    void upsert(const K& key, Fn&& fn);
+
+    /*
+    * Removes key from the map. Returns whether it was there.
+    */
+    bool erase(const K& key);
+
+    /*
+    * Removes every element, locking each shard in turn.
+    */
+    void clear();
+
+    /*
+    * Calls fn(shard) on every shard's HashMap while holding that shard's lock. With
+    * threads > 1, that many threads (at most one per shard) take shards in turn and the
+    * calls run in parallel, so fn must be safe to call concurrently on different shards.
+    * If a thread can't be started, the others take its shards. If a call throws, the
+    * other threads finish their current shard and stop, and the first exception is
+    * rethrown here.
+    *
+    * Complexity: O(N + B) work, where N = size() and B = the total bucket count.
+    *
+    * Notes: fn must not use this map through anything but its argument.
+    */
+    template <typename Fn>
+    void for_each_shard(Fn&& fn, size_t threads = 1);
+    template <typename Fn>
+    void for_each_shard(Fn&& fn, size_t threads = 1) const;
+
+    /*
+    * Calls fn(shard) on shard index's HashMap while holding its lock, and returns what
+    * fn returns. For callers that hand out shards to their own threads.
+    */
+    template <typename Fn>
+    decltype(auto) with_shard(size_t index, Fn&& fn);
+    template <typename Fn>
+    decltype(auto) with_shard(size_t index, Fn&& fn) const;
+
+private:
+    struct alignas(64) shard {
+        mutable std::mutex mutex;
+        shard_type map;
+    };
+
+    /*
+    * The number of buckets each shard starts with.
+    */
+    static constexpr size_t kShardBuckets = 16;
+
+    static size_t default_shard_count() noexcept;
+    shard& shard_for(const K& key) const;
+    template <typename Self, typename Fn>
+    static void visit_shards(Self& self, Fn& fn, size_t threads);
+
+    size_t _shard_count;
+    std::unique_ptr<shard[]> _shards;
+    H _hash_function;
+};
+
+template <typename K, typename M, typename H>
+ShardedHashMap<K, M, H>::ShardedHashMap() : ShardedHashMap{default_shard_count()} { }
+
+template <typename K, typename M, typename H>
+ShardedHashMap<K, M, H>::ShardedHashMap(size_t shard_count, const H& hash) :
+    _shard_count{fibonacci_indexing::bucket_count(shard_count)},
+    _hash_function{hash} {
+    if (shard_count == 0) {
+        throw std::out_of_range("ShardedHashMap: shard_count cannot be 0");
+    }
+    _shards.reset(new shard[_shard_count]);
+    for (size_t i = 0; i < _shard_count; ++i) {
+        _shards[i].map = shard_type(kShardBuckets, hash);
+    }
+}
+
+template <typename K, typename M, typename H>
+size_t ShardedHashMap<K, M, H>::shard_count() const noexcept {
+    return _shard_count;
+}
+
+template <typename K, typename M, typename H>
+size_t ShardedHashMap<K, M, H>::shard_index(const K& key) const {
+    return fibonacci_indexing::index(_hash_function(key), _shard_count);
+}
+
+template <typename K, typename M, typename H>
+size_t ShardedHashMap<K, M, H>::size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < _shard_count; ++i) {
+        std::lock_guard lock(_shards[i].mutex);
+        total += _shards[i].map.size();
+    }
+    return total;
+}
+
+template <typename K, typename M, typename H>
+bool ShardedHashMap<K, M, H>::empty() const {
+    return size() == 0;
+}
+
+template <typename K, typename M, typename H>
+bool ShardedHashMap<K, M, H>::insert(const value_type& value) {
+    auto& s = shard_for(value.first);
+    std::lock_guard lock(s.mutex);
+    return s.map.insert(value).second;
+}
+
+template <typename K, typename M, typename H>
+std::optional<M> ShardedHashMap<K, M, H>::find(const K& key) const {
+    const auto& s = shard_for(key);
+    std::lock_guard lock(s.mutex);
+    auto found = s.map.find(key);
+    return found != s.map.end() ? std::optional<M>(found->second) : std::nullopt;
+}
+
+template <typename K, typename M, typename H>
+bool ShardedHashMap<K, M, H>::contains(const K& key) const {
+    const auto& s = shard_for(key);
+    std::lock_guard lock(s.mutex);
+    return s.map.contains(key);
+}
+
+template <typename K, typename M, typename H>
+template <typename Fn>
+bool ShardedHashMap<K, M, H>::update(const K& key, Fn&& fn) {
+    auto& s = shard_for(key);
+    std::lock_guard lock(s.mutex);
+    auto found = s.map.find(key);
+    if (found == s.map.end()) return false;
+    std::forward<Fn>(fn)(found->second);
+    return true;
+}
+
+template <typename K, typename M, typename H>
+template <typename Fn>
+void ShardedHashMap<K, M, H>::upsert(const K& key, Fn&& fn) {
+    auto& s = shard_for(key);
+    std::lock_guard lock(s.mutex);
+    std::forward<Fn>(fn)(s.map[key]);
+}
+
+template <typename K, typename M, typename H>
+bool ShardedHashMap<K, M, H>::erase(const K& key) {
+    auto& s = shard_for(key);
+    std::lock_guard lock(s.mutex);
+    return s.map.erase(key);
+}
+
+template <typename K, typename M, typename H>
+void ShardedHashMap<K, M, H>::clear() {
+    for (size_t i = 0; i < _shard_count; ++i) {
+        std::lock_guard lock(_shards[i].mutex);
+        _shards[i].map.clear();
+    }
+}
+
+template <typename K, typename M, typename H>
+template <typename Fn>
+void ShardedHashMap<K, M, H>::for_each_shard(Fn&& fn, size_t threads) {
+    visit_shards(*this, fn, threads);
+}
+
+template <typename K, typename M, typename H>
+template <typename Fn>
+void ShardedHashMap<K, M, H>::for_each_shard(Fn&& fn, size_t threads) const {
+    visit_shards(*this, fn, threads);
+}
+
+template <typename K, typename M, typename H>
+template <typename Fn>
+decltype(auto) ShardedHashMap<K, M, H>::with_shard(size_t index, Fn&& fn) {
+    std::lock_guard lock(_shards[index].mutex);
+    return std::forward<Fn>(fn)(_shards[index].map);
+}
+
+template <typename K, typename M, typename H>
+template <typename Fn>
+decltype(auto) ShardedHashMap<K, M, H>::with_shard(size_t index, Fn&& fn) const {
+    std::lock_guard lock(_shards[index].mutex);
+    return std::forward<Fn>(fn)(static_cast<const shard_type&>(_shards[index].map));
+}
+
+template <typename K, typename M, typename H>
+size_t ShardedHashMap<K, M, H>::default_shard_count() noexcept {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+template <typename K, typename M, typename H>
+typename ShardedHashMap<K, M, H>::shard& ShardedHashMap<K, M, H>::shard_for(const K& key) const {
+    return _shards[shard_index(key)];
+}
+
+/*
+* Shared by both for_each_shard overloads. Self is ShardedHashMap or const ShardedHashMap,
+* so fn gets a const shard_type& from the const overload.
+*/
+template <typename K, typename M, typename H>
+template <typename Self, typename Fn>
+void ShardedHashMap<K, M, H>::visit_shards(Self& self, Fn& fn, size_t threads) {
+    std::atomic<size_t> next_shard = 0;
+    std::atomic<bool> failed = false;
+    std::exception_ptr error;
+    auto work = [&] {
+        for (size_t i = next_shard++; i < self._shard_count && !failed; i = next_shard++) {
+            try {
+                self.with_shard(i, fn);
+            } catch (...) {
+                if (!failed.exchange(true)) error = std::current_exception();
+            }
+        }
+    };
+
+    // as in HashMap::run_on_threads, a thread that can't be started is no error: the
+    // threads that did start (the calling one at least) take the shards it would have.
+    // Anything else thrown here joins the started threads before it propagates.
+    std::vector<std::thread> pool;
+    size_t extra_threads = std::min(std::max<size_t>(threads, 1), self._shard_count) - 1;
+    pool.reserve(extra_threads);
+    try {
+        for (size_t t = 0; t < extra_threads; ++t) {
+            pool.emplace_back(work);
+        }
+    } catch (const std::system_error&) {
+    } catch (...) {
+        failed = true;
+        for (auto& thread : pool) {
+            thread.join();
+        }
+        throw;
+    }
+    work(); // the calling thread takes shards too
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+#endif // HASHMAP_SHARDED_H
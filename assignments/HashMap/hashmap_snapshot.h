@@ -0,0 +1,560 @@
+/*
+* Assignment 2 (extension): HashMap snapshots
+*
+* save_snapshot writes a HashMap to a file in a layout that can be used exactly as it
+* sits on disk, and MappedHashMap maps such a file into memory and answers lookups and
+* iteration straight from the mapping. Opening a snapshot costs a few system calls
+* however large it is: nothing is parsed, hashed or allocated per element, and pages
+* are only read in when a lookup touches them. Every process that maps the same file
+* shares one copy of it in the page cache.
+*/
+
+#ifndef HASHMAP_SNAPSHOT_H
+#define HASHMAP_SNAPSHOT_H
+
+#include <algorithm>        // for std::max
+#include <cerrno>           // for errno
+#include <cstdint>          // for uint32_t, uint64_t
+#include <cstdio>           // for std::rename, std::remove
+#include <cstring>          // for std::memcmp
+#include <fstream>          // for std::ofstream, and std::ifstream without mmap
+#include <functional>       // for std::hash
+#include <iterator>         // for std::forward_iterator_tag
+#include <stdexcept>        // for std::out_of_range, std::runtime_error
+#include <string>           // for std::string
+#include <string_view>      // for the keys of a snapshot with std::string keys
+#include <system_error>     // for std::system_error
+#include <type_traits>      // for std::is_trivially_copyable_v
+#include <utility>          // for std::pair, std::exchange
+#include <vector>           // for the sections while writing
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>          // for open
+#include <sys/mman.h>       // for mmap, munmap
+#include <sys/stat.h>       // for fstat
+#include <unistd.h>         // for close
+#define HASHMAP_SNAPSHOT_MMAP 1
+#endif
+#include "hashmap.h"
+
+/*
+* How a snapshot stores keys of type K. std::string keys go into one blob of characters
+* and come back as std::string_views into the mapping. Any other key type must be
+* trivially copyable, and is stored and handed back as is.
+*/
+template <typename K>
+struct snapshot_key_traits {
+    using view_type = K;
+    static constexpr uint32_t key_size = sizeof(K);
+};
+
+template <>
+struct snapshot_key_traits<std::string> {
+    using view_type = std::string_view;
+    static constexpr uint32_t key_size = 0;
+};
+
+/*
+* The first bytes of every snapshot. Every offset is from the start of the file, so the
+* file means the same thing wherever it is mapped. The sections that follow are:
+*      buckets      - bucket_count + 1 entry numbers. The entries of bucket b are
+*                     [buckets[b], buckets[b + 1]), so entries are stored bucket by bucket.
+*      hashes       - size hash codes, one per entry.
+*      key_offsets  - (std::string keys only) size + 1 offsets into the key blob. Entry i's
+*                     key is the characters [key_offsets[i], key_offsets[i + 1]).
+*      values       - size mapped values, one per entry.
+*      keys         - the key blob, or size keys for other key types.
+* Sections start on 8-byte boundaries. Numbers are in the byte order of the machine that
+* wrote the file, so a snapshot is only readable on machines like it.
+*/
+struct snapshot_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t key_size;          // snapshot_key_traits<K>::key_size
+    uint32_t mapped_size;       // sizeof(M)
+    uint32_t reserved;
+    uint64_t size;
+    uint64_t bucket_count;      // a power of two, indexed with fibonacci_indexing
+    uint64_t buckets_offset;
+    uint64_t hashes_offset;
+    uint64_t key_offsets_offset;
+    uint64_t values_offset;
+    uint64_t keys_offset;
+    uint64_t file_size;
+
+    static constexpr char kMagic[8] = {'H', 'M', 'S', 'N', 'A', 'P', '\0', '\0'};
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint64_t kAlignment = 8;
+
+    static uint64_t align(uint64_t offset) noexcept {
+        return (offset + kAlignment - 1) / kAlignment * kAlignment;
+    }
+};
+
+/*
+* Writes every element of map to a snapshot file at path, replacing any file there.
+* The file is written next to path and then renamed over it, so a process that already
+* maps the old snapshot keeps reading the old one, and no reader ever sees half a file.
+*
+* SnapshotHash hashes the keys (as snapshot_key_traits<K>::view_type) into the file's
+* buckets. MappedHashMap hashes lookups with it, so the two must use the same function,
+* and it must give the same codes in every process that reads the file (std::hash for
+* strings and integers does with the same standard library).
+*
+* Usage:
+*      HashMap<std::string, int> counts = count_words(corpus);
+*      save_snapshot(counts, "counts.snap");
+*
+* Complexity: O(N + total key length) time and memory.
+*
+* Exceptions: std::system_error or std::runtime_error if the file can't be written.
+*
+* Notes: M must be trivially copyable, and K must be std::string or trivially copyable.
+*/
+template <typename K, typename M, typename H, typename S, typename A,
+          typename SnapshotHash = std::hash<typename snapshot_key_traits<K>::view_type>>
+void save_snapshot(const HashMap<K, M, H, S, A>& map, const std::string& path,
+                   const SnapshotHash& hash = SnapshotHash()) {
+    using traits = snapshot_key_traits<K>;
+    static_assert(std::is_trivially_copyable_v<M>, "save_snapshot: M must be trivially copyable");
+    static_assert(traits::key_size == 0 || std::is_trivially_copyable_v<K>,
+                  "save_snapshot: K must be std::string or trivially copyable");
+
+    // place the elements bucket by bucket: count them, then hand out positions
+    uint64_t size = map.size();
+    uint64_t bucket_count = fibonacci_indexing::bucket_count(std::max<uint64_t>(size, 1));
+    std::vector<uint64_t> buckets(bucket_count + 1, 0);
+    std::vector<uint64_t> element_hashes;
+    element_hashes.reserve(size);
+    for (const auto& [key, mapped] : map) {
+        element_hashes.push_back(hash(typename traits::view_type(key)));
+        ++buckets[fibonacci_indexing::index(element_hashes.back(), bucket_count) + 1];
+    }
+    for (uint64_t b = 0; b < bucket_count; ++b) {
+        buckets[b + 1] += buckets[b];
+    }
+    std::vector<uint64_t> hashes(size);
+    std::vector<const std::pair<const K, M>*> order(size);
+    std::vector<uint64_t> next(buckets.begin(), buckets.end() - 1);
+    size_t i = 0;
+    for (const auto& element : map) {
+        uint64_t position = next[fibonacci_indexing::index(element_hashes[i], bucket_count)]++;
+        hashes[position] = element_hashes[i++];
+        order[position] = &element;
+    }
+
+    std::vector<uint64_t> key_offsets;
+    uint64_t keys_length = size * traits::key_size;
+    if constexpr (traits::key_size == 0) {
+        key_offsets.reserve(size + 1);
+        key_offsets.push_back(0);
+        for (const auto* element : order) {
+            key_offsets.push_back(key_offsets.back() + element->first.size());
+        }
+        keys_length = key_offsets.back();
+    }
+
+    snapshot_header header{};
+    std::copy(std::begin(snapshot_header::kMagic), std::end(snapshot_header::kMagic), header.magic);
+    header.version = snapshot_header::kVersion;
+    header.key_size = traits::key_size;
+    header.mapped_size = sizeof(M);
+    header.size = size;
+    header.bucket_count = bucket_count;
+    header.buckets_offset = snapshot_header::align(sizeof(snapshot_header));
+    header.hashes_offset = snapshot_header::align(header.buckets_offset + buckets.size() * sizeof(uint64_t));
+    header.key_offsets_offset = snapshot_header::align(header.hashes_offset + size * sizeof(uint64_t));
+    header.values_offset = snapshot_header::align(header.key_offsets_offset + key_offsets.size() * sizeof(uint64_t));
+    header.keys_offset = snapshot_header::align(header.values_offset + size * sizeof(M));
+    header.file_size = header.keys_offset + keys_length;
+
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        uint64_t written = 0;
+        auto write = [&](uint64_t offset, const void* data, uint64_t length) {
+            static const char padding[snapshot_header::kAlignment] = {};
+            out.write(padding, offset - written);
+            out.write(static_cast<const char*>(data), length);
+            written = offset + length;
+        };
+        write(0, &header, sizeof(header));
+        write(header.buckets_offset, buckets.data(), buckets.size() * sizeof(uint64_t));
+        write(header.hashes_offset, hashes.data(), size * sizeof(uint64_t));
+        write(header.key_offsets_offset, key_offsets.data(), key_offsets.size() * sizeof(uint64_t));
+        write(header.values_offset, nullptr, 0);
+        for (const auto* element : order) {
+            out.write(reinterpret_cast<const char*>(&element->second), sizeof(M));
+        }
+        written += size * sizeof(M);
+        write(header.keys_offset, nullptr, 0);
+        for (const auto* element : order) {
+            if constexpr (traits::key_size == 0) {
+                out.write(element->first.data(), element->first.size());
+            } else {
+                out.write(reinterpret_cast<const char*>(&element->first), sizeof(K));
+            }
+        }
+        out.close();
+        if (!out) {
+            std::remove(temp_path.c_str());
+            throw std::runtime_error("save_snapshot: cannot write " + temp_path);
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        int error = errno;
+        std::remove(temp_path.c_str());
+        throw std::system_error(error, std::generic_category(), "save_snapshot: cannot rename to " + path);
+    }
+}
+
+/*
+* Template class for a read-only map over a snapshot written by save_snapshot.
+*
+* K, M and H must be the key type, mapped type and SnapshotHash the snapshot was saved
+* with. Keys come back as snapshot_key_traits<K>::view_type: a std::string_view into the
+* mapping for std::string keys, the key itself otherwise. Mapped values come back as
+* const M& into the mapping.
+*
+* The file is mapped read-only and shared, so any number of processes can map the same
+* snapshot and share its pages. On systems without mmap the file is read into memory
+* instead, which keeps the interface but not the zero-copy startup.
+*
+* Usage:
+*      MappedHashMap<std::string, int> counts("counts.snap");
+*      if (counts.contains("Avery")) std::cout << counts.at("Avery");
+*      for (auto [word, count] : counts) {...}
+*
+* Notes: only the header is checked when the file is opened; the rest is trusted, so
+* never open a snapshot that something other than save_snapshot could have written.
+* Overwriting the file with save_snapshot is safe, since it replaces the file instead of
+* writing into it; writing into a mapped snapshot in place is not.
+*/
+template <typename K, typename M, typename H = std::hash<typename snapshot_key_traits<K>::view_type>>
+class MappedHashMap {
+    using traits = snapshot_key_traits<K>;
+
+public:
+    using key_type = typename traits::view_type;
+    using mapped_type = M;
+    using value_type = std::pair<key_type, const M&>;
+
+    /*
+    * Forward iterator over the elements, bucket by bucket. Dereferencing builds a
+    * value_type that refers into the mapping, so it is returned by value.
+    */
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = MappedHashMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = value_type;
+
+        /*
+        * Holds the pair operator-> points into, since there is no pair in the mapping.
+        */
+        struct pointer {
+            value_type pair;
+            const value_type* operator->() const noexcept { return &pair; }
+        };
+
+        reference operator*() const { return {_map->key_at(_index), _map->_values[_index]}; }
+        pointer operator->() const { return {**this}; }
+
+        const_iterator& operator++() {
+            ++_index;
+            return *this;
+        }
+        const_iterator operator++(int) {
+            auto copy = *this;
+            ++_index;
+            return copy;
+        }
+
+        friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) { return lhs._index == rhs._index; }
+        friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) { return !(lhs == rhs); }
+
+    private:
+        friend class MappedHashMap;
+        const_iterator(const MappedHashMap* map, size_t index) : _map(map), _index(index) { }
+
+        const MappedHashMap* _map;
+        size_t _index;
+    };
+    using iterator = const_iterator;
+
+    /*
+    * Maps the snapshot at path.
+    *
+    * Exceptions: std::system_error if the file can't be opened or mapped, and
+    * std::runtime_error if it is not a snapshot of this K and M.
+    */
+    explicit MappedHashMap(const std::string& path, const H& hash = H());
+
+    /*
+    * Movable but not copyable, since the map owns its mapping. A moved-from map is empty.
+    */
+    MappedHashMap(const MappedHashMap&) = delete;
+    MappedHashMap& operator=(const MappedHashMap&) = delete;
+    MappedHashMap(MappedHashMap&& rhs) noexcept;
+    MappedHashMap& operator=(MappedHashMap&& rhs) noexcept;
+    ~MappedHashMap();
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+    size_t bucket_count() const noexcept;
+
+    /*
+    * Lookups, as for HashMap. Each hashes key once and compares it only with the keys
+    * in its bucket whose hash code matches.
+    *
+    * Complexity: O(1) average, plus reading the pages the bucket lives on.
+    */
+    bool contains(const key_type& key) const;
+    const_iterator find(const key_type& key) const;
+    const M& at(const key_type& key) const;
+
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+
+private:
+    static_assert(std::is_trivially_copyable_v<M>, "MappedHashMap: M must be trivially copyable");
+    static_assert(alignof(M) <= snapshot_header::kAlignment && alignof(K) <= snapshot_header::kAlignment,
+                  "MappedHashMap: K and M must fit the snapshot's 8-byte alignment");
+
+    void attach(const char* data, size_t length);
+    void release() noexcept;
+    key_type key_at(size_t index) const noexcept;
+    size_t find_index(const key_type& key) const;
+
+    /*
+    * _data is the whole file: mapped (_mapped = true), or read into _buffer without mmap.
+    * The other pointers are the sections of the file, see snapshot_header.
+    */
+    const char* _data = nullptr;
+    size_t _length = 0;
+    bool _mapped = false;
+    std::vector<uint64_t> _buffer;
+
+    size_t _size = 0;
+    size_t _bucket_count = 0;
+    const uint64_t* _buckets = nullptr;
+    const uint64_t* _hashes = nullptr;
+    const uint64_t* _key_offsets = nullptr;
+    const M* _values = nullptr;
+    const char* _keys = nullptr;
+    H _hash_function;
+};
+
+template <typename K, typename M, typename H>
+MappedHashMap<K, M, H>::MappedHashMap(const std::string& path, const H& hash) : _hash_function{hash} {
+#ifdef HASHMAP_SNAPSHOT_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "MappedHashMap: cannot open " + path);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), "MappedHashMap: cannot stat " + path);
+    }
+    size_t length = static_cast<size_t>(info.st_size);
+    void* data = length == 0 ? MAP_FAILED : ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    int error = errno;
+    ::close(fd); // the mapping keeps the file open
+    if (length == 0) {
+        throw std::runtime_error("MappedHashMap: " + path + " is empty");
+    }
+    if (data == MAP_FAILED) {
+        throw std::system_error(error, std::generic_category(), "MappedHashMap: cannot map " + path);
+    }
+    _mapped = true;
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        throw std::system_error(errno, std::generic_category(), "MappedHashMap: cannot open " + path);
+    }
+    size_t length = static_cast<size_t>(in.tellg());
+    _buffer.resize((length + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(_buffer.data()), length);
+    const void* data = _buffer.data();
+#endif
+    try {
+        attach(static_cast<const char*>(data), length);
+    } catch (...) {
+        _data = static_cast<const char*>(data);
+        _length = length;
+        release();
+        throw;
+    }
+}
+
+template <typename K, typename M, typename H>
+MappedHashMap<K, M, H>::MappedHashMap(MappedHashMap&& rhs) noexcept :
+    _data{std::exchange(rhs._data, nullptr)},
+    _length{std::exchange(rhs._length, 0)},
+    _mapped{std::exchange(rhs._mapped, false)},
+    _buffer{std::move(rhs._buffer)},
+    _size{std::exchange(rhs._size, 0)},
+    _bucket_count{std::exchange(rhs._bucket_count, 0)},
+    _buckets{rhs._buckets},
+    _hashes{rhs._hashes},
+    _key_offsets{rhs._key_offsets},
+    _values{rhs._values},
+    _keys{rhs._keys},
+    _hash_function{std::move(rhs._hash_function)} { }
+
+template <typename K, typename M, typename H>
+MappedHashMap<K, M, H>& MappedHashMap<K, M, H>::operator=(MappedHashMap&& rhs) noexcept {
+    if (this != &rhs) {
+        release();
+        _data = std::exchange(rhs._data, nullptr);
+        _length = std::exchange(rhs._length, 0);
+        _mapped = std::exchange(rhs._mapped, false);
+        _buffer = std::move(rhs._buffer);
+        _size = std::exchange(rhs._size, 0);
+        _bucket_count = std::exchange(rhs._bucket_count, 0);
+        _buckets = rhs._buckets;
+        _hashes = rhs._hashes;
+        _key_offsets = rhs._key_offsets;
+        _values = rhs._values;
+        _keys = rhs._keys;
+        _hash_function = std::move(rhs._hash_function);
+    }
+    return *this;
+}
+
+template <typename K, typename M, typename H>
+MappedHashMap<K, M, H>::~MappedHashMap() {
+    release();
+}
+
+template <typename K, typename M, typename H>
+size_t MappedHashMap<K, M, H>::size() const noexcept {
+    return _size;
+}
+
+template <typename K, typename M, typename H>
+bool MappedHashMap<K, M, H>::empty() const noexcept {
+    return size() == 0;
+}
+
+template <typename K, typename M, typename H>
+size_t MappedHashMap<K, M, H>::bucket_count() const noexcept {
+    return _bucket_count;
+}
+
+template <typename K, typename M, typename H>
+bool MappedHashMap<K, M, H>::contains(const key_type& key) const {
+    return find_index(key) != _size;
+}
+
+template <typename K, typename M, typename H>
+typename MappedHashMap<K, M, H>::const_iterator MappedHashMap<K, M, H>::find(const key_type& key) const {
+    return const_iterator(this, find_index(key));
+}
+
+template <typename K, typename M, typename H>
+const M& MappedHashMap<K, M, H>::at(const key_type& key) const {
+    size_t index = find_index(key);
+    if (index == _size) {
+        throw std::out_of_range("MappedHashMap::at: key not found");
+    }
+    return _values[index];
+}
+
+template <typename K, typename M, typename H>
+typename MappedHashMap<K, M, H>::const_iterator MappedHashMap<K, M, H>::begin() const noexcept {
+    return const_iterator(this, 0);
+}
+
+template <typename K, typename M, typename H>
+typename MappedHashMap<K, M, H>::const_iterator MappedHashMap<K, M, H>::end() const noexcept {
+    return const_iterator(this, _size);
+}
+
+/*
+* Checks the header against K, M and the file's length, and points the sections into data.
+*/
+template <typename K, typename M, typename H>
+void MappedHashMap<K, M, H>::attach(const char* data, size_t length) {
+    snapshot_header header;
+    if (length < sizeof(header)) {
+        throw std::runtime_error("MappedHashMap: file is too short to be a snapshot");
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, snapshot_header::kMagic, sizeof(header.magic)) != 0 ||
+        header.version != snapshot_header::kVersion) {
+        throw std::runtime_error("MappedHashMap: not a snapshot, or from another version");
+    }
+    if (header.key_size != traits::key_size || header.mapped_size != sizeof(M)) {
+        throw std::runtime_error("MappedHashMap: snapshot has different key or mapped types");
+    }
+    uint64_t key_offsets = traits::key_size == 0 ? header.size + 1 : 0;
+    bool fits = header.buckets_offset >= sizeof(header) &&
+                header.buckets_offset + (header.bucket_count + 1) * sizeof(uint64_t) <= header.hashes_offset &&
+                header.hashes_offset + header.size * sizeof(uint64_t) <= header.key_offsets_offset &&
+                header.key_offsets_offset + key_offsets * sizeof(uint64_t) <= header.values_offset &&
+                header.values_offset + header.size * sizeof(M) <= header.keys_offset &&
+                header.keys_offset <= header.file_size;
+    if (header.file_size != length || !fits ||
+        header.bucket_count == 0 || (header.bucket_count & (header.bucket_count - 1)) != 0) {
+        throw std::runtime_error("MappedHashMap: snapshot is truncated or corrupt");
+    }
+
+    _data = data;
+    _length = length;
+    _size = header.size;
+    _bucket_count = header.bucket_count;
+    _buckets = reinterpret_cast<const uint64_t*>(data + header.buckets_offset);
+    _hashes = reinterpret_cast<const uint64_t*>(data + header.hashes_offset);
+    _key_offsets = reinterpret_cast<const uint64_t*>(data + header.key_offsets_offset);
+    _values = reinterpret_cast<const M*>(data + header.values_offset);
+    _keys = data + header.keys_offset;
+}
+
+template <typename K, typename M, typename H>
+void MappedHashMap<K, M, H>::release() noexcept {
+#ifdef HASHMAP_SNAPSHOT_MMAP
+    if (_mapped) {
+        ::munmap(const_cast<char*>(_data), _length);
+    }
+#endif
+    _buffer.clear();
+    _data = nullptr;
+    _mapped = false;
+    _size = 0;
+    _bucket_count = 0;
+}
+
+template <typename K, typename M, typename H>
+typename MappedHashMap<K, M, H>::key_type MappedHashMap<K, M, H>::key_at(size_t index) const noexcept {
+    if constexpr (traits::key_size == 0) {
+        return key_type(_keys + _key_offsets[index], _key_offsets[index + 1] - _key_offsets[index]);
+    } else {
+        K key;
+        std::memcpy(&key, _keys + index * sizeof(K), sizeof(K));
+        return key;
+    }
+}
+
+/*
+* Returns the index of key's entry, or _size if key is not in the snapshot.
+*/
+template <typename K, typename M, typename H>
+size_t MappedHashMap<K, M, H>::find_index(const key_type& key) const {
+    if (_bucket_count == 0) {
+        return _size;
+    }
+    uint64_t hash = _hash_function(key);
+    size_t bucket = fibonacci_indexing::index(hash, _bucket_count);
+    for (uint64_t i = _buckets[bucket]; i < _buckets[bucket + 1]; ++i) {
+        if (_hashes[i] == hash && key_at(i) == key) {
+            return i;
+        }
+    }
+    return _size;
+}
+
+#endif // HASHMAP_SNAPSHOT_H
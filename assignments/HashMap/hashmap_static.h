@@ -0,0 +1,206 @@
+/*
+* Assignment 2 (extension): StaticHashMap
+*
+* A fixed-capacity, read-only map whose table is built by a constexpr constructor, for
+* keyword and opcode tables known when the program is compiled. Declared constexpr, it
+* is laid out by the compiler as constant data: nothing is allocated or run before
+* main, and a lookup of a literal key in a constant expression folds to its value.
+*/
+
+#ifndef HASHMAP_STATIC_H
+#define HASHMAP_STATIC_H
+
+#include <array>            // for the element and index arrays
+#include <cstdint>          // for uint64_t
+#include <initializer_list> // for std::initializer_list
+#include <stdexcept>        // for std::out_of_range, std::length_error
+#include <string_view>      // for constexpr_hash<std::string_view>
+#include <type_traits>      // for std::is_integral, std::is_enum
+#include <utility>          // for std::pair
+
+/*
+* A hash function usable in constant expressions, which std::hash is not.
+*
+* The primary template hashes integers and enums with the SplitMix64 finalizer. The
+* std::string_view specialization is 64-bit FNV-1a; string literals and std::strings
+* convert to it, so a StaticHashMap<std::string_view, M> can be searched with either.
+*/
+template <typename K>
+struct constexpr_hash {
+    static_assert(std::is_integral_v<K> || std::is_enum_v<K>,
+                  "constexpr_hash: supply a constexpr hash function for this key type");
+
+    constexpr size_t operator()(K key) const noexcept {
+        uint64_t x = static_cast<uint64_t>(key);
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return static_cast<size_t>(x ^ (x >> 31));
+    }
+};
+
+template <>
+struct constexpr_hash<std::string_view> {
+    constexpr size_t operator()(std::string_view key) const noexcept {
+        uint64_t x = 14695981039346656037ull;
+        for (char c : key) {
+            x = (x ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+        return static_cast<size_t>(x);
+    }
+};
+
+/*
+* Template class for a fixed-capacity map built at compile time.
+*
+* Holds at most N elements. Like hashmap_dense.h, the elements sit in one array in the
+* order they were given, and a separate index of 2N to 4N slots (a power of two, so at
+* most half full) holds each element's position, found by linear probing from the key's
+* hash. Both arrays live inside the object, so the map needs no allocator.
+*
+* Usage:
+*      constexpr StaticHashMap<std::string_view, int, 3> keywords{{"if", 1}, {"else", 2}, {"while", 3}};
+*      static_assert(keywords.at("else") == 2);        // folded by the compiler
+*      if (keywords.contains(token)) ...               // an ordinary lookup at run time
+*
+* Notes: as with HashMap's initializer list constructor, a repeated key keeps its
+* first value. Naming more than N elements is a compile error in a constexpr
+* declaration, and throws std::length_error otherwise; so does at() with a key that
+* isn't there. Elements are stored as pair<K, M> so that the constructor can assign
+* them at compile time, but are only reachable through const references.
+*/
+template <typename K, typename M, size_t N, typename H = constexpr_hash<K>>
+class StaticHashMap {
+public:
+    using value_type = std::pair<K, M>;
+    using const_iterator = const value_type*;
+    using iterator = const_iterator;
+
+    /*
+    * Builds a map with the elements in init, hashed with hash.
+    *
+    * Complexity: O(N) expected, at compile time for a constexpr map.
+    *
+    * Exceptions: std::length_error if init holds more than N distinct keys.
+    */
+    constexpr StaticHashMap(std::initializer_list<std::pair<const K, M>> init, const H& hash = H());
+
+    constexpr size_t size() const noexcept;
+    constexpr bool empty() const noexcept;
+    static constexpr size_t capacity() noexcept;
+
+    /*
+    * Lookups, as for HashMap.
+    *
+    * Complexity: O(1) expected.
+    */
+    constexpr bool contains(const K& key) const;
+    constexpr const_iterator find(const K& key) const;
+    constexpr const M& at(const K& key) const;
+
+    constexpr const_iterator begin() const noexcept;
+    constexpr const_iterator end() const noexcept;
+
+private:
+    /*
+    * The smallest power of two at least 2N, so the index is at most half full and
+    * every probe sequence is short and ends at an empty slot.
+    */
+    static constexpr size_t table_size() noexcept {
+        size_t size = 2;
+        while (size < 2 * N) size *= 2;
+        return size;
+    }
+
+    static constexpr size_t kEmpty = static_cast<size_t>(-1);
+    static constexpr size_t kTableSize = table_size();
+
+    /*
+    * Returns the index slot holding key, or the empty slot where it would go.
+    */
+    constexpr size_t probe(const K& key) const;
+
+    /*
+    * _elements[0, _size) holds the elements in the order given. _index[slot] is the
+    * position in _elements of the key in that slot, or kEmpty.
+    */
+    std::array<value_type, (N > 0 ? N : 1)> _elements{};
+    std::array<size_t, kTableSize> _index{};
+    size_t _size = 0;
+    H _hash_function;
+};
+
+template <typename K, typename M, size_t N, typename H>
+constexpr StaticHashMap<K, M, N, H>::StaticHashMap(std::initializer_list<std::pair<const K, M>> init,
+                                                   const H& hash) : _hash_function{hash} {
+    for (size_t slot = 0; slot < kTableSize; ++slot) {
+        _index[slot] = kEmpty;
+    }
+    for (const auto& [key, mapped] : init) {
+        size_t slot = probe(key);
+        if (_index[slot] != kEmpty) {
+            continue;
+        }
+        if (_size == N) {
+            throw std::length_error("StaticHashMap: more elements than its capacity");
+        }
+        _elements[_size].first = key;
+        _elements[_size].second = mapped;
+        _index[slot] = _size++;
+    }
+}
+
+template <typename K, typename M, size_t N, typename H>
+constexpr size_t StaticHashMap<K, M, N, H>::size() const noexcept {
+    return _size;
+}
+
+template <typename K, typename M, size_t N, typename H>
+constexpr bool StaticHashMap<K, M, N, H>::empty() const noexcept {
+    return _size == 0;
+}
+
+template <typename K, typename M, size_t N, typename H>
+constexpr size_t StaticHashMap<K, M, N, H>::capacity() noexcept {
+    return N;
+}
+
+template <typename K, typename M, size_t N, typename H>
+constexpr bool StaticHashMap<K, M, N, H>::contains(const K& key) const {
+    return find(key) != end();
+}
+
+template <typename K, typename M, size_t N, typename H>
+constexpr typename StaticHashMap<K, M, N, H>::const_iterator StaticHashMap<K, M, N, H>::find(const K& key) const {
+    size_t position = _index[probe(key)];
+    return position == kEmpty ? end() : begin() + position;
+}
+
+template <typename K, typename M, size_t N, typename H>
+constexpr const M& StaticHashMap<K, M, N, H>::at(const K& key) const {
+    size_t position = _index[probe(key)];
+    if (position == kEmpty) {
+        throw std::out_of_range("StaticHashMap::at: key not found");
+    }
+    return _elements[position].second;
+}
+
+template <typename K, typename M, size_t N, typename H>
+constexpr typename StaticHashMap<K, M, N, H>::const_iterator StaticHashMap<K, M, N, H>::begin() const noexcept {
+    return _elements.data();
+}
+
+template <typename K, typename M, size_t N, typename H>
+constexpr typename StaticHashMap<K, M, N, H>::const_iterator StaticHashMap<K, M, N, H>::end() const noexcept {
+    return _elements.data() + _size;
+}
+
+template <typename K, typename M, size_t N, typename H>
+constexpr size_t StaticHashMap<K, M, N, H>::probe(const K& key) const {
+    size_t slot = _hash_function(key) & (kTableSize - 1);
+    while (_index[slot] != kEmpty && !(_elements[_index[slot]].first == key)) {
+        slot = (slot + 1) & (kTableSize - 1);
+    }
+    return slot;
+}
+
+#endif // HASHMAP_STATIC_H
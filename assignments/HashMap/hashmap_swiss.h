@@ -0,0 +1,919 @@
+/*
+* Assignment 2 (extension): HashMap with the swiss_storage policy
+*
+* A flat, open-addressed layout for HashMap that keeps one control byte per slot,
+* in the style of Google's Swiss tables. The public interface is identical to the
+* chained HashMap in hashmap.h, so the comments there apply to every member
+* function declared below. This file only documents the layout and the places
+* where it behaves differently.
+*/
+
+#ifndef HASHMAP_SWISS_H
+#define HASHMAP_SWISS_H
+
+#include <algorithm>        // for std::max
+#include <cmath>            // for std::ceil
+#include <cstdint>          // for int8_t, uint32_t, uint64_t
+#include <new>              // for placement new
+#include <stdexcept>        // for std::out_of_range
+#include <tuple>            // for std::forward_as_tuple
+#include <utility>          // for std::piecewise_construct, std::forward
+#include <vector>           // for the control byte and slot arrays
+#if defined(__SSE2__)
+#include <emmintrin.h>      // for the SSE2 byte compares
+#endif
+#include "hashmap.h"
+
+/*
+* Template class for a HashMap using swiss_storage.
+*
+* Layout: elements live in a flat array of slots, and a parallel array holds
+* one control byte per slot:
+*      kEmpty   (0x80)          - the slot has never been used since the last rebuild
+*      kDeleted (0xFE)          - the slot held an element that was erased (a tombstone)
+*      0x00 - 0x7F              - the slot is full, and the byte is 7 bits of its key's hash
+*
+* The slots are split into groups of 16. A key's hash picks a starting group and
+* a 7-bit fragment. A lookup loads the group's 16 control bytes and compares all
+* of them with the fragment at once (one SSE2 compare, or a plain loop without
+* SSE2). Only slots whose byte matches have their key compared. The lookup stops
+* at the first group that has an empty slot. So almost every miss, and every hit
+* that isn't a fragment collision, finishes without comparing a wrong key.
+* Groups are probed quadratically, which visits every group once.
+*
+* Differences from chained_storage:
+*      - bucket_count() is the number of slots, a power of two (at least 16).
+*      - the table grows automatically before more than max_load_factor() of the
+*        slots are in use (full or tombstones). The default and the largest allowed
+*        value are both 7/8, since probing needs empty slots to stop at.
+*        rehash(n) rounds n up to a power of two that can hold size() elements.
+*      - insert invalidates iterators only when it grows the table. Erase never
+*        moves elements, so iterators to other elements stay valid.
+*
+* Usage:
+*      HashMap<std::string, int, std::hash<std::string>, swiss_storage> map;
+*      map.insert({"Avery", 3});
+*/
+template <typename K, typename M, typename H, typename A>
+class HashMap<K, M, H, swiss_storage, A> {
+    static_assert(std::is_same_v<A, std::allocator<std::pair<const K, M>>>,
+                  "HashMap: only chained_storage supports custom allocators");
+
+public:
+    using value_type = std::pair<const K, M>;
+    using allocator_type = A;
+    using iterator = HashMapIterator<HashMap, false>;
+    using const_iterator = HashMapIterator<HashMap, true>;
+
+    friend class HashMapIterator<HashMap, false>;
+    friend class HashMapIterator<HashMap, true>;
+
+    template <typename KeyLike>
+    using if_transparent = std::enable_if_t<is_transparent_hash<H>::value &&
+                                            !std::is_convertible_v<const KeyLike&, iterator> &&
+                                            !std::is_convertible_v<const KeyLike&, const_iterator>>;
+
+    HashMap();
+    explicit HashMap(size_t bucket_count, const H& hash = H());
+
+    template <typename InputIt>
+    HashMap(InputIt first, InputIt last, size_t bucket_count = kDefaultBuckets, const H& hash = H());
+    HashMap(std::initializer_list<value_type> init, size_t bucket_count = kDefaultBuckets, const H& hash = H());
+    template <typename InputIt>
+    static HashMap from_unique_range(InputIt first, InputIt last, const H& hash = H(),
+                                     const allocator_type& alloc = allocator_type());
+
+    HashMap(const HashMap& rhs);
+    HashMap& operator=(const HashMap& rhs);
+    HashMap(HashMap&& rhs);
+    HashMap& operator=(HashMap&& rhs);
+    ~HashMap();
+
+    inline size_t size() const noexcept;
+    inline bool empty() const noexcept;
+    inline float load_factor() const noexcept;
+    inline size_t bucket_count() const noexcept;
+    allocator_type get_allocator() const noexcept;
+    H hash_function() const;
+    float max_load_factor() const noexcept;
+    void max_load_factor(float ml);
+    void reserve(size_t count);
+
+    bool contains(const K& key) const noexcept;
+    M& at(const K& key);
+    const M& at(const K& key) const;
+    M& operator[](const K& key);
+    M& operator[](K&& key);
+
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    bool contains(const KeyLike& key) const noexcept;
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    M& at(const KeyLike& key);
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    const M& at(const KeyLike& key) const;
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    M& operator[](const KeyLike& key);
+
+    iterator find(const K& key);
+    const_iterator find(const K& key) const;
+    std::pair<iterator, bool> insert(const value_type& value);
+    std::pair<iterator, bool> insert(value_type&& value);
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args);
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const K& key, Args&&... args);
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(K&& key, Args&&... args);
+    template <typename Obj>
+    std::pair<iterator, bool> insert_or_assign(const K& key, Obj&& obj);
+    template <typename Obj>
+    std::pair<iterator, bool> insert_or_assign(K&& key, Obj&& obj);
+    bool erase(const K& key);
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    iterator find(const KeyLike& key);
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    const_iterator find(const KeyLike& key) const;
+    template <typename KeyLike, typename = if_transparent<KeyLike>>
+    bool erase(const KeyLike& key);
+    iterator erase(const_iterator pos);
+    void clear() noexcept;
+
+    /*
+    * Rebuilds the table with at least new_buckets slots, rounded up to a power of two
+    * and to the capacity needed for size() elements. Also drops every tombstone.
+    *
+    * Exceptions: std::out_of_range if new_buckets = 0.
+    */
+    void rehash(size_t new_buckets);
+
+    iterator begin() noexcept;
+    iterator end() noexcept;
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+
+    /*
+    * Prints every slot with its control byte and element.
+    */
+    void debug() const;
+
+private:
+    /*
+    * Raw storage for one element. Whether it holds one is recorded in _ctrl,
+    * so the map constructs and destroys the value explicitly.
+    */
+    struct slot {
+        union { value_type value; };
+
+        slot() noexcept {}
+        ~slot() {}
+    };
+
+    /*
+    * HashMapIterator treats every slot as a bucket holding at most one node.
+    */
+    using node = slot;
+
+    /*
+    * The 16 control bytes of one group, with bitmask queries: bit i of the result
+    * is set if byte i matches.
+    */
+    class group {
+    public:
+        explicit group(const int8_t* ctrl) noexcept;
+        uint32_t match(int8_t fragment) const noexcept;
+        uint32_t match_empty() const noexcept;
+        uint32_t match_empty_or_deleted() const noexcept;
+
+    private:
+#if defined(__SSE2__)
+        __m128i _ctrl;
+#else
+        const int8_t* _ctrl;
+#endif
+    };
+
+    static std::pair<K, M> release(value_type& value) {
+        return {std::move(const_cast<K&>(value.first)), std::move(value.second)};
+    }
+
+    uint64_t mix(size_t hash) const noexcept;
+    size_t first_group(uint64_t mixed) const noexcept;
+    int8_t fragment(uint64_t mixed) const noexcept;
+
+    template <typename KeyLike>
+    size_t find_slot(const KeyLike& key, uint64_t mixed) const;
+    size_t find_insert_slot(uint64_t mixed) const;
+    void erase_slot(size_t index);
+    void rebuild(size_t new_capacity);
+    size_t growth_limit(size_t capacity) const noexcept;
+    size_t min_capacity(size_t count) const noexcept;
+    template <typename KeyLike, typename... Args>
+    std::pair<iterator, bool> emplace_key(const KeyLike& key, Args&&... args);
+    template <typename... Args>
+    size_t emplace_new(uint64_t mixed, Args&&... args);
+    iterator make_iterator(size_t index);
+
+    size_t bucket_end() const noexcept;
+    size_t next_occupied(size_t bucket) const noexcept;
+    node* bucket_front(size_t bucket) noexcept;
+    static node* next_in_bucket(node* curr) noexcept;
+
+    size_t _size;
+    H _hash_function;
+
+    /*
+    * _capacity is the number of slots (a power of two, a multiple of kGroupWidth),
+    * and _shift is 64 - log2(number of groups). _growth_left counts how many more
+    * empty slots can be filled before the table must grow. A moved-from map
+    * has _capacity == 0 and no slots.
+    */
+    size_t _capacity;
+    int _shift;
+    size_t _growth_left;
+    std::vector<int8_t> _ctrl;
+    std::vector<slot> _slots;
+    float _max_load_factor;
+
+    static const size_t kDefaultBuckets = 10;
+    static constexpr size_t kGroupWidth = 16;
+    static constexpr int8_t kEmpty = -128;
+    static constexpr int8_t kDeleted = -2;
+    static constexpr float kMaxLoadFactor = 0.875f;
+    static constexpr uint64_t kFibonacciMultiplier = 11400714819323198485ull;
+};
+
+#if defined(__SSE2__)
+template <typename K, typename M, typename H, typename A>
+HashMap<K, M, H, swiss_storage, A>::group::group(const int8_t* ctrl) noexcept :
+    _ctrl{_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))} { }
+
+template <typename K, typename M, typename H, typename A>
+uint32_t HashMap<K, M, H, swiss_storage, A>::group::match(int8_t fragment) const noexcept {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(fragment), _ctrl));
+}
+
+template <typename K, typename M, typename H, typename A>
+uint32_t HashMap<K, M, H, swiss_storage, A>::group::match_empty() const noexcept {
+    return match(kEmpty);
+}
+
+// kEmpty and kDeleted are the only control bytes with the sign bit set
+template <typename K, typename M, typename H, typename A>
+uint32_t HashMap<K, M, H, swiss_storage, A>::group::match_empty_or_deleted() const noexcept {
+    return _mm_movemask_epi8(_ctrl);
+}
+#else
+template <typename K, typename M, typename H, typename A>
+HashMap<K, M, H, swiss_storage, A>::group::group(const int8_t* ctrl) noexcept : _ctrl{ctrl} { }
+
+template <typename K, typename M, typename H, typename A>
+uint32_t HashMap<K, M, H, swiss_storage, A>::group::match(int8_t fragment) const noexcept {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kGroupWidth; ++i) {
+        mask |= static_cast<uint32_t>(_ctrl[i] == fragment) << i;
+    }
+    return mask;
+}
+
+template <typename K, typename M, typename H, typename A>
+uint32_t HashMap<K, M, H, swiss_storage, A>::group::match_empty() const noexcept {
+    return match(kEmpty);
+}
+
+template <typename K, typename M, typename H, typename A>
+uint32_t HashMap<K, M, H, swiss_storage, A>::group::match_empty_or_deleted() const noexcept {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kGroupWidth; ++i) {
+        mask |= static_cast<uint32_t>(_ctrl[i] < 0) << i;
+    }
+    return mask;
+}
+#endif
+
+template <typename K, typename M, typename H, typename A>
+HashMap<K, M, H, swiss_storage, A>::HashMap() : HashMap{kDefaultBuckets} { }
+
+template <typename K, typename M, typename H, typename A>
+HashMap<K, M, H, swiss_storage, A>::HashMap(size_t bucket_count, const H& hash) :
+    _size{0},
+    _hash_function{hash},
+    _capacity{0},
+    _shift{64},
+    _growth_left{0},
+    _max_load_factor{kMaxLoadFactor} {
+    rebuild(bucket_count);
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename InputIt>
+HashMap<K, M, H, swiss_storage, A>::HashMap(InputIt first, InputIt last, size_t bucket_count, const H& hash) :
+    HashMap(bucket_count, hash) {
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+        reserve(std::distance(first, last));
+    }
+    for (auto iter = first; iter != last; ++iter) {
+        emplace_key(iter->first, *iter);
+    }
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename InputIt>
+HashMap<K, M, H, swiss_storage, A>
+HashMap<K, M, H, swiss_storage, A>::from_unique_range(InputIt first, InputIt last, const H& hash, const allocator_type&) {
+    HashMap map(kDefaultBuckets, hash);
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+        map.reserve(std::distance(first, last));
+    }
+    for (auto iter = first; iter != last; ++iter) {
+        map.emplace_new(map.mix(map._hash_function(iter->first)), *iter);
+    }
+    return map;
+}
+
+template <typename K, typename M, typename H, typename A>
+HashMap<K, M, H, swiss_storage, A>::HashMap(std::initializer_list<value_type> init, size_t bucket_count,
+    const H& hash) : HashMap(init.begin(), init.end(), bucket_count, hash) { }
+
+// the copy keeps rhs's exact layout (tombstones included), so nothing is rehashed
+template <typename K, typename M, typename H, typename A>
+HashMap<K, M, H, swiss_storage, A>::HashMap(const HashMap& rhs) :
+    _size{rhs._size},
+    _hash_function{rhs._hash_function},
+    _capacity{rhs._capacity},
+    _shift{rhs._shift},
+    _growth_left{rhs._growth_left},
+    _ctrl{rhs._ctrl},
+    _slots(rhs._slots.size()),
+    _max_load_factor{rhs._max_load_factor} {
+    for (size_t i = 0; i < _capacity; ++i) {
+        if (_ctrl[i] >= 0) {
+            new (&_slots[i].value) value_type(rhs._slots[i].value);
+        }
+    }
+}
+
+template <typename K, typename M, typename H, typename A>
+HashMap<K, M, H, swiss_storage, A>& HashMap<K, M, H, swiss_storage, A>::operator=(const HashMap& rhs) {
+    if (&rhs != this) {
+        *this = HashMap(rhs);
+    }
+    return *this;
+}
+
+template <typename K, typename M, typename H, typename A>
+HashMap<K, M, H, swiss_storage, A>::HashMap(HashMap&& rhs) :
+    _size{rhs._size},
+    _hash_function{std::move(rhs._hash_function)},
+    _capacity{rhs._capacity},
+    _shift{rhs._shift},
+    _growth_left{rhs._growth_left},
+    _ctrl{std::move(rhs._ctrl)},
+    _slots{std::move(rhs._slots)},
+    _max_load_factor{rhs._max_load_factor} {
+    rhs._size = 0;
+    rhs._capacity = 0;
+    rhs._growth_left = 0;
+    rhs._ctrl.clear();
+    rhs._slots.clear();
+}
+
+template <typename K, typename M, typename H, typename A>
+HashMap<K, M, H, swiss_storage, A>& HashMap<K, M, H, swiss_storage, A>::operator=(HashMap&& rhs) {
+    if (this != &rhs) {
+        clear();
+        _size = rhs._size;
+        _hash_function = std::move(rhs._hash_function);
+        _capacity = rhs._capacity;
+        _shift = rhs._shift;
+        _growth_left = rhs._growth_left;
+        _ctrl = std::move(rhs._ctrl);
+        _slots = std::move(rhs._slots);
+        _max_load_factor = rhs._max_load_factor;
+        rhs._size = 0;
+        rhs._capacity = 0;
+        rhs._growth_left = 0;
+        rhs._ctrl.clear();
+        rhs._slots.clear();
+    }
+    return *this;
+}
+
+template <typename K, typename M, typename H, typename A>
+HashMap<K, M, H, swiss_storage, A>::~HashMap() {
+    clear();
+}
+
+template <typename K, typename M, typename H, typename A>
+inline size_t HashMap<K, M, H, swiss_storage, A>::size() const noexcept {
+    return _size;
+}
+
+template <typename K, typename M, typename H, typename A>
+inline bool HashMap<K, M, H, swiss_storage, A>::empty() const noexcept {
+    return size() == 0;
+}
+
+template <typename K, typename M, typename H, typename A>
+inline float HashMap<K, M, H, swiss_storage, A>::load_factor() const noexcept {
+    return bucket_count() == 0 ? 0 : static_cast<float>(size())/bucket_count();
+}
+
+template <typename K, typename M, typename H, typename A>
+inline size_t HashMap<K, M, H, swiss_storage, A>::bucket_count() const noexcept {
+    return _capacity;
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, swiss_storage, A>::allocator_type
+HashMap<K, M, H, swiss_storage, A>::get_allocator() const noexcept {
+    return allocator_type();
+}
+
+template <typename K, typename M, typename H, typename A>
+H HashMap<K, M, H, swiss_storage, A>::hash_function() const {
+    return _hash_function;
+}
+
+template <typename K, typename M, typename H, typename A>
+float HashMap<K, M, H, swiss_storage, A>::max_load_factor() const noexcept {
+    return _max_load_factor;
+}
+
+template <typename K, typename M, typename H, typename A>
+void HashMap<K, M, H, swiss_storage, A>::max_load_factor(float ml) {
+    if (!(ml > 0)) {
+        throw std::out_of_range("HashMap<K, M, H, swiss_storage, A>::max_load_factor: ml must be positive.");
+    }
+    // slots in use (full or tombstones) stay in use under the new limit
+    size_t used = growth_limit(_capacity) - _growth_left;
+    _max_load_factor = std::min(ml, kMaxLoadFactor);
+    if (used > growth_limit(_capacity)) {
+        rebuild(min_capacity(_size));
+    } else {
+        _growth_left = growth_limit(_capacity) - used;
+    }
+}
+
+template <typename K, typename M, typename H, typename A>
+void HashMap<K, M, H, swiss_storage, A>::reserve(size_t count) {
+    if (count > _size + _growth_left) {
+        rebuild(std::max(_capacity, min_capacity(count)));
+    }
+}
+
+template <typename K, typename M, typename H, typename A>
+bool HashMap<K, M, H, swiss_storage, A>::contains(const K& key) const noexcept {
+    return find_slot(key, mix(_hash_function(key))) != _capacity;
+}
+
+template <typename K, typename M, typename H, typename A>
+M& HashMap<K, M, H, swiss_storage, A>::at(const K& key) {
+    size_t index = find_slot(key, mix(_hash_function(key)));
+    if (index == _capacity) {
+        throw std::out_of_range("HashMap<K, M, H, swiss_storage, A>::at: key not found");
+    }
+    return _slots[index].value.second;
+}
+
+template <typename K, typename M, typename H, typename A>
+const M& HashMap<K, M, H, swiss_storage, A>::at(const K& key) const {
+    // see static_cast/const_cast trick explained in hashmap.cpp.
+    return static_cast<const M&>(const_cast<HashMap*>(this)->at(key));
+}
+
+template <typename K, typename M, typename H, typename A>
+M& HashMap<K, M, H, swiss_storage, A>::operator[](const K& key) {
+    return try_emplace(key).first->second;
+}
+
+template <typename K, typename M, typename H, typename A>
+M& HashMap<K, M, H, swiss_storage, A>::operator[](K&& key) {
+    return try_emplace(std::move(key)).first->second;
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, swiss_storage, A>::iterator HashMap<K, M, H, swiss_storage, A>::find(const K& key) {
+    return make_iterator(find_slot(key, mix(_hash_function(key))));
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, swiss_storage, A>::const_iterator HashMap<K, M, H, swiss_storage, A>::find(const K& key) const {
+    // see static_cast/const_cast trick explained in hashmap.cpp.
+    return static_cast<const_iterator>(const_cast<HashMap*>(this)->find(key));
+}
+
+template <typename K, typename M, typename H, typename A>
+std::pair<typename HashMap<K, M, H, swiss_storage, A>::iterator, bool>
+HashMap<K, M, H, swiss_storage, A>::insert(const value_type& value) {
+    return emplace_key(value.first, value);
+}
+
+template <typename K, typename M, typename H, typename A>
+std::pair<typename HashMap<K, M, H, swiss_storage, A>::iterator, bool>
+HashMap<K, M, H, swiss_storage, A>::insert(value_type&& value) {
+    return emplace_key(value.first, std::move(value));
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename... Args>
+std::pair<typename HashMap<K, M, H, swiss_storage, A>::iterator, bool>
+HashMap<K, M, H, swiss_storage, A>::emplace(Args&&... args) {
+    // the key is part of the element, so build it first. Its key is copied, not moved,
+    // into the slot (it is const), so key stays valid while emplace_key moves element.
+    value_type element(std::forward<Args>(args)...);
+    return emplace_key(element.first, std::move(element));
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename... Args>
+std::pair<typename HashMap<K, M, H, swiss_storage, A>::iterator, bool>
+HashMap<K, M, H, swiss_storage, A>::try_emplace(const K& key, Args&&... args) {
+    return emplace_key(key, std::piecewise_construct, std::forward_as_tuple(key),
+                       std::forward_as_tuple(std::forward<Args>(args)...));
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename... Args>
+std::pair<typename HashMap<K, M, H, swiss_storage, A>::iterator, bool>
+HashMap<K, M, H, swiss_storage, A>::try_emplace(K&& key, Args&&... args) {
+    return emplace_key(key, std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                       std::forward_as_tuple(std::forward<Args>(args)...));
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename Obj>
+std::pair<typename HashMap<K, M, H, swiss_storage, A>::iterator, bool>
+HashMap<K, M, H, swiss_storage, A>::insert_or_assign(const K& key, Obj&& obj) {
+    auto result = try_emplace(key, std::forward<Obj>(obj));
+    if (!result.second) {
+        result.first->second = std::forward<Obj>(obj);
+    }
+    return result;
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename Obj>
+std::pair<typename HashMap<K, M, H, swiss_storage, A>::iterator, bool>
+HashMap<K, M, H, swiss_storage, A>::insert_or_assign(K&& key, Obj&& obj) {
+    auto result = try_emplace(std::move(key), std::forward<Obj>(obj));
+    if (!result.second) {
+        result.first->second = std::forward<Obj>(obj);
+    }
+    return result;
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike, typename... Args>
+std::pair<typename HashMap<K, M, H, swiss_storage, A>::iterator, bool>
+HashMap<K, M, H, swiss_storage, A>::emplace_key(const KeyLike& key, Args&&... args) {
+    uint64_t mixed = mix(_hash_function(key));
+    size_t index = find_slot(key, mixed);
+    if (index != _capacity) {
+        return {make_iterator(index), false};
+    }
+    return {make_iterator(emplace_new(mixed, std::forward<Args>(args)...)), true};
+}
+
+/*
+* Inserts a new element constructed from args, whose key (with mixed hash code mixed) must
+* not be in the map yet, and returns its slot.
+*/
+template <typename K, typename M, typename H, typename A>
+template <typename... Args>
+size_t HashMap<K, M, H, swiss_storage, A>::emplace_new(uint64_t mixed, Args&&... args) {
+    size_t index = find_insert_slot(mixed);
+    if (index == _capacity || (_ctrl[index] == kEmpty && _growth_left == 0)) {
+        // args may refer into the slots the rebuild frees, as in try_emplace(key,
+        // map.at(other)), so build the element first and move it in afterwards
+        std::pair<K, M> element(std::forward<Args>(args)...);
+        // if most of the used slots are tombstones, a rebuild at the same size is enough
+        size_t max_size = growth_limit(_capacity);
+        rebuild(_size + 1 <= max_size / 2 ? _capacity : std::max(2 * _capacity, min_capacity(_size + 1)));
+        index = find_insert_slot(mixed);
+        new (&_slots[index].value) value_type(std::move(element));
+    } else {
+        // construct first, so a throwing constructor leaves the control bytes untouched
+        new (&_slots[index].value) value_type(std::forward<Args>(args)...);
+    }
+    if (_ctrl[index] == kEmpty) {
+        --_growth_left; // reusing a tombstone doesn't use up an empty slot
+    }
+    _ctrl[index] = fragment(mixed);
+    ++_size;
+    return index;
+}
+
+template <typename K, typename M, typename H, typename A>
+bool HashMap<K, M, H, swiss_storage, A>::erase(const K& key) {
+    size_t index = find_slot(key, mix(_hash_function(key)));
+    if (index == _capacity) {
+        return false;
+    }
+    erase_slot(index);
+    return true;
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike, typename>
+bool HashMap<K, M, H, swiss_storage, A>::contains(const KeyLike& key) const noexcept {
+    return find_slot(key, mix(_hash_function(key))) != _capacity;
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike, typename>
+M& HashMap<K, M, H, swiss_storage, A>::at(const KeyLike& key) {
+    size_t index = find_slot(key, mix(_hash_function(key)));
+    if (index == _capacity) {
+        throw std::out_of_range("HashMap<K, M, H, swiss_storage, A>::at: key not found");
+    }
+    return _slots[index].value.second;
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike, typename>
+const M& HashMap<K, M, H, swiss_storage, A>::at(const KeyLike& key) const {
+    // see static_cast/const_cast trick explained in hashmap.cpp.
+    return static_cast<const M&>(const_cast<HashMap*>(this)->at(key));
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike, typename>
+M& HashMap<K, M, H, swiss_storage, A>::operator[](const KeyLike& key) {
+    // only build a K when key is not in the map yet
+    return emplace_key(key, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple()).first->second;
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike, typename>
+typename HashMap<K, M, H, swiss_storage, A>::iterator HashMap<K, M, H, swiss_storage, A>::find(const KeyLike& key) {
+    return make_iterator(find_slot(key, mix(_hash_function(key))));
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike, typename>
+typename HashMap<K, M, H, swiss_storage, A>::const_iterator HashMap<K, M, H, swiss_storage, A>::find(const KeyLike& key) const {
+    // see static_cast/const_cast trick explained in hashmap.cpp.
+    return static_cast<const_iterator>(const_cast<HashMap*>(this)->find(key));
+}
+
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike, typename>
+bool HashMap<K, M, H, swiss_storage, A>::erase(const KeyLike& key) {
+    size_t index = find_slot(key, mix(_hash_function(key)));
+    if (index == _capacity) {
+        return false;
+    }
+    erase_slot(index);
+    return true;
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, swiss_storage, A>::iterator HashMap<K, M, H, swiss_storage, A>::erase(const_iterator pos) {
+    erase_slot(pos._bucket);
+    return make_iterator(pos._bucket + 1);
+}
+
+template <typename K, typename M, typename H, typename A>
+void HashMap<K, M, H, swiss_storage, A>::clear() noexcept {
+    for (size_t i = 0; i < _capacity; ++i) {
+        if (_ctrl[i] >= 0) {
+            _slots[i].value.~value_type();
+        }
+        _ctrl[i] = kEmpty;
+    }
+    _size = 0;
+    _growth_left = growth_limit(_capacity);
+}
+
+template <typename K, typename M, typename H, typename A>
+void HashMap<K, M, H, swiss_storage, A>::rehash(size_t new_buckets) {
+    if (new_buckets == 0) {
+        throw std::out_of_range("HashMap<K, M, H, swiss_storage, A>::rehash: new_bucket_count must be positive.");
+    }
+    rebuild(std::max(new_buckets, min_capacity(_size + 1)));
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, swiss_storage, A>::iterator HashMap<K, M, H, swiss_storage, A>::begin() noexcept {
+    return make_iterator(0);
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, swiss_storage, A>::iterator HashMap<K, M, H, swiss_storage, A>::end() noexcept {
+    return make_iterator(_capacity);
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, swiss_storage, A>::const_iterator HashMap<K, M, H, swiss_storage, A>::begin() const noexcept {
+    return static_cast<const_iterator>(const_cast<HashMap*>(this)->begin());
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, swiss_storage, A>::const_iterator HashMap<K, M, H, swiss_storage, A>::end() const noexcept {
+    return static_cast<const_iterator>(const_cast<HashMap*>(this)->end());
+}
+
+template <typename K, typename M, typename H, typename A>
+void HashMap<K, M, H, swiss_storage, A>::debug() const {
+    std::cout << std::setw(30) << std::setfill('-') << '\n' << std::setfill(' ')
+          << "Printing debug information for your HashMap implementation (swiss_storage)\n"
+          << "Size: " << size() << std::setw(15) << std::right
+          << "Slots: " << bucket_count() << std::setw(20) << std::right
+          << "(load factor: " << std::setprecision(2) << load_factor() << ") \n\n";
+
+    for (size_t i = 0; i < bucket_count(); ++i) {
+        std::cout << "[" << std::setw(3) << i << "]:";
+        if (_ctrl[i] == kDeleted) {
+            std::cout << " (deleted)";
+        } else if (_ctrl[i] >= 0) {
+            const auto& [key, mapped] = _slots[i].value;
+            // next line will not compile if << not supported for K or M
+            std::cout << " " << key << ":" << mapped << " (fragment " << static_cast<int>(_ctrl[i]) << ")";
+        }
+        std::cout << " /" << '\n';
+    }
+    std::cout << std::setw(30) << std::setfill('-') << '\n' << std::setfill(' ');
+}
+
+/*
+* Multiplying by 2^64 / golden ratio spreads the hash toward the top bits: every bit
+* of the product depends on the bits of hash at or below it, so only the high bits
+* depend on all of hash. The top 64 - _shift bits pick the first group, and the 7 bits
+* just below them are the control byte fragment (see fragment).
+*/
+template <typename K, typename M, typename H, typename A>
+uint64_t HashMap<K, M, H, swiss_storage, A>::mix(size_t hash) const noexcept {
+    return static_cast<uint64_t>(hash) * kFibonacciMultiplier;
+}
+
+template <typename K, typename M, typename H, typename A>
+size_t HashMap<K, M, H, swiss_storage, A>::first_group(uint64_t mixed) const noexcept {
+    return _shift == 64 ? 0 : static_cast<size_t>(mixed >> _shift);
+}
+
+/*
+* The 7 bits of mixed just below the ones first_group uses, so keys in the same group
+* mostly get different fragments. The low bits of mixed would not do: they depend only
+* on the low bits of the hash, so hash codes that are all multiples of 128 (std::hash<int>
+* of multiples of 128, aligned pointers) would all get fragment 0.
+*/
+template <typename K, typename M, typename H, typename A>
+int8_t HashMap<K, M, H, swiss_storage, A>::fragment(uint64_t mixed) const noexcept {
+    // _shift is at most 64 (a single group), so this is at most the top 7 bits
+    return static_cast<int8_t>((mixed >> (_shift - 7)) & 0x7F);
+}
+
+/*
+* Returns the index of the slot holding key, or _capacity if key is not in the map.
+* Only slots whose control byte equals key's fragment have their key compared.
+*/
+template <typename K, typename M, typename H, typename A>
+template <typename KeyLike>
+size_t HashMap<K, M, H, swiss_storage, A>::find_slot(const KeyLike& key, uint64_t mixed) const {
+    if (_capacity == 0) {
+        return _capacity;
+    }
+    size_t group_mask = _capacity / kGroupWidth - 1;
+    size_t group_index = first_group(mixed);
+    int8_t key_fragment = fragment(mixed);
+    for (size_t step = 1; ; ++step) {
+        size_t base = group_index * kGroupWidth;
+        group curr{&_ctrl[base]};
+        for (uint32_t match = curr.match(key_fragment); match != 0; match &= match - 1) {
+            size_t index = base + __builtin_ctz(match);
+            if (_slots[index].value.first == key) {
+                return index;
+            }
+        }
+        if (curr.match_empty() != 0) {
+            return _capacity;
+        }
+        group_index = (group_index + step) & group_mask;
+    }
+}
+
+/*
+* Returns the first empty or deleted slot on the probe sequence for mixed, or
+* _capacity if the map has no slots. The growth policy keeps at least one slot
+* empty, so the probe always ends.
+*/
+template <typename K, typename M, typename H, typename A>
+size_t HashMap<K, M, H, swiss_storage, A>::find_insert_slot(uint64_t mixed) const {
+    if (_capacity == 0) {
+        return _capacity;
+    }
+    size_t group_mask = _capacity / kGroupWidth - 1;
+    size_t group_index = first_group(mixed);
+    for (size_t step = 1; ; ++step) {
+        size_t base = group_index * kGroupWidth;
+        uint32_t free = group{&_ctrl[base]}.match_empty_or_deleted();
+        if (free != 0) {
+            return base + __builtin_ctz(free);
+        }
+        group_index = (group_index + step) & group_mask;
+    }
+}
+
+/*
+* A slot can go straight back to kEmpty if its group still has an empty slot:
+* no probe sequence ever continued past that group. Otherwise a lookup may need to
+* continue past it, so the slot becomes a tombstone.
+*/
+template <typename K, typename M, typename H, typename A>
+void HashMap<K, M, H, swiss_storage, A>::erase_slot(size_t index) {
+    _slots[index].value.~value_type();
+    size_t base = index - index % kGroupWidth;
+    if (group{&_ctrl[base]}.match_empty() != 0) {
+        _ctrl[index] = kEmpty;
+        ++_growth_left;
+    } else {
+        _ctrl[index] = kDeleted;
+    }
+    --_size;
+}
+
+/*
+* Moves every element into fresh arrays with at least new_capacity slots,
+* rounded up to a power of two. Tombstones are dropped.
+*/
+template <typename K, typename M, typename H, typename A>
+void HashMap<K, M, H, swiss_storage, A>::rebuild(size_t new_capacity) {
+    size_t capacity = kGroupWidth;
+    int shift = 64;
+    while (capacity < new_capacity || growth_limit(capacity) < _size) {
+        capacity *= 2;
+        --shift;
+    }
+
+    std::vector<int8_t> old_ctrl = std::move(_ctrl);
+    std::vector<slot> old_slots = std::move(_slots);
+    size_t old_capacity = _capacity;
+    _capacity = capacity;
+    _shift = shift;
+    _ctrl.assign(capacity, kEmpty);
+    _slots = std::vector<slot>(capacity);
+    _growth_left = growth_limit(capacity) - _size;
+
+    for (size_t i = 0; i < old_capacity; ++i) {
+        if (old_ctrl[i] >= 0) {
+            uint64_t mixed = mix(_hash_function(old_slots[i].value.first));
+            size_t index = find_insert_slot(mixed);
+            new (&_slots[index].value) value_type(release(old_slots[i].value));
+            _ctrl[index] = fragment(mixed);
+            old_slots[i].value.~value_type();
+        }
+    }
+}
+
+/*
+* Returns how many slots of a table with capacity slots may be in use at once.
+*/
+template <typename K, typename M, typename H, typename A>
+size_t HashMap<K, M, H, swiss_storage, A>::growth_limit(size_t capacity) const noexcept {
+    return static_cast<size_t>(capacity * _max_load_factor);
+}
+
+/*
+* Returns the number of slots needed to hold count elements without
+* exceeding the max load factor.
+*/
+template <typename K, typename M, typename H, typename A>
+size_t HashMap<K, M, H, swiss_storage, A>::min_capacity(size_t count) const noexcept {
+    return static_cast<size_t>(std::ceil(count / _max_load_factor));
+}
+
+/*
+* Returns an iterator to the first element at or after slot index (end() if there is none).
+*/
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, swiss_storage, A>::iterator HashMap<K, M, H, swiss_storage, A>::make_iterator(size_t index) {
+    index = next_occupied(index);
+    return {this, index < _capacity ? &_slots[index] : nullptr, index};
+}
+
+template <typename K, typename M, typename H, typename A>
+size_t HashMap<K, M, H, swiss_storage, A>::bucket_end() const noexcept {
+    return bucket_count();
+}
+
+template <typename K, typename M, typename H, typename A>
+size_t HashMap<K, M, H, swiss_storage, A>::next_occupied(size_t index) const noexcept {
+    while (index < _capacity && _ctrl[index] < 0) {
+        ++index;
+    }
+    return index;
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, swiss_storage, A>::node* HashMap<K, M, H, swiss_storage, A>::bucket_front(size_t bucket) noexcept {
+    return _ctrl[bucket] >= 0 ? &_slots[bucket] : nullptr;
+}
+
+template <typename K, typename M, typename H, typename A>
+typename HashMap<K, M, H, swiss_storage, A>::node* HashMap<K, M, H, swiss_storage, A>::next_in_bucket(node*) noexcept {
+    return nullptr; // a slot holds at most one element
+}
+
+#endif // HASHMAP_SWISS_H
@@ -41,6 +41,9 @@
 #define RUN_TEST_4F 1
 #define RUN_TEST_4G 1
 #define RUN_TEST_4H 1
+// Extensions: storage policies and other features beyond the assignment (optional)
+#define RUN_EXTENSION_TESTS 1
+
 // Milestone 5: benchmark (optional)
 #define RUN_BENCHMARK 1
 
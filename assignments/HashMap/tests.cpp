@@ -6,6 +6,7 @@
  * V2 (fall 2020) - improve special members test
  * V3 (winter 2021) - added iterator tests, factored out edge case and const-correctness tests
  *                  - added benchmarking tests
+ * Extensions       - storage policy tests and benchmarks
  *
  * DO NOT SUBMIT THIS FILE (unless you added extra tests for us)
  */
@@ -23,6 +24,15 @@ using namespace std;
 #include <set>
 #include <iomanip>
 #include <chrono>       // for chrono timers
+#include <memory_resource>  // for the pmr::HashMap test
+#include <string_view>      // for the heterogeneous lookup test
+#include <list>             // for the bulk build test
+#include <numeric>          // for std::iota
+#include <thread>           // for the concurrent map test and benchmark
+#include <mutex>            // for the single-lock baseline in the concurrent benchmark
+#include <shared_mutex>     // for the reader-writer lock baseline in the concurrent read benchmark
+#include <filesystem>       // for the snapshot test and benchmark files
+#include <fstream>          // for the text baseline in the snapshot benchmark
 
 // ----------------------------------------------------------------------------------------------
 // Global Constants and Type Alises (DO NOT EDIT)
@@ -239,11 +249,12 @@ void F_custom_bucket_count() {
     VERIFY_TRUE(check_map_equal(one_bucket, answer), __LINE__);
 
     VERIFY_TRUE(many_buckets.bucket_count() == 10000, __LINE__);
-    VERIFY_TRUE(one_bucket.bucket_count() == 1, __LINE__);
+    // one_bucket grows so its load factor never exceeds max_load_factor()
+    VERIFY_TRUE(one_bucket.bucket_count() >= 100, __LINE__);
 
     float epsilon = 0.001;
     VERIFY_TRUE(many_buckets.load_factor() - 0.01 < epsilon, __LINE__);
-    VERIFY_TRUE(one_bucket.load_factor() - 100 < epsilon, __LINE__);
+    VERIFY_TRUE(one_bucket.load_factor() <= one_bucket.max_load_factor() + epsilon, __LINE__);
 }
 void G_custom_hash_function() {
     /*
@@ -1746,6 +1757,1688 @@ void H_move_assign_time() {
 }
 #endif
 
+// ----------------------------------------------------------------------------------------------
+/* Extension Test Cases */
+#if RUN_EXTENSION_TESTS
+template <typename Map> void verify_random_operations(Map& map) {
+    /*
+    * Runs a long random sequence of insert/erase/find on map (K = int, M = int)
+    * and on a std::unordered_map, checking every return value against the answer.
+    */
+    std::unordered_map<int, int> answer;
+    std::mt19937 rng(106);
+    std::uniform_int_distribution<int> key_dist(0, 999);
+    for (int i = 0; i < 20000; ++i) {
+        int key = key_dist(rng);
+        switch (rng() % 4) {
+        case 0:
+        case 1: {
+            auto [iter, added] = map.insert({key, i});
+            VERIFY_TRUE(added == answer.insert({key, i}).second, __LINE__);
+            VERIFY_TRUE(iter->first == key && iter->second == answer.at(key), __LINE__);
+            break;
+        }
+        case 2:
+            VERIFY_TRUE(map.erase(key) == (answer.erase(key) == 1), __LINE__);
+            break;
+        default:
+            VERIFY_TRUE((map.find(key) == map.end()) == (answer.find(key) == answer.end()), __LINE__);
+            break;
+        }
+    }
+    VERIFY_TRUE(check_map_equal(map, answer), __LINE__);
+
+    std::set<int> seen;
+    for (const auto& [key, mapped] : map) VERIFY_TRUE(seen.insert(key).second, __LINE__);
+    VERIFY_TRUE(seen.size() == answer.size(), __LINE__);
+}
+
+void A_robin_hood_basic() {
+    /*
+    * Verifies the robin_hood_storage policy against std::unordered_map,
+    * with both a good hash function and one that maps every key to the same slot.
+    */
+    HashMap<int, int, std::hash<int>, robin_hood_storage> map;
+    verify_random_operations(map);
+
+    auto constant = [](const int&) { return size_t{0}; };
+    HashMap<int, int, decltype(constant), robin_hood_storage> collide(1, constant);
+    verify_random_operations(collide);
+
+    HashMap<std::string, int, std::hash<std::string>, robin_hood_storage> names;
+    std::unordered_map<std::string, int> answer;
+    for (const auto& kv_pair : vec) {
+        names.insert(kv_pair);
+        answer.insert(kv_pair);
+    }
+    VERIFY_TRUE(check_map_equal(names, answer), __LINE__);
+    names["Avery"] = 2021;
+    answer["Avery"] = 2021;
+    names.rehash(1);
+    VERIFY_TRUE(check_map_equal(names, answer), __LINE__);
+    VERIFY_TRUE(names.load_factor() <= 1, __LINE__);
+}
+
+void B_robin_hood_iterator_erase() {
+    /*
+    * Erasing while iterating must visit every element exactly once, even though
+    * backward-shift deletion moves elements into the erased slot.
+    */
+    auto identity = [](const int& key) { return static_cast<size_t>(key); };
+    HashMap<int, int, decltype(identity), robin_hood_storage> map(8, identity);
+    std::set<int> kept;
+    for (int i = 0; i < 500; ++i) {
+        map.insert({i % 50 * 1000 + i, i}); // long probe runs
+        if (i % 3 != 0) kept.insert(i % 50 * 1000 + i);
+    }
+
+    std::set<int> visited;
+    for (auto iter = map.begin(); iter != map.end(); ) {
+        VERIFY_TRUE(visited.insert(iter->first).second, __LINE__);
+        if (iter->second % 3 == 0) {
+            iter = map.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    VERIFY_TRUE(visited.size() == 500, __LINE__);
+    VERIFY_TRUE(map.size() == kept.size(), __LINE__);
+
+    std::set<int> remaining;
+    for (const auto& [key, mapped] : map) remaining.insert(key);
+    VERIFY_TRUE(remaining == kept, __LINE__);
+
+    auto copy = map;
+    VERIFY_TRUE(copy == map, __LINE__);
+    auto moved = std::move(copy);
+    VERIFY_TRUE(moved == map, __LINE__);
+    VERIFY_TRUE(copy.empty() && copy.begin() == copy.end(), __LINE__);
+    copy.insert({1, 1});
+    VERIFY_TRUE(copy.at(1) == 1, __LINE__);
+}
+
+/*
+* An int key that counts how many times two keys are compared, with a hash function
+* that gives every key a hash code that is a multiple of 128.
+*/
+struct compared_int {
+    int value;
+    static inline size_t comparisons = 0;
+    bool operator==(const compared_int& rhs) const {
+        ++comparisons;
+        return value == rhs.value;
+    }
+};
+struct aligned_hash {
+    size_t operator()(const compared_int& key) const { return static_cast<size_t>(key.value) << 7; }
+};
+
+void C_swiss_basic() {
+    /*
+    * Verifies the swiss_storage policy against std::unordered_map,
+    * with both a good hash function and one that gives every key the same fragment.
+    */
+    HashMap<int, int, std::hash<int>, swiss_storage> map;
+    verify_random_operations(map);
+
+    auto constant = [](const int&) { return size_t{0}; };
+    HashMap<int, int, decltype(constant), swiss_storage> collide(1, constant);
+    verify_random_operations(collide);
+
+    HashMap<std::string, int, std::hash<std::string>, swiss_storage> names;
+    std::unordered_map<std::string, int> answer;
+    for (const auto& kv_pair : vec) {
+        names.insert(kv_pair);
+        answer.insert(kv_pair);
+    }
+    VERIFY_TRUE(check_map_equal(names, answer), __LINE__);
+    names["Avery"] = 2021;
+    answer["Avery"] = 2021;
+    names.rehash(1);
+    VERIFY_TRUE(check_map_equal(names, answer), __LINE__);
+
+    auto copy = names;
+    VERIFY_TRUE(copy == names, __LINE__);
+    auto moved = std::move(copy);
+    VERIFY_TRUE(moved == names, __LINE__);
+    VERIFY_TRUE(copy.empty() && copy.begin() == copy.end(), __LINE__);
+    copy["Anna"] = 1;
+    VERIFY_TRUE(copy.at("Anna") == 1, __LINE__);
+
+    // hash codes that share their low bits still get different fragments, so a lookup
+    // compares about one key rather than every key in the groups it probes
+    HashMap<compared_int, int, aligned_hash, swiss_storage> aligned;
+    for (int i = 0; i < 10000; ++i) aligned.insert({{i}, i});
+    compared_int::comparisons = 0;
+    for (int i = 0; i < 20000; ++i) VERIFY_TRUE(aligned.contains({i}) == (i < 10000), __LINE__);
+    VERIFY_TRUE(compared_int::comparisons < 12000, __LINE__);
+
+    // the value may come from the map itself, even when the insert rebuilds the table
+    HashMap<int, std::string, std::hash<int>, swiss_storage> strings;
+    strings.try_emplace(0, std::string(40, 'x'));
+    for (int i = 1; i < 1000; ++i) strings.try_emplace(i, strings.at(i - 1));
+    for (int i = 0; i < 1000; ++i) VERIFY_TRUE(strings.at(i) == std::string(40, 'x'), __LINE__);
+}
+
+void D_swiss_tombstones() {
+    /*
+    * Insert/erase churn leaves tombstones behind. The table must reuse or clear them
+    * instead of growing forever, and erase must not move any other element.
+    */
+    HashMap<int, int, std::hash<int>, swiss_storage> map;
+    for (int i = 0; i < 100000; ++i) {
+        map.insert({i, i});
+        if (i >= 50) map.erase(i - 50);
+    }
+    VERIFY_TRUE(map.size() == 50, __LINE__);
+    VERIFY_TRUE(map.bucket_count() <= 256, __LINE__);
+
+    std::vector<std::pair<const int, int>*> addresses;
+    for (auto& pair : map) addresses.push_back(&pair);
+    for (auto iter = map.begin(); iter != map.end(); ) {
+        iter = (iter->first % 2 == 0) ? map.erase(iter) : ++iter;
+    }
+    VERIFY_TRUE(map.size() == 25, __LINE__);
+    for (auto* pair : addresses) {
+        if (pair->first % 2 != 0) VERIFY_TRUE(map.find(pair->first)->second == pair->second &&
+                                              &*map.find(pair->first) == pair, __LINE__);
+    }
+}
+
+template <typename Map>
+void verify_max_load_factor_reserve() {
+    float epsilon = 0.001;
+    Map map(1);
+    map.max_load_factor(0.5);
+    for (int i = 0; i < 1000; ++i) {
+        map.insert({i, i});
+        VERIFY_TRUE(map.load_factor() <= map.max_load_factor() + epsilon, __LINE__);
+    }
+
+    // reserve up front, then no insert may rehash
+    Map reserved;
+    reserved.reserve(5000);
+    size_t buckets = reserved.bucket_count();
+    for (int i = 0; i < 5000; ++i) reserved.insert({i, i});
+    VERIFY_TRUE(reserved.bucket_count() == buckets, __LINE__);
+
+    // lowering the max load factor rehashes right away, and the copy keeps it
+    reserved.max_load_factor(0.25);
+    VERIFY_TRUE(reserved.load_factor() <= 0.25 + epsilon, __LINE__);
+    Map copy = reserved;
+    VERIFY_TRUE(copy.max_load_factor() == reserved.max_load_factor(), __LINE__);
+    try {
+        copy.max_load_factor(0);
+        VERIFY_TRUE(false, __LINE__);
+    } catch (const std::out_of_range&) {}
+
+    std::vector<std::pair<int, int>> pairs;
+    for (int i = 0; i < 1000; ++i) pairs.push_back({i, -i});
+    Map ranged(pairs.begin(), pairs.end(), 1);
+    VERIFY_TRUE(ranged.size() == 1000 && ranged.at(999) == -999, __LINE__);
+    VERIFY_TRUE(ranged.load_factor() <= ranged.max_load_factor() + epsilon, __LINE__);
+}
+
+void E_max_load_factor_reserve() {
+    /*
+    * Every storage policy grows past max_load_factor(), and reserve(n)
+    * makes room for n elements so the following inserts don't rehash.
+    */
+    verify_max_load_factor_reserve<HashMap<int, int>>();
+    verify_max_load_factor_reserve<HashMap<int, int, std::hash<int>, robin_hood_storage>>();
+    verify_max_load_factor_reserve<HashMap<int, int, std::hash<int>, swiss_storage>>();
+    verify_max_load_factor_reserve<HashMap<int, int, std::hash<int>, dense_storage>>();
+    verify_max_load_factor_reserve<HashMap<int, int, std::hash<int>, small_storage<4>>>();
+}
+
+void F_incremental_rehash() {
+    /*
+    * With incremental rehashing on, growing the map leaves the nodes in the old bucket array
+    * and later operations move them over. Everything must see both tables in the meantime.
+    */
+    HashMap<int, int> map(1);
+    map.incremental_rehash(true);
+    verify_random_operations(map);
+
+    HashMap<int, int> growing(1);
+    growing.incremental_rehash(true);
+    std::unordered_map<int, int> answer;
+    for (int i = 0; !(growing.rehash_in_progress() && growing.size() > 1000); ++i) {
+        growing.insert({i, -i});
+        answer.insert({i, -i});
+    }
+    VERIFY_TRUE(growing.load_factor() <= growing.max_load_factor(), __LINE__);
+
+    // iteration and copies see the elements of both tables, each exactly once
+    std::set<int> seen;
+    for (const auto& [key, mapped] : growing) VERIFY_TRUE(seen.insert(key).second, __LINE__);
+    VERIFY_TRUE(seen.size() == answer.size(), __LINE__);
+    HashMap<int, int> copy = growing;
+    VERIFY_TRUE(copy == growing && copy.incremental_rehash(), __LINE__);
+
+    // erasing while iterating must not move buckets under the iterator
+    VERIFY_TRUE(growing.rehash_in_progress(), __LINE__);
+    for (auto iter = growing.begin(); iter != growing.end(); ) {
+        if (iter->first % 2 == 0) {
+            answer.erase(iter->first);
+            iter = growing.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    VERIFY_TRUE(check_map_equal(growing, answer), __LINE__);
+
+    // find moves buckets too, and turning the mode off finishes the rehash
+    for (int i = 0; growing.rehash_in_progress() && i < 10; ++i) {
+        VERIFY_TRUE(growing.find(1)->second == -1, __LINE__);
+    }
+    growing.incremental_rehash(false);
+    VERIFY_TRUE(!growing.rehash_in_progress() && check_map_equal(growing, answer), __LINE__);
+}
+
+void G_node_pool() {
+    /*
+    * Nodes come from the map's slab pool: an erased node's memory is reused by the next
+    * insert, and clear/the destructor free everything (run with -fsanitize=address to
+    * check for leaks). Strings long enough to allocate catch missed destructor calls.
+    */
+    HashMap<std::string, std::string> map;
+    std::string padding(40, '*');
+    for (int i = 0; i < 1000; ++i) map.insert({std::to_string(i) + padding, padding});
+
+    const auto* erased = &*map.find("7" + padding);
+    map.erase("7" + padding);
+    map.insert({"new" + padding, padding});
+    VERIFY_TRUE(&*map.find("new" + padding) == erased, __LINE__);
+
+    for (int i = 0; i < 1000; i += 2) map.erase(std::to_string(i) + padding);
+    VERIFY_TRUE(map.size() == 500, __LINE__);
+    map.clear();
+    VERIFY_TRUE(map.empty() && map.begin() == map.end(), __LINE__);
+    for (int i = 0; i < 100; ++i) map.insert({std::to_string(i), padding});
+    HashMap<std::string, std::string> moved = std::move(map);
+    VERIFY_TRUE(moved.size() == 100 && moved.at("99") == padding && map.empty(), __LINE__);
+    map.insert({"reused", padding});
+    VERIFY_TRUE(map.at("reused") == padding, __LINE__);
+}
+
+/*
+* A memory_resource that forwards to another one and counts the bytes still allocated.
+*/
+class counting_resource : public std::pmr::memory_resource {
+public:
+    explicit counting_resource(std::pmr::memory_resource* upstream) : upstream(upstream) {}
+    size_t in_use = 0;
+    size_t allocations = 0;
+
+private:
+    std::pmr::memory_resource* upstream;
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        in_use += bytes;
+        ++allocations;
+        return upstream->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        in_use -= bytes;
+        upstream->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+/*
+* A stateful allocator that propagates on copy assignment. Allocators with different
+* ids compare unequal, so memory from one may not be handed to the other.
+*/
+template <typename T>
+struct propagating_allocator {
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+
+    explicit propagating_allocator(int id) : id(id) {}
+    template <typename U>
+    propagating_allocator(const propagating_allocator<U>& rhs) : id(rhs.id) {}
+
+    T* allocate(size_t n) { return std::allocator<T>().allocate(n); }
+    void deallocate(T* p, size_t n) { std::allocator<T>().deallocate(p, n); }
+    friend bool operator==(const propagating_allocator& lhs, const propagating_allocator& rhs) { return lhs.id == rhs.id; }
+    friend bool operator!=(const propagating_allocator& lhs, const propagating_allocator& rhs) { return lhs.id != rhs.id; }
+
+    int id;
+};
+
+void H_pmr_allocator() {
+    /*
+    * pmr::HashMap takes all of its memory from the given resource, gives all of it back,
+    * and follows the STL rules for which allocator a copy or a move ends up with.
+    */
+    std::byte buffer[1 << 17];
+    std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+    counting_resource counter(&arena);
+    {
+        ::pmr::HashMap<int, int> map(&counter);
+        for (int i = 0; i < 1000; ++i) map.insert({i, -i});
+        VERIFY_TRUE(map.size() == 1000 && map.at(999) == -999, __LINE__);
+        VERIFY_TRUE(map.get_allocator().resource() == &counter && counter.in_use > 0, __LINE__);
+
+        // a copy allocates from the default resource, a move keeps the resource
+        ::pmr::HashMap<int, int> copy = map;
+        VERIFY_TRUE(copy == map && copy.get_allocator().resource() == std::pmr::get_default_resource(), __LINE__);
+        const auto* element = &*map.find(7);
+        ::pmr::HashMap<int, int> moved = std::move(map);
+        VERIFY_TRUE(moved.get_allocator().resource() == &counter && &*moved.find(7) == element, __LINE__);
+
+        // move assignment across resources moves the elements, within one it moves the nodes
+        copy.erase(7);
+        moved = std::move(copy);
+        VERIFY_TRUE(moved.size() == 999 && copy.empty() && !moved.contains(7), __LINE__);
+        VERIFY_TRUE(moved.get_allocator().resource() == &counter, __LINE__);
+        ::pmr::HashMap<int, int> same_resource(&counter);
+        same_resource.insert({1, 1});
+        element = &*same_resource.find(1);
+        moved = std::move(same_resource);
+        VERIFY_TRUE(moved.size() == 1 && &*moved.find(1) == element, __LINE__);
+    }
+    VERIFY_TRUE(counter.in_use == 0, __LINE__);
+
+    ::pmr::HashMap<std::string, int> names({{"Avery", 2019}, {"Anna", 2020}}, 10, std::hash<std::string>(), &counter);
+    VERIFY_TRUE(names.at("Anna") == 2020 && names.get_allocator().resource() == &counter, __LINE__);
+
+    // copy assignment with an allocator that propagates takes rhs's allocator, and then
+    // builds its own nodes, even when the hash function can't be assigned (a lambda that
+    // captures) and the elements are reinserted one by one
+    size_t seed = 17;
+    auto seeded = [seed](const int& key) { return std::hash<int>()(key) ^ seed; };
+    using alloc = propagating_allocator<std::pair<const int, int>>;
+    HashMap<int, int, decltype(seeded), chained_storage, alloc> lhs(10, seeded, alloc(1));
+    HashMap<int, int, decltype(seeded), chained_storage, alloc> rhs(10, seeded, alloc(2));
+    for (int i = 0; i < 100; ++i) rhs.insert({i, -i});
+    lhs.insert({1000, 0});
+    lhs = rhs;
+    VERIFY_TRUE(lhs.get_allocator() == alloc(2) && lhs.size() == 100 && lhs == rhs, __LINE__);
+    for (int i = 0; i < 100; ++i) VERIFY_TRUE(&*lhs.find(i) != &*rhs.find(i), __LINE__);
+    VERIFY_TRUE(lhs.insert({100, 1}).second && !rhs.contains(100) && !lhs.contains(1000), __LINE__);
+}
+
+/*
+* A string key that counts how many times one is constructed, and a transparent hash
+* for it, so the heterogeneous lookup test can check that no temporary keys are built.
+*/
+struct counted_string {
+    static inline int constructed = 0;
+    std::string str;
+
+    explicit counted_string(std::string_view s) : str(s) { ++constructed; }
+    counted_string(const counted_string& rhs) : str(rhs.str) { ++constructed; }
+    counted_string(counted_string&& rhs) = default;
+    counted_string& operator=(counted_string&& rhs) = default;
+};
+
+bool operator==(const counted_string& lhs, const counted_string& rhs) { return lhs.str == rhs.str; }
+bool operator==(const counted_string& lhs, std::string_view rhs) { return lhs.str == rhs; }
+
+struct counted_string_hash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const { return std::hash<std::string_view>()(s); }
+    size_t operator()(const counted_string& s) const { return (*this)(s.str); }
+};
+
+template <typename Storage>
+void verify_transparent_lookup() {
+    HashMap<counted_string, int, counted_string_hash, Storage> map;
+    for (int i = 0; i < 100; ++i) map[counted_string(std::to_string(i))] = i;
+
+    int before = counted_string::constructed;
+    std::string_view key = "42";
+    VERIFY_TRUE(map.contains(key) && map.find(key)->second == 42 && map.at(key) == 42, __LINE__);
+    const auto& cmap = map;
+    VERIFY_TRUE(cmap.contains("7") && cmap.find("7")->second == 7 && cmap.at("7") == 7, __LINE__);
+    VERIFY_TRUE(!cmap.contains("x") && cmap.find("x") == cmap.end(), __LINE__);
+    try {
+        map.at("x");
+        VERIFY_TRUE(false, __LINE__);
+    } catch (const std::out_of_range&) {}
+    VERIFY_TRUE(map.erase(key) && !map.erase(key) && !map.contains(key), __LINE__);
+    ++map["8"];
+    VERIFY_TRUE(map.at("8") == 9 && map.size() == 99, __LINE__);
+    VERIFY_TRUE(counted_string::constructed == before, __LINE__);
+
+    // operator[] only builds a key for a new element, and erase(pos) still erases pos
+    map["new"] = -1;
+    VERIFY_TRUE(counted_string::constructed > before && map.at("new") == -1 && map.size() == 100, __LINE__);
+    map.erase(map.find("new"));
+    VERIFY_TRUE(!map.contains("new") && map.size() == 99, __LINE__);
+}
+
+void I_transparent_lookup() {
+    /*
+    * With a transparent hash, find/contains/at/erase/operator[] look up a string_view
+    * or string literal directly, for every storage policy.
+    */
+    verify_transparent_lookup<chained_storage>();
+    verify_transparent_lookup<robin_hood_storage>();
+    verify_transparent_lookup<swiss_storage>();
+    verify_transparent_lookup<dense_storage>();
+    verify_transparent_lookup<small_storage<4>>();
+
+    HashMap<std::string, int, counted_string_hash> names{{"Avery", 2019}, {"Anna", 2020}};
+    VERIFY_TRUE(names.contains("Avery") && names.at(std::string_view("Anna")) == 2020, __LINE__);
+    VERIFY_TRUE(names.find(std::string("Avery"))->second == 2019 && !names.contains("Avery "), __LINE__);
+}
+
+/*
+* A mapped type that counts how many times it is copied.
+*/
+struct copy_counter {
+    static inline int copies = 0;
+    std::vector<int> payload;
+
+    explicit copy_counter(size_t n = 0, int value = 0) : payload(n, value) {}
+    copy_counter(const copy_counter& rhs) : payload(rhs.payload) { ++copies; }
+    copy_counter(copy_counter&& rhs) = default;
+    copy_counter& operator=(const copy_counter& rhs) { payload = rhs.payload; ++copies; return *this; }
+    copy_counter& operator=(copy_counter&& rhs) = default;
+};
+
+/*
+* A hash function that throws for one key.
+*/
+struct refusing_hash {
+    size_t operator()(const std::string& key) const {
+        if (key == "refused") throw std::runtime_error("refused key");
+        return std::hash<std::string>()(key);
+    }
+};
+
+template <typename Storage>
+void verify_emplace() {
+    HashMap<std::string, copy_counter, std::hash<std::string>, Storage> map;
+    int before = copy_counter::copies;
+    for (int i = 0; i < 100; ++i) map.try_emplace(std::to_string(i), 1000, i);
+    map.emplace("emplaced", copy_counter(10, -1));
+    map.insert({"inserted", copy_counter(10, -2)});
+    map.insert_or_assign("assigned", copy_counter(10, -3));
+    map.insert_or_assign("assigned", copy_counter(20, -4));
+    map["indexed"].payload.push_back(5);
+    VERIFY_TRUE(copy_counter::copies == before && map.size() == 104, __LINE__);
+    VERIFY_TRUE(map.at("42").payload == std::vector<int>(1000, 42) && map.at("emplaced").payload[0] == -1, __LINE__);
+    VERIFY_TRUE(map.at("inserted").payload[9] == -2 && map.at("indexed").payload.size() == 1, __LINE__);
+    VERIFY_TRUE(map.at("assigned").payload == std::vector<int>(20, -4), __LINE__);
+
+    // existing keys: try_emplace leaves its arguments alone, emplace and insert are no-ops
+    copy_counter spare(5, 5);
+    auto [iter, added] = map.try_emplace("42", std::move(spare));
+    VERIFY_TRUE(!added && iter->first == "42" && spare.payload.size() == 5, __LINE__);
+    VERIFY_TRUE(!map.emplace("emplaced", copy_counter(1, 1)).second && map.at("emplaced").payload.size() == 10, __LINE__);
+    VERIFY_TRUE(!map.insert_or_assign(std::string("42"), std::move(spare)).second, __LINE__);
+    VERIFY_TRUE(map.at("42").payload == std::vector<int>(5, 5) && map.size() == 104, __LINE__);
+
+    // move-only mapped values work too
+    HashMap<int, std::unique_ptr<int>, std::hash<int>, Storage> owners;
+    for (int i = 0; i < 100; ++i) owners.emplace(i, std::make_unique<int>(i));
+    auto owned = std::make_unique<int>(-1);
+    VERIFY_TRUE(!owners.try_emplace(7, std::move(owned)).second && owned != nullptr, __LINE__);
+    VERIFY_TRUE(owners.try_emplace(100, std::move(owned)).second && owned == nullptr, __LINE__);
+    owners.insert_or_assign(7, std::make_unique<int>(70));
+    VERIFY_TRUE(*owners.at(7) == 70 && *owners.at(100) == -1 && *owners.at(99) == 99, __LINE__);
+
+    // a hash function that throws leaves the map as it was, and frees the new element
+    HashMap<std::string, copy_counter, refusing_hash, Storage> refusing;
+    refusing.emplace("kept", copy_counter(10, 1));
+    bool thrown = false;
+    try {
+        refusing.emplace("refused", copy_counter(1000, 2));
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    VERIFY_TRUE(thrown && refusing.size() == 1 && refusing.at("kept").payload.size() == 10, __LINE__);
+}
+
+/*
+* Hash functions that count their calls. The cached-hash test turns caching off for
+* uncached_counting_hash, and on for int keys with few_hashes.
+*/
+struct counting_hash {
+    static inline int calls = 0;
+    template <typename T>
+    size_t operator()(const T& key) const {
+        ++calls;
+        return std::hash<T>()(key);
+    }
+};
+
+struct uncached_counting_hash : counting_hash {};
+
+struct few_hashes {
+    size_t operator()(int key) const { return static_cast<size_t>(key) % 13; }
+};
+
+template <>
+struct cache_hash_code<std::string, uncached_counting_hash> : std::false_type {};
+
+template <>
+struct cache_hash_code<int, few_hashes> : std::true_type {};
+
+void J_emplace() {
+    /*
+    * emplace, try_emplace, insert_or_assign, insert(value_type&&) and operator[] build the
+    * mapped value in place (or move it), never copying it.
+    */
+    verify_emplace<chained_storage>();
+    verify_emplace<robin_hood_storage>();
+    verify_emplace<swiss_storage>();
+    verify_emplace<dense_storage>();
+    verify_emplace<small_storage<4>>();
+}
+
+void K_cached_hash() {
+    /*
+    * Nodes of maps with string keys cache their hash codes: rehash, iterators and
+    * erase(pos) never call the hash function again, and erase(key) and find call it once.
+    */
+    static_assert(cache_hash_code<std::string, std::hash<std::string>>::value, "strings cache by default");
+    static_assert(!cache_hash_code<int, std::hash<int>>::value, "ints don't cache by default");
+
+    HashMap<std::string, int, counting_hash> cached;
+    cached.reserve(1000);
+    counting_hash::calls = 0;
+    for (int i = 0; i < 1000; ++i) cached.insert({std::to_string(i), i});
+    VERIFY_TRUE(counting_hash::calls == 1000, __LINE__);
+
+    counting_hash::calls = 0;
+    cached.rehash(5000);
+    cached.rehash(3);
+    int sum = 0;
+    for (const auto& [key, mapped] : cached) sum += mapped;
+    VERIFY_TRUE(counting_hash::calls == 0 && sum == 999 * 1000 / 2, __LINE__);
+    for (int i = 0; i < 1000; i += 2) cached.erase(cached.find(std::to_string(i)));
+    for (int i = 1; i < 1000; i += 4) cached.erase(std::to_string(i));
+    VERIFY_TRUE(counting_hash::calls == 750 && cached.size() == 250, __LINE__);
+    VERIFY_TRUE(cached.at("3") == 3 && !cached.contains("5") && !cached.contains("4"), __LINE__);
+
+    // caching turned off: every rehash hashes every key again
+    HashMap<std::string, int, uncached_counting_hash> uncached;
+    for (int i = 0; i < 1000; ++i) uncached.insert({std::to_string(i), i});
+    counting_hash::calls = 0;
+    uncached.rehash(5000);
+    VERIFY_TRUE(counting_hash::calls == 1000 && uncached.at("999") == 999, __LINE__);
+
+    // many keys share each hash code, and the cached codes must not mix them up
+    HashMap<int, int, few_hashes> collide;
+    verify_random_operations(collide);
+    HashMap<int, int, few_hashes> incremental;
+    incremental.incremental_rehash(true);
+    verify_random_operations(incremental);
+
+    // the flat engines hash a new key once, not once to look for it and again to place it
+    HashMap<std::string, int, counting_hash, robin_hood_storage> robin_hood;
+    robin_hood.reserve(1000);
+    counting_hash::calls = 0;
+    for (int i = 0; i < 1000; ++i) robin_hood.insert({std::to_string(i), i});
+    VERIFY_TRUE(counting_hash::calls == 1000 && robin_hood.size() == 1000, __LINE__);
+}
+
+template <typename Indexing>
+void verify_bucket_indexing() {
+    using Map = HashMap<int, int, std::hash<int>, basic_chained_storage<Indexing>>;
+    Map map;
+    verify_random_operations(map);
+    Map incremental;
+    incremental.incremental_rehash(true);
+    verify_random_operations(incremental);
+
+    // every index is in range, also for patterned keys
+    Map patterned(1);
+    for (int i = 0; i < 5000; ++i) patterned.insert({i * 1024, i});
+    for (int i = 0; i < 5000; ++i) VERIFY_TRUE(patterned.at(i * 1024) == i, __LINE__);
+    VERIFY_TRUE(patterned.load_factor() <= patterned.max_load_factor(), __LINE__);
+}
+
+void L_bucket_indexing() {
+    /*
+    * The power-of-two indexing policies round every bucket count up to a power of two,
+    * and all three policies give the same map contents.
+    */
+    HashMap<int, int, std::hash<int>, basic_chained_storage<fibonacci_indexing>> fibonacci(10);
+    VERIFY_TRUE(fibonacci.bucket_count() == 16, __LINE__);
+    fibonacci.rehash(1);
+    VERIFY_TRUE(fibonacci.bucket_count() == 1, __LINE__);
+    fibonacci.insert({1, 1});
+    fibonacci.insert({2, 2});
+    fibonacci.rehash(100);
+    VERIFY_TRUE(fibonacci.bucket_count() == 128 && fibonacci.at(2) == 2, __LINE__);
+    HashMap<int, int> modulo(10);
+    modulo.rehash(100);
+    VERIFY_TRUE(modulo.bucket_count() == 100, __LINE__);
+
+    verify_bucket_indexing<modulo_indexing>();
+    verify_bucket_indexing<mask_indexing>();
+    verify_bucket_indexing<fibonacci_indexing>();
+
+    // fibonacci_indexing spreads keys that share their low bits, mask_indexing can't
+    std::set<size_t> masked, spread;
+    for (int i = 0; i < 512; ++i) {
+        size_t hash = std::hash<int>()(i * 1024);
+        masked.insert(mask_indexing::index(hash, 1024));
+        spread.insert(fibonacci_indexing::index(hash, 1024));
+    }
+    VERIFY_TRUE(masked.size() == 1 && spread.size() > 256, __LINE__);
+    VERIFY_TRUE(*spread.rbegin() < 1024 && fibonacci_indexing::index(12345, 1) == 0, __LINE__);
+}
+
+template <typename Storage>
+void verify_bulk_build() {
+    using Map = HashMap<int, std::string, std::hash<int>, Storage>;
+    std::vector<std::pair<int, std::string>> rows;
+    for (int i = 0; i < 10000; ++i) rows.push_back({i * 7, std::to_string(i)});
+    std::shuffle(rows.begin(), rows.end(), std::default_random_engine{});
+
+    // duplicate keys in the range: the first one wins, as with insert
+    auto with_duplicates = rows;
+    with_duplicates.push_back({7, "duplicate"});
+    Map map(with_duplicates.begin(), with_duplicates.end());
+    VERIFY_TRUE(map.size() == 10000 && map.at(7) == "1", __LINE__);
+    VERIFY_TRUE(map.load_factor() <= map.max_load_factor(), __LINE__);
+
+    auto unique = Map::from_unique_range(rows.begin(), rows.end());
+    std::list<std::pair<int, std::string>> row_list(rows.begin(), rows.end());
+    auto from_list = Map::from_unique_range(row_list.begin(), row_list.end());
+    VERIFY_TRUE(unique == map && from_list == map && unique.load_factor() <= unique.max_load_factor(), __LINE__);
+    unique.insert({7, "again"});
+    unique.erase(14);
+    VERIFY_TRUE(unique.size() == 9999 && unique.at(7) == "1" && !unique.contains(14), __LINE__);
+
+    auto empty = Map::from_unique_range(rows.end(), rows.end());
+    VERIFY_TRUE(empty.empty() && empty.begin() == empty.end(), __LINE__);
+}
+
+void M_bulk_build() {
+    /*
+    * The range constructor and from_unique_range size the table once, and for the chained
+    * map take every node from one block, for every storage policy.
+    */
+    verify_bulk_build<chained_storage>();
+    verify_bulk_build<robin_hood_storage>();
+    verify_bulk_build<swiss_storage>();
+    verify_bulk_build<dense_storage>();
+    verify_bulk_build<small_storage<4>>();
+
+    std::vector<std::pair<int, int>> rows;
+    for (int i = 0; i < 10000; ++i) rows.push_back({i, -i});
+    counting_resource counter(std::pmr::new_delete_resource());
+    {
+        // the default bucket array, the reserved one and its occupancy bitmap, and one slab for all the nodes
+        auto map = ::pmr::HashMap<int, int>::from_unique_range(rows.begin(), rows.end(), std::hash<int>(), &counter);
+        VERIFY_TRUE(map.size() == 10000 && map.at(9999) == -9999 && counter.allocations == 4, __LINE__);
+        ::pmr::HashMap<int, int> ranged(rows.begin(), rows.end(), 10, std::hash<int>(), &counter);
+        VERIFY_TRUE(ranged == map && counter.allocations == 8, __LINE__);
+    }
+    VERIFY_TRUE(counter.in_use == 0, __LINE__);
+}
+
+void N_clone_copy() {
+    /*
+    * Copies clone the bucket structure: no key is hashed, chains keep their order (so the
+    * copy iterates like the original), and copy assignment reuses the old nodes' memory.
+    */
+    HashMap<std::string, int, counting_hash> original;
+    HashMap<std::string, int, uncached_counting_hash> uncached;
+    for (int i = 0; i < 1000; ++i) {
+        original.insert({std::to_string(i), i});
+        uncached.insert({std::to_string(i), i});
+    }
+    counting_hash::calls = 0;
+    HashMap<std::string, int, counting_hash> copy = original;
+    HashMap<std::string, int, uncached_counting_hash> uncached_copy = uncached;
+    VERIFY_TRUE(counting_hash::calls == 0, __LINE__);
+    VERIFY_TRUE(std::equal(copy.begin(), copy.end(), original.begin(), original.end()), __LINE__);
+    VERIFY_TRUE(std::equal(uncached_copy.begin(), uncached_copy.end(), uncached.begin(), uncached.end()), __LINE__);
+
+    HashMap<std::string, int, counting_hash> assigned(3);
+    assigned.insert({"stale", -1});
+    counting_hash::calls = 0;
+    assigned = original;
+    VERIFY_TRUE(counting_hash::calls == 0, __LINE__);
+    VERIFY_TRUE(assigned.bucket_count() == original.bucket_count() && !assigned.contains("stale"), __LINE__);
+    VERIFY_TRUE(std::equal(assigned.begin(), assigned.end(), original.begin(), original.end()), __LINE__);
+    VERIFY_TRUE(assigned.at("999") == 999 && assigned.erase("500") && !assigned.contains("500"), __LINE__);
+
+    // a map of the same shape is copied over without allocating anything
+    counting_resource counter(std::pmr::new_delete_resource());
+    {
+        ::pmr::HashMap<int, int> source(64, std::hash<int>(), &counter);
+        ::pmr::HashMap<int, int> target(64, std::hash<int>(), &counter);
+        for (int i = 0; i < 40; ++i) {
+            source.insert({i, -i});
+            target.insert({i + 1000, i});
+        }
+        size_t before = counter.allocations;
+        target = source;
+        VERIFY_TRUE(counter.allocations == before && target == source, __LINE__);
+    }
+    VERIFY_TRUE(counter.in_use == 0, __LINE__);
+
+    // copies taken in the middle of an incremental rehash finish it on their own
+    HashMap<int, int> growing(1);
+    growing.incremental_rehash(true);
+    for (int i = 0; !(growing.rehash_in_progress() && growing.size() > 1000); ++i) {
+        growing.insert({i, -i});
+    }
+    HashMap<int, int> growing_copy = growing;
+    HashMap<int, int> growing_assigned;
+    growing_assigned = growing;
+    VERIFY_TRUE(growing_copy.rehash_in_progress() && growing_assigned.rehash_in_progress(), __LINE__);
+    for (int i = 0; i < 5000; ++i) {
+        growing_copy.insert({-i - 1, i});
+        growing_assigned.erase(i);
+    }
+    VERIFY_TRUE(growing_copy.size() == growing.size() + 5000 && growing_assigned.empty(), __LINE__);
+    for (const auto& [key, mapped] : growing) VERIFY_TRUE(growing_copy.at(key) == mapped, __LINE__);
+}
+
+void O_concurrent_map() {
+    /*
+    * ConcurrentHashMap behaves like a map on one thread, and its operations stay atomic
+    * when many threads insert, update and erase at once while the map grows.
+    */
+    ConcurrentHashMap<int, int> map;
+    std::unordered_map<int, int> answer;
+    std::mt19937 rng(113);
+    for (int i = 0; i < 20000; ++i) {
+        int key = rng() % 3000;
+        switch (rng() % 4) {
+        case 0:
+            VERIFY_TRUE(map.insert({key, i}) == answer.insert({key, i}).second, __LINE__);
+            break;
+        case 1:
+            VERIFY_TRUE(map.erase(key) == (answer.erase(key) == 1), __LINE__);
+            break;
+        case 2:
+            VERIFY_TRUE(map.update(key, [](int& value) { value *= 2; }) == (answer.count(key) == 1), __LINE__);
+            if (answer.count(key)) answer[key] *= 2;
+            break;
+        default:
+            VERIFY_TRUE(map.find(key) == (answer.count(key) ? std::optional<int>(answer[key]) : std::nullopt), __LINE__);
+        }
+        VERIFY_TRUE(map.size() == answer.size(), __LINE__);
+    }
+    map.clear();
+    VERIFY_TRUE(map.empty() && !map.contains(0), __LINE__);
+
+    // each thread inserts its own keys while the map grows from its smallest size
+    const int threads = 8, per_thread = 10000;
+    ConcurrentHashMap<int, int> shared;
+    size_t initial_buckets = shared.bucket_count();
+    shared.insert({-1, 0});
+    auto run = [&](auto work) {
+        std::vector<std::thread> pool;
+        for (int t = 0; t < threads; ++t) pool.emplace_back(work, t);
+        for (auto& thread : pool) thread.join();
+    };
+    run([&](int t) {
+        for (int i = 0; i < per_thread; ++i) {
+            shared.insert({t * per_thread + i, t});
+            shared.update(-1, [](int& count) { ++count; }); // every thread bumps one hot key
+        }
+    });
+    VERIFY_TRUE(shared.size() == threads * per_thread + 1, __LINE__);
+    VERIFY_TRUE(shared.bucket_count() > initial_buckets && shared.find(-1) == threads * per_thread, __LINE__);
+
+    // each thread erases the next thread's keys while looking up its own
+    run([&](int t) {
+        int next = (t + 1) % threads;
+        for (int i = 0; i < per_thread; ++i) {
+            shared.erase(next * per_thread + i);
+            shared.find(t * per_thread + i);
+        }
+    });
+    VERIFY_TRUE(shared.size() == 1 && shared.find(-1) == threads * per_thread, __LINE__);
+}
+
+void P_lock_free_reads() {
+    /*
+    * The epoch only moves on once every pinned thread has seen the current one, and
+    * ConcurrentHashMap readers never miss a key or see a torn value while writers
+    * update, insert, erase and grow the map under them.
+    */
+    auto& domain = EpochDomain::global();
+    uint64_t start = domain.epoch();
+    {
+        auto guard = domain.pin();
+        auto nested = domain.pin();
+        VERIFY_TRUE(domain.try_advance() && !domain.try_advance(), __LINE__);
+        VERIFY_TRUE(!domain.can_free(start) && domain.epoch() == start + 1, __LINE__);
+    }
+    VERIFY_TRUE(domain.try_advance() && domain.can_free(start) && !domain.can_free(start + 1), __LINE__);
+
+    // stable keys are never erased, and their values always stay equal to the key mod 10000
+    const int stable = 5000;
+    ConcurrentHashMap<int, int> map;
+    for (int i = 0; i < stable; ++i) map.insert({i, i});
+    std::atomic<bool> done = false;
+    std::atomic<int> wrong = 0;
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&, t] {
+            std::mt19937 rng(t);
+            while (!done.load()) {
+                int key = rng() % stable;
+                auto value = map.find(key);
+                if (!value || *value % 10000 != key || !map.contains(key)) ++wrong;
+                map.find(stable + rng() % 100000); // volatile keys, hit or miss
+            }
+        });
+    }
+    std::thread updater([&] {
+        for (int round = 0; round < 20; ++round) {
+            for (int i = 0; i < stable; ++i) map.update(i, [](int& value) { value += 10000; });
+        }
+    });
+    std::thread churner([&] {
+        // grows the map several times, and erases most of what it inserts
+        for (int i = stable; i < stable + 100000; ++i) {
+            map.insert({i, i});
+            if (i % 4 != 0) map.erase(i);
+        }
+    });
+    updater.join();
+    churner.join();
+    done = true;
+    for (auto& reader : readers) reader.join();
+    VERIFY_TRUE(wrong == 0, __LINE__);
+    VERIFY_TRUE(map.size() == stable + 25000 && map.find(0) == 20 * 10000, __LINE__);
+}
+
+void Q_sharded_map() {
+    /*
+    * ShardedHashMap spreads even patterned keys over its shards, keeps counts exact under
+    * concurrent upserts, and for_each_shard sees every element exactly once, in parallel.
+    */
+    ShardedHashMap<int, long> counts(6);
+    VERIFY_TRUE(counts.shard_count() == 8, __LINE__);
+    VERIFY_TRUE(counts.insert({64, 1}) && !counts.insert({64, 2}) && counts.find(64) == 1L, __LINE__);
+    VERIFY_TRUE(counts.update(64, [](long& count) { count += 10; }) && counts.find(64) == 11L, __LINE__);
+    VERIFY_TRUE(!counts.update(65, [](long&) {}) && !counts.contains(65), __LINE__);
+    VERIFY_TRUE(counts.erase(64) && !counts.erase(64) && counts.empty(), __LINE__);
+
+    // multiples of 64 would all land in a few buckets with low bits; high bits spread them
+    std::vector<size_t> per_shard(counts.shard_count());
+    for (int i = 0; i < 8000; ++i) ++per_shard[counts.shard_index(64 * i)];
+    for (size_t shard_size : per_shard) VERIFY_TRUE(shard_size > 500 && shard_size < 1500, __LINE__);
+
+    // 8 threads bump the same 1000 counters
+    std::vector<std::thread> pool;
+    for (int t = 0; t < 8; ++t) {
+        pool.emplace_back([&] {
+            for (int i = 0; i < 20000; ++i) counts.upsert(i % 1000, [](long& count) { ++count; });
+        });
+    }
+    for (auto& thread : pool) thread.join();
+    VERIFY_TRUE(counts.size() == 1000 && counts.find(999) == 160L, __LINE__);
+
+    std::atomic<long> total = 0;
+    std::atomic<size_t> elements = 0;
+    counts.for_each_shard([&](const auto& shard) {
+        long sum = 0;
+        for (const auto& [key, count] : shard) sum += count;
+        total += sum;
+        elements += shard.size();
+    }, 4);
+    VERIFY_TRUE(total == 160000 && elements == 1000, __LINE__);
+
+    // shard-local writes, and an exception from one shard reaches the caller
+    counts.for_each_shard([](auto& shard) { shard.clear(); });
+    VERIFY_TRUE(counts.empty() && counts.with_shard(0, [](const auto& shard) { return shard.size(); }) == 0, __LINE__);
+    bool thrown = false;
+    try {
+        counts.for_each_shard([](auto&) { throw std::runtime_error("shard"); }, 3);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    VERIFY_TRUE(thrown, __LINE__);
+}
+
+template <typename Map>
+void verify_parallel_rehash(Map& map, size_t new_buckets, size_t threads) {
+    size_t size = map.size();
+    map.rehash(new_buckets, threads);
+    VERIFY_TRUE(map.size() == size && !map.rehash_in_progress(), __LINE__);
+    size_t seen = 0;
+    for (const auto& [key, mapped] : map) {
+        VERIFY_TRUE(mapped == -key && map.at(key) == -key, __LINE__);
+        ++seen;
+    }
+    VERIFY_TRUE(seen == size, __LINE__);
+}
+
+struct throwing_int_hash {
+    size_t operator()(int key) const { return std::hash<int>()(key); } // not noexcept
+};
+
+void R_parallel_rehash() {
+    /*
+    * rehash(new_buckets, threads) moves every node, with any number of threads, for every
+    * bucket indexing policy, and falls back to one thread when it has to. The maps are
+    * big enough to give several threads kParallelMin elements each.
+    */
+    HashMap<int, int> modulo;
+    HashMap<int, int, std::hash<int>, basic_chained_storage<mask_indexing>> mask;
+    HashMap<int, int, std::hash<int>, basic_chained_storage<fibonacci_indexing>> fibonacci;
+    HashMap<int, int, throwing_int_hash> uncached;
+    for (int i = 0; i < 300000; ++i) {
+        modulo.insert({i, -i});
+        mask.insert({i * 64, -i * 64});
+        fibonacci.insert({i * 7, -i * 7});
+        uncached.insert({i, -i});
+    }
+    for (size_t threads : {2, 3, 8, 100}) {
+        verify_parallel_rehash(modulo, 100003 * threads, threads);
+        VERIFY_TRUE(modulo.bucket_count() == 100003 * threads, __LINE__);
+        verify_parallel_rehash(mask, 1 << 17, threads);
+        verify_parallel_rehash(fibonacci, 1000, threads); // shrinking works too
+        verify_parallel_rehash(uncached, 50000 * threads, threads);
+        VERIFY_TRUE(fibonacci.bucket_count() == 1024, __LINE__);
+    }
+
+    // finishes a rehash in progress first, then moves everything at once
+    HashMap<int, int> growing(1);
+    growing.incremental_rehash(true);
+    for (int i = 0; !(growing.rehash_in_progress() && growing.size() > 140000); ++i) {
+        growing.insert({i, -i});
+    }
+    verify_parallel_rehash(growing, 200000, 4);
+    VERIFY_TRUE(growing.incremental_rehash() && growing.bucket_count() == 200000, __LINE__);
+
+    bool thrown = false;
+    try {
+        modulo.rehash(0, 4);
+    } catch (const std::out_of_range&) {
+        thrown = true;
+    }
+    VERIFY_TRUE(thrown, __LINE__);
+}
+
+template <typename Map>
+void verify_bucket_ranges(Map& map, size_t parts) {
+    auto ranges = map.bucket_ranges(parts);
+    size_t buckets = ranges.back().last_bucket();
+    VERIFY_TRUE(ranges.size() == std::min(std::max<size_t>(parts, 1), buckets), __LINE__);
+    VERIFY_TRUE(ranges.front().first_bucket() == 0, __LINE__);
+    // walking the ranges in order is the same as walking the map
+    auto iter = map.begin();
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        VERIFY_TRUE(i == 0 || ranges[i].first_bucket() == ranges[i - 1].last_bucket(), __LINE__);
+        VERIFY_TRUE(ranges[i].begin() == iter, __LINE__);
+        for (const auto& value : ranges[i]) {
+            VERIFY_TRUE(&value == &*iter, __LINE__);
+            ++iter;
+        }
+        VERIFY_TRUE(ranges[i].empty() == (ranges[i].begin() == ranges[i].end()), __LINE__);
+    }
+    VERIFY_TRUE(iter == map.end(), __LINE__);
+}
+
+void S_parallel_iteration() {
+    /*
+    * bucket_ranges splits the map into ranges that together visit every element once,
+    * and parallel_for_each and parallel_reduce visit every element once on any number
+    * of threads.
+    */
+    HashMap<int, long> map;
+    long expected = 0;
+    for (int i = 0; i < 300000; ++i) {
+        map.insert({i, i});
+        expected += i;
+    }
+    const auto& cmap = map;
+    auto sum = [](long lhs, long rhs) { return lhs + rhs; };
+    for (size_t threads : {0, 1, 3, 8}) {
+        verify_bucket_ranges(map, threads);
+        // init is used exactly once, whatever the number of threads
+        VERIFY_TRUE(cmap.parallel_reduce(7L, [](const auto& kv) { return kv.second; }, sum, threads)
+                    == expected + 7, __LINE__);
+
+        map.parallel_for_each([](auto& kv) { kv.second *= 2; }, threads);
+        std::atomic<size_t> visited = 0;
+        cmap.parallel_for_each([&](const auto& kv) {
+            VERIFY_TRUE(kv.second == 2L * kv.first, __LINE__);
+            ++visited;
+        }, threads);
+        VERIFY_TRUE(visited == map.size(), __LINE__);
+        map.parallel_for_each([](auto& kv) { kv.second /= 2; }, threads);
+    }
+    verify_bucket_ranges(map, map.bucket_count() + 10);
+    verify_bucket_ranges(cmap, 4);
+
+    // combines in order: concatenating the keys in every range gives the iteration order
+    std::vector<int> order;
+    for (const auto& [key, value] : map) {
+        order.push_back(key);
+    }
+    auto concat = [](std::vector<int> lhs, std::vector<int> rhs) {
+        lhs.insert(lhs.end(), rhs.begin(), rhs.end());
+        return lhs;
+    };
+    auto keys = cmap.parallel_reduce(std::vector<int>{}, [](const auto& kv) {
+        return std::vector<int>{kv.first};
+    }, concat, 4);
+    VERIFY_TRUE(keys == order, __LINE__);
+
+    // callers can hand the ranges to their own threads
+    std::vector<std::thread> pool;
+    for (auto range : map.bucket_ranges(4)) {
+        pool.emplace_back([range] {
+            for (auto& [key, value] : range) {
+                value = -key;
+            }
+        });
+    }
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    for (const auto& [key, value] : map) {
+        VERIFY_TRUE(value == -key, __LINE__);
+    }
+
+    // the buckets of a rehash in progress are covered too
+    HashMap<int, long> growing(1);
+    growing.incremental_rehash(true);
+    long growing_expected = 0;
+    for (int i = 0; !(growing.rehash_in_progress() && growing.size() > 40000); ++i) {
+        growing.insert({i, i});
+        growing_expected += i;
+    }
+    verify_bucket_ranges(growing, 5);
+    VERIFY_TRUE(growing.parallel_reduce(0L, [](const auto& kv) { return kv.second; }, sum, 5)
+                == growing_expected, __LINE__);
+    VERIFY_TRUE(growing.rehash_in_progress(), __LINE__);
+
+    // small and empty maps, and exceptions from fn
+    HashMap<int, long> small{{1, 1}, {2, 2}};
+    VERIFY_TRUE(small.parallel_reduce(0L, [](const auto& kv) { return kv.second; }, sum, 8) == 3, __LINE__);
+    HashMap<int, long> empty;
+    verify_bucket_ranges(empty, 3);
+    VERIFY_TRUE(empty.parallel_reduce(5L, [](const auto& kv) { return kv.second; }, sum, 8) == 5, __LINE__);
+    bool thrown = false;
+    try {
+        map.parallel_for_each([](auto& kv) {
+            if (kv.first == 500) throw std::runtime_error("element");
+        }, 4);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    VERIFY_TRUE(thrown, __LINE__);
+}
+
+template <typename Map>
+size_t count_through_buckets(const Map& map, size_t buckets) {
+    size_t count = 0;
+    for (size_t n = 0; n < buckets; ++n) {
+        size_t in_bucket = 0;
+        for (auto iter = map.begin(n); iter != map.end(n); ++iter) {
+            VERIFY_TRUE(map.bucket(iter->first) == n, __LINE__);
+            ++in_bucket;
+        }
+        VERIFY_TRUE(in_bucket == map.bucket_size(n), __LINE__);
+        count += in_bucket;
+    }
+    return count;
+}
+
+void T_bucket_interface() {
+    /*
+    * bucket, bucket_size, begin(n)/end(n) and max_bucket_count behave like
+    * std::unordered_map's, including during an incremental rehash.
+    */
+    HashMap<int, int> map;
+    std::unordered_map<int, int> std_map;
+    for (int i = 0; i < 1000; ++i) {
+        map.insert({i * 7, i});
+        std_map.insert({i * 7, i});
+    }
+    // the same generic code works on both
+    VERIFY_TRUE(count_through_buckets(map, map.bucket_count()) == map.size(), __LINE__);
+    VERIFY_TRUE(count_through_buckets(std_map, std_map.bucket_count()) == std_map.size(), __LINE__);
+    VERIFY_TRUE(map.max_bucket_count() >= map.bucket_count(), __LINE__);
+
+    // local iterators can modify, and convert to const_local_iterators
+    size_t n = map.bucket(70);
+    HashMap<int, int>::local_iterator iter = map.begin(n);
+    while (iter->first != 70) ++iter;
+    iter->second = -1;
+    const auto& cmap = map;
+    HashMap<int, int>::const_local_iterator citer = iter;
+    VERIFY_TRUE(citer->second == -1 && cmap.at(70) == -1, __LINE__);
+    VERIFY_TRUE(std::distance(cmap.begin(n), cmap.end(n)) == std::ptrdiff_t(cmap.bucket_size(n)), __LINE__);
+
+    // absent keys still have a bucket, and an empty bucket is empty
+    HashMap<int, int> empty(8);
+    VERIFY_TRUE(empty.bucket(3) < 8 && empty.bucket_size(empty.bucket(3)) == 0, __LINE__);
+    VERIFY_TRUE(empty.begin(empty.bucket(3)) == empty.end(empty.bucket(3)), __LINE__);
+
+    // skewed keys show up as hot buckets: 13 hash codes for 100 keys
+    HashMap<int, int, few_hashes> skewed;
+    for (int i = 0; i < 100; ++i) skewed.insert({i, i});
+    size_t hottest = 0;
+    for (size_t b = 0; b < skewed.bucket_count(); ++b) {
+        hottest = std::max(hottest, skewed.bucket_size(b));
+    }
+    VERIFY_TRUE(hottest > 100 / 13 && hottest < 100 / 2, __LINE__);
+
+    // while a rehash is in progress, keys not moved yet are in the old buckets
+    HashMap<int, int> growing(1);
+    growing.incremental_rehash(true);
+    int last = 0;
+    for (; !growing.rehash_in_progress() || growing.size() < 1000; ++last) {
+        growing.insert({last, last});
+    }
+    bool in_old = false;
+    for (int i = 0; i < last; ++i) {
+        size_t b = growing.bucket(i);
+        in_old = in_old || b >= growing.bucket_count();
+        VERIFY_TRUE(std::find_if(growing.begin(b), growing.end(b),
+                                 [&](const auto& kv) { return kv.first == i; }) != growing.end(b), __LINE__);
+    }
+    VERIFY_TRUE(in_old, __LINE__);
+    growing.incremental_rehash(false);
+    VERIFY_TRUE(count_through_buckets(growing, growing.bucket_count()) == growing.size(), __LINE__);
+
+    // transparent keys
+    HashMap<counted_string, int, counted_string_hash> strings;
+    strings[counted_string("Avery")] = 1;
+    VERIFY_TRUE(strings.bucket("Avery") == strings.bucket(counted_string("Avery")), __LINE__);
+    VERIFY_TRUE(strings.begin(strings.bucket("Avery"))->second == 1, __LINE__);
+}
+
+template <typename Map>
+void verify_iterates_all(const Map& map, const std::set<int>& keys) {
+    std::set<int> seen;
+    for (const auto& [key, mapped] : map) {
+        VERIFY_TRUE(keys.count(key) == 1 && seen.insert(key).second, __LINE__);
+    }
+    VERIFY_TRUE(seen.size() == keys.size() && map.size() == keys.size(), __LINE__);
+    VERIFY_TRUE(keys.empty() == (map.begin() == map.end()), __LINE__);
+}
+
+/*
+* A mapped value whose copy constructor throws once copies_left runs out.
+*/
+struct limited_copies {
+    static inline int copies_left = 0;
+    int value;
+
+    explicit limited_copies(int value) : value(value) {}
+    limited_copies(const limited_copies& rhs) : value(rhs.value) {
+        if (copies_left-- == 0) throw std::runtime_error("limited_copies: out of copies");
+    }
+    limited_copies& operator=(const limited_copies& rhs) = default;
+};
+
+void U_occupancy_bitmap() {
+    /*
+    * Iteration skips empty buckets through the occupancy bitmap, which has to follow
+    * every insert, erase, rehash, copy and move.
+    */
+    HashMap<int, int> sparse(1 << 20);
+    std::set<int> keys;
+    for (int i = 0; i < 200; ++i) {
+        int key = i * 5003;
+        sparse.insert({key, i});
+        keys.insert(key);
+    }
+    verify_iterates_all(sparse, keys);
+
+    // erase through keys and through iterators, emptying buckets in every word
+    for (int i = 0; i < 200; i += 3) {
+        sparse.erase(i * 5003);
+        keys.erase(i * 5003);
+    }
+    for (auto iter = sparse.begin(); iter != sparse.end(); ) {
+        if (iter->second % 3 == 1) {
+            keys.erase(iter->first);
+            iter = sparse.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    verify_iterates_all(sparse, keys);
+    sparse.emplace(64, 0); // the last bucket of a word and the first of the next
+    sparse.emplace(63, 0);
+    keys.insert({63, 64});
+    verify_iterates_all(sparse, keys);
+
+    // shrinking, growing on several threads, and an incremental rehash
+    sparse.rehash(7);
+    verify_iterates_all(sparse, keys);
+    for (int i = 0; i < 50000; ++i) {
+        sparse.insert({-i - 1, i});
+        keys.insert(-i - 1);
+    }
+    sparse.rehash(1 << 18, 4);
+    verify_iterates_all(sparse, keys);
+    sparse.incremental_rehash(true);
+    sparse.rehash(1 << 19);
+    VERIFY_TRUE(sparse.rehash_in_progress(), __LINE__);
+    verify_iterates_all(sparse, keys);
+    for (int i = 0; i < 1000; ++i) {
+        sparse.erase(-i - 1);
+        keys.erase(-i - 1);
+    }
+    verify_iterates_all(sparse, keys);
+    sparse.incremental_rehash(false);
+    verify_iterates_all(sparse, keys);
+
+    // copies and moves take the bitmap with them
+    HashMap<int, int> copy(sparse);
+    verify_iterates_all(copy, keys);
+    HashMap<int, int> assigned{{1, 1}};
+    assigned = sparse;
+    verify_iterates_all(assigned, keys);
+    HashMap<int, int> moved(std::move(copy));
+    verify_iterates_all(moved, keys);
+    verify_iterates_all(copy, {});
+    copy.insert({5, 5});
+    verify_iterates_all(copy, {5});
+    assigned = std::move(moved);
+    verify_iterates_all(assigned, keys);
+    assigned.clear();
+    verify_iterates_all(assigned, {});
+
+    // a copy that throws part way leaves only the buckets copied so far marked
+    limited_copies::copies_left = 1 << 30;
+    HashMap<int, limited_copies> source(1 << 12);
+    for (int i = 0; i < 500; ++i) source.insert({i * 7, limited_copies(i)});
+    HashMap<int, limited_copies> partial;
+    limited_copies::copies_left = 250;
+    bool thrown = false;
+    try {
+        partial = source;
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    limited_copies::copies_left = 1 << 30;
+    partial.insert({4004, limited_copies(572)}); // in a bucket past every one rhs had
+    size_t seen = 0;
+    for (const auto& [key, mapped] : partial) {
+        VERIFY_TRUE(key == mapped.value * 7, __LINE__);
+        ++seen;
+    }
+    VERIFY_TRUE(thrown && seen == 251 && partial.size() == 251, __LINE__);
+
+    HashMap<int, int> random(1 << 16);
+    random.incremental_rehash(true);
+    verify_random_operations(random);
+}
+
+void V_dense_storage() {
+    /*
+    * Verifies the dense_storage policy against std::unordered_map, and checks that it
+    * iterates in insertion order through erases, tombstone compaction and rehashes.
+    */
+    HashMap<int, int, std::hash<int>, dense_storage> map;
+    verify_random_operations(map);
+
+    auto constant = [](const int&) { return size_t{0}; };
+    HashMap<int, int, decltype(constant), dense_storage> collide(1, constant);
+    verify_random_operations(collide);
+
+    HashMap<std::string, int, std::hash<std::string>, dense_storage> names;
+    std::vector<std::string> order;
+    for (const auto& kv_pair : vec) {
+        if (names.insert(kv_pair).second) order.push_back(kv_pair.first);
+    }
+    std::vector<std::string> visited;
+    for (const auto& [name, mapped] : names) visited.push_back(name);
+    VERIFY_TRUE(visited == order, __LINE__);
+
+    // erase never moves the other elements, so erasing while iterating keeps the order
+    HashMap<int, int, std::hash<int>, dense_storage> ordered;
+    std::vector<int> kept;
+    for (int i = 0; i < 1000; ++i) {
+        int key = (i * 7919) % 1000;
+        ordered.insert({key, i});
+        if (i % 3 != 0) kept.push_back(key);
+    }
+    std::vector<std::pair<const int, int>*> addresses;
+    for (auto& pair : ordered) addresses.push_back(&pair);
+    for (auto iter = ordered.begin(); iter != ordered.end(); ) {
+        iter = (iter->second % 3 == 0) ? ordered.erase(iter) : ++iter;
+    }
+    std::vector<int> remaining;
+    for (auto& pair : ordered) {
+        remaining.push_back(pair.first);
+        VERIFY_TRUE(&pair == addresses[pair.second], __LINE__);
+    }
+    VERIFY_TRUE(remaining == kept, __LINE__);
+
+    // compacting the tombstones (on rehash, or when inserts run out of room) keeps the order,
+    // and a key inserted again goes to the end
+    ordered.rehash(1);
+    remaining.clear();
+    for (const auto& [key, mapped] : ordered) remaining.push_back(key);
+    VERIFY_TRUE(remaining == kept, __LINE__);
+    ordered.erase(kept.front());
+    ordered.insert({kept.front(), -1});
+    std::rotate(kept.begin(), kept.begin() + 1, kept.end());
+    remaining.clear();
+    for (const auto& [key, mapped] : ordered) remaining.push_back(key);
+    VERIFY_TRUE(remaining == kept, __LINE__);
+
+    // insert/erase churn reuses the room its tombstones take instead of growing forever
+    HashMap<int, int, std::hash<int>, dense_storage> churn;
+    for (int i = 0; i < 100000; ++i) {
+        churn.insert({i, i});
+        if (i >= 50) churn.erase(i - 50);
+    }
+    VERIFY_TRUE(churn.size() == 50 && churn.bucket_count() <= 256, __LINE__);
+    int expected = 100000 - 50;
+    for (const auto& [key, mapped] : churn) VERIFY_TRUE(key == expected++, __LINE__);
+
+    // the value may come from the map itself, even when the insert grows or compacts it
+    HashMap<int, std::string, std::hash<int>, dense_storage> strings;
+    strings.try_emplace(0, std::string(40, 'x'));
+    for (int i = 1; i < 1000; ++i) {
+        strings.try_emplace(i, strings.at(i - 1));
+        if (i >= 50) strings.erase(i - 50);
+    }
+    VERIFY_TRUE(strings.size() == 50, __LINE__);
+    for (const auto& [key, mapped] : strings) VERIFY_TRUE(mapped == std::string(40, 'x'), __LINE__);
+
+    auto copy = names;
+    VERIFY_TRUE(copy == names, __LINE__);
+    auto moved = std::move(copy);
+    VERIFY_TRUE(moved == names, __LINE__);
+    VERIFY_TRUE(copy.empty() && copy.begin() == copy.end(), __LINE__);
+    copy["Anna"] = 1;
+    VERIFY_TRUE(copy.at("Anna") == 1, __LINE__);
+}
+void W_snapshot() {
+    /*
+    * A snapshot read back through MappedHashMap has exactly the saved elements, and
+    * opening one checks that it is a snapshot of the right key and mapped types.
+    */
+    std::string path = (std::filesystem::temp_directory_path() / "hashmap_w_snapshot.snap").string();
+    HashMap<std::string, int> names;
+    for (const auto& kv_pair : vec) names.insert(kv_pair);
+    for (int i = 0; i < 10000; ++i) names.insert({"key" + std::to_string(i), i});
+    names.insert({"", -1});
+    save_snapshot(names, path);
+
+    MappedHashMap<std::string, int> mapped(path);
+    VERIFY_TRUE(mapped.size() == names.size() && !mapped.empty(), __LINE__);
+    for (const auto& [key, value] : names) {
+        VERIFY_TRUE(mapped.contains(key) && mapped.at(key) == value, __LINE__);
+        VERIFY_TRUE(mapped.find(key)->first == key && mapped.find(key)->second == value, __LINE__);
+    }
+    VERIFY_TRUE(!mapped.contains("Not found") && mapped.find("key10000") == mapped.end(), __LINE__);
+    try {
+        mapped.at("Not found");
+        VERIFY_TRUE(false, __LINE__);
+    } catch (const std::out_of_range&) {}
+    std::set<std::string> seen;
+    for (auto [key, value] : mapped) {
+        VERIFY_TRUE(seen.insert(std::string(key)).second && names.at(std::string(key)) == value, __LINE__);
+    }
+    VERIFY_TRUE(seen.size() == names.size(), __LINE__);
+
+    // saving again replaces the file, and the old mapping keeps reading the old snapshot
+    names.erase("Avery");
+    names["Anna"] = 2021;
+    save_snapshot(names, path);
+    VERIFY_TRUE(mapped.contains("Avery") && mapped.at("Anna") == 2020, __LINE__);
+    MappedHashMap<std::string, int> reopened(path);
+    VERIFY_TRUE(!reopened.contains("Avery") && reopened.at("Anna") == 2021, __LINE__);
+    MappedHashMap<std::string, int> moved(std::move(reopened));
+    VERIFY_TRUE(moved.size() == names.size() && reopened.empty() && !reopened.contains("Anna"), __LINE__);
+
+    // any storage policy, trivially copyable keys, and an empty map
+    struct point { double x, y; };
+    HashMap<int, point, std::hash<int>, swiss_storage> points;
+    for (int i = 0; i < 1000; ++i) points.insert({i * 3, {i * 0.5, -i * 0.5}});
+    save_snapshot(points, path);
+    MappedHashMap<int, point> mapped_points(path);
+    VERIFY_TRUE(mapped_points.size() == 1000 && mapped_points.at(999 * 3).y == -999 * 0.5, __LINE__);
+    VERIFY_TRUE(!mapped_points.contains(1), __LINE__);
+    save_snapshot(HashMap<int, point>(), path);
+    MappedHashMap<int, point> mapped_empty(path);
+    VERIFY_TRUE(mapped_empty.empty() && mapped_empty.begin() == mapped_empty.end() && !mapped_empty.contains(0), __LINE__);
+
+    // wrong types, a file that isn't a snapshot, and a missing file
+    try {
+        MappedHashMap<int, int> wrong_types(path);
+        VERIFY_TRUE(false, __LINE__);
+    } catch (const std::runtime_error&) {}
+    std::ofstream(path, std::ios::trunc) << "not a snapshot, but long enough to have a header's worth of bytes in it";
+    try {
+        MappedHashMap<int, point> not_snapshot(path);
+        VERIFY_TRUE(false, __LINE__);
+    } catch (const std::runtime_error&) {}
+    std::filesystem::remove(path);
+    try {
+        MappedHashMap<int, point> missing(path);
+        VERIFY_TRUE(false, __LINE__);
+    } catch (const std::system_error&) {}
+}
+void X_frozen_map() {
+    /*
+    * A FrozenHashMap finds every key of the HashMap it was built from in its own slot,
+    * and rejects every other key.
+    */
+    HashMap<std::string, int> names;
+    for (const auto& kv_pair : vec) names.insert(kv_pair);
+    auto frozen_names = FrozenHashMap<std::string, int>::build(names);
+    VERIFY_TRUE(frozen_names.size() == names.size(), __LINE__);
+    for (const auto& [key, value] : names) {
+        VERIFY_TRUE(frozen_names.contains(key) && frozen_names.at(key) == value, __LINE__);
+    }
+    VERIFY_TRUE(!frozen_names.contains("Not found") && frozen_names.find("") == frozen_names.end(), __LINE__);
+    try {
+        frozen_names.at("Not found");
+        VERIFY_TRUE(false, __LINE__);
+    } catch (const std::out_of_range&) {}
+
+    // every size from empty up, built from any storage policy, with an identity hash function
+    for (int size : {0, 1, 2, 3, 5, 17, 100, 1000, 100000}) {
+        HashMap<int, int, std::hash<int>, robin_hood_storage> map;
+        for (int i = 0; i < size; ++i) map.insert({i * 7, -i});
+        auto frozen = FrozenHashMap<int, int>::build(map);
+        VERIFY_TRUE(frozen.size() == map.size() && frozen.empty() == (size == 0), __LINE__);
+        std::vector<bool> slot_used(size, false);
+        for (int i = 0; i < size; ++i) {
+            auto found = frozen.find(i * 7);
+            VERIFY_TRUE(found != frozen.end() && found->first == i * 7 && found->second == -i, __LINE__);
+            VERIFY_TRUE(!slot_used[found - frozen.begin()], __LINE__);
+            slot_used[found - frozen.begin()] = true;
+            VERIFY_TRUE(!frozen.contains(i * 7 + 1) && !frozen.contains(-i - 1), __LINE__);
+        }
+        long long sum = 0;
+        for (const auto& [key, value] : frozen) sum += value;
+        VERIFY_TRUE(sum == -static_cast<long long>(size) * (size - 1) / 2, __LINE__);
+    }
+
+    // keys with the same hash code can't be told apart by any perfect hash
+    auto constant = [](const int&) { return size_t{0}; };
+    HashMap<int, int, decltype(constant)> collide(1, constant);
+    collide.insert({1, 1});
+    VERIFY_TRUE(FrozenHashMap<int, int, decltype(constant)>::build(collide).at(1) == 1, __LINE__);
+    collide.insert({2, 2});
+    try {
+        FrozenHashMap<int, int, decltype(constant)>::build(collide);
+        VERIFY_TRUE(false, __LINE__);
+    } catch (const std::invalid_argument&) {}
+}
+void Y_static_map() {
+    /*
+    * A constexpr StaticHashMap is built by the compiler: its lookups can appear in
+    * static_asserts, and the same map answers ordinary lookups at run time.
+    */
+    static constexpr StaticHashMap<std::string_view, int, 4> keywords{
+        {"if", 1}, {"else", 2}, {"while", 3}, {"return", 4}, {"if", 5}
+    };
+    static_assert(keywords.size() == 4 && keywords.capacity() == 4);
+    static_assert(keywords.at("if") == 1 && keywords.at("return") == 4);
+    static_assert(!keywords.contains("for") && keywords.find("") == keywords.end());
+    static_assert(keywords.begin()->first == "if" && (keywords.end() - 1)->first == "return");
+
+    std::string token = "while";
+    VERIFY_TRUE(keywords.contains(token) && keywords.find(token)->second == 3, __LINE__);
+    VERIFY_TRUE(!keywords.contains(token + "s") && keywords.find("whil") == keywords.end(), __LINE__);
+    try {
+        keywords.at("for");
+        VERIFY_TRUE(false, __LINE__);
+    } catch (const std::out_of_range&) {}
+
+    // integer keys sharing their low bits; an empty map; a map over capacity
+    constexpr StaticHashMap<int, int, 64> squares{
+        {0, 0}, {16, 256}, {32, 1024}, {48, 2304}, {64, 4096}, {80, 6400}, {96, 9216}
+    };
+    static_assert(squares.at(48) == 2304 && !squares.contains(112) && !squares.contains(-16));
+    int sum = 0;
+    for (const auto& [key, value] : squares) {
+        VERIFY_TRUE(value == key * key, __LINE__);
+        sum += key;
+    }
+    VERIFY_TRUE(sum == 336, __LINE__);
+    constexpr StaticHashMap<int, char, 0> none{};
+    static_assert(none.empty() && !none.contains(0) && none.begin() == none.end());
+    try {
+        StaticHashMap<int, int, 2> small{{1, 1}, {2, 2}, {3, 3}};
+        VERIFY_TRUE(false, __LINE__);
+    } catch (const std::length_error&) {}
+}
+void Z_small_storage() {
+    /*
+    * A small_storage<N> map keeps up to N elements inside the map object and finds them
+    * by scanning, then builds its index table once it outgrows N. Its iterators and
+    * insertion order carry across that switch.
+    */
+    using small_map = HashMap<int, int, std::hash<int>, small_storage<8>>;
+    auto is_inline = [](const auto& map, const auto& element) {
+        auto address = reinterpret_cast<const char*>(&element);
+        auto object = reinterpret_cast<const char*>(&map);
+        return address >= object && address < object + sizeof(map);
+    };
+
+    small_map map;
+    VERIFY_TRUE(map.empty() && map.bucket_count() == 0 && map.begin() == map.end(), __LINE__);
+    for (int i = 0; i < 8; ++i) map.insert({i * 7, i});
+    VERIFY_TRUE(map.size() == 8 && map.bucket_count() == 0, __LINE__);
+    for (const auto& element : map) VERIFY_TRUE(is_inline(map, element), __LINE__);
+    VERIFY_TRUE(map.at(49) == 7 && !map.contains(8) && map.find(1) == map.end(), __LINE__);
+
+    // erasing makes room again without building the index table
+    map.erase(0);
+    map.erase(map.find(14));
+    map.insert({100, 8});
+    map[101] = 9;
+    VERIFY_TRUE(map.size() == 8 && map.bucket_count() == 0, __LINE__);
+    std::vector<int> order;
+    for (const auto& [key, mapped] : map) order.push_back(key);
+    VERIFY_TRUE(order == std::vector<int>({7, 21, 28, 35, 42, 49, 100, 101}), __LINE__);
+
+    // the ninth element switches to the hashed layout, keeping the order
+    map.insert({102, 10});
+    VERIFY_TRUE(map.size() == 9 && map.bucket_count() > 0, __LINE__);
+    VERIFY_TRUE(!is_inline(map, *map.begin()), __LINE__);
+    order.push_back(102);
+    std::vector<int> visited;
+    for (const auto& [key, mapped] : map) visited.push_back(key);
+    VERIFY_TRUE(visited == order, __LINE__);
+    VERIFY_TRUE(map.at(102) == 10 && map.at(7) == 1, __LINE__);
+
+    // copies and moves of a small map stay small, and a moved-from map is usable
+    small_map tiny{{1, 1}, {2, 2}};
+    small_map copy = tiny;
+    VERIFY_TRUE(copy == tiny && copy.bucket_count() == 0 && is_inline(copy, *copy.begin()), __LINE__);
+    small_map moved = std::move(copy);
+    VERIFY_TRUE(moved == tiny && is_inline(moved, *moved.begin()), __LINE__);
+    VERIFY_TRUE(copy.empty() && copy.begin() == copy.end(), __LINE__);
+    copy[3] = 3;
+    VERIFY_TRUE(copy.at(3) == 3, __LINE__);
+
+    // reserve past N builds the index table up front; then it behaves like dense_storage
+    small_map reserved;
+    reserved.reserve(100);
+    VERIFY_TRUE(reserved.bucket_count() >= 128, __LINE__);
+    HashMap<int, int, std::hash<int>, small_storage<4>> random;
+    verify_random_operations(random);
+    auto constant = [](const int&) { return size_t{0}; };
+    HashMap<int, int, decltype(constant), small_storage<4>> collide(1, constant);
+    verify_random_operations(collide);
+
+    HashMap<std::string, int, std::hash<std::string>, small_storage<3>> names;
+    for (const auto& kv_pair : vec) names.insert(kv_pair);
+    VERIFY_TRUE(names.size() == 8 && names.at("Anna") == 2020 && names.at("A") == 3, __LINE__);
+
+    // the fifth element spills the inline ones, so its value is copied before they move
+    HashMap<int, std::string, std::hash<int>, small_storage<4>> strings;
+    for (int i = 0; i < 4; ++i) strings.try_emplace(i, std::string(40, 'a' + i));
+    strings.try_emplace(4, strings.at(0));
+    VERIFY_TRUE(strings.bucket_count() > 0 && strings.at(4) == std::string(40, 'a'), __LINE__);
+    VERIFY_TRUE(strings.at(3) == std::string(40, 'd'), __LINE__);
+}
+void AA_find_many() {
+    /*
+    * find_many and contains_many give the same answers as a loop of find and contains,
+    * in order, whether the keys are in the map or not, across batch boundaries, long
+    * chains, const maps and an incremental rehash in progress, on tables small enough for
+    * a plain loop and big enough for batches.
+    */
+    auto verify_batched = [](auto& map, const std::vector<int>& probe) {
+        std::vector<typename std::decay_t<decltype(map)>::iterator> found;
+        auto out = map.find_many(probe.begin(), probe.end(), std::back_inserter(found));
+        (void) out;
+        std::vector<bool> present;
+        map.contains_many(probe.begin(), probe.end(), std::back_inserter(present));
+        VERIFY_TRUE(found.size() == probe.size() && present.size() == probe.size(), __LINE__);
+        for (size_t i = 0; i < probe.size(); ++i) {
+            VERIFY_TRUE(found[i] == map.find(probe[i]) && present[i] == map.contains(probe[i]), __LINE__);
+            VERIFY_TRUE(found[i] == map.end() || found[i]->first == probe[i], __LINE__);
+        }
+        const auto& cmap = map;
+        std::vector<typename std::decay_t<decltype(map)>::const_iterator> const_found(probe.size(), cmap.end());
+        auto end = cmap.find_many(probe.begin(), probe.end(), const_found.begin());
+        VERIFY_TRUE(end == const_found.end(), __LINE__);
+        for (size_t i = 0; i < probe.size(); ++i) VERIFY_TRUE(const_found[i] == cmap.find(probe[i]), __LINE__);
+    };
+
+    std::vector<int> probe(1000);
+    std::iota(probe.begin(), probe.end(), -300);
+    std::shuffle(probe.begin(), probe.end(), std::default_random_engine{});
+    HashMap<int, int> map;
+    for (int i = 0; i < 500; ++i) map.insert({i, -i});
+    verify_batched(map, probe);
+    std::vector<int> none;
+    std::vector<bool> present;
+    VERIFY_TRUE(map.contains_many(none.begin(), none.end(), present.begin()) == present.begin(), __LINE__);
+    map.rehash(1 << 14);
+    verify_batched(map, probe);
+    VERIFY_TRUE(map.contains_many(none.begin(), none.end(), present.begin()) == present.begin(), __LINE__);
+
+    auto constant = [](const int&) { return size_t{0}; };
+    for (size_t buckets : {size_t{1}, size_t{1} << 14}) {
+        HashMap<int, int, decltype(constant)> collide(buckets, constant);
+        for (int i = 0; i < 100; ++i) collide.insert({i * 3, i});
+        verify_batched(collide, probe);
+    }
+
+    for (size_t size : {300, 10000}) {
+        HashMap<int, int> growing(1);
+        growing.incremental_rehash(true);
+        for (int i = 0; !(growing.rehash_in_progress() && growing.size() > size); ++i) growing.insert({i, -i});
+        verify_batched(growing, probe);
+    }
+
+    HashMap<std::string, int> names;
+    for (const auto& kv_pair : vec) names.insert(kv_pair);
+    std::vector<std::string> name_probe{"A", "Not found", "Avery", "", "Ali", "K"};
+    std::vector<bool> names_present;
+    names.contains_many(name_probe.begin(), name_probe.end(), std::back_inserter(names_present));
+    VERIFY_TRUE(names_present == std::vector<bool>({true, false, true, false, true, true}), __LINE__);
+}
+#endif
+
 std::string print_with_commas(long long int n)
 {
     std::string ans = "";
@@ -1786,6 +3479,18 @@ std::string print_with_commas(long long int n)
     return ans;
 }
 
+/*
+* Prints how long one implementation took as a multiple of another's. Benchmarks compare
+* implementations this way rather than with VERIFY_TRUE, since timings on a shared machine
+* vary too much from run to run for a close comparison to decide a test.
+*/
+void print_ratio(const std::string& label, size_t timing, size_t other_timing)
+{
+    std::ostringstream ratio;
+    ratio << std::fixed << std::setprecision(2) << double(timing) / std::max<size_t>(other_timing, 1);
+    std::cout << label << ": " << ratio.str() << "x" << std::endl;
+}
+
 int A_benchmark_insert_erase() {
     cout << "Task: insert then erase N elements, measured in ns." << endl;
     auto good_hash_function = [](const int& key) {
@@ -1847,6 +3552,326 @@ int A_benchmark_insert_erase() {
     return true;
 }
 
+int H_benchmark_concurrent_insert_erase() {
+    cout << "Task: T threads insert then erase 1,000,000 elements between them, measured in ns." << endl;
+    cout << "(this machine runs " << std::thread::hardware_concurrency() << " threads at once)" << endl;
+    const size_t size = 1000000;
+    std::vector<int> million(size);
+    std::iota(million.begin(), million.end(), 0);
+    std::shuffle(million.begin(), million.end(), std::default_random_engine{});
+
+    // thread t works on its own slice of million
+    auto time_threads = [&](size_t threads, auto work) {
+        auto start = clock_type::now();
+        std::vector<std::thread> pool;
+        for (size_t t = 0; t < threads; ++t) {
+            pool.emplace_back(work, million.begin() + t * size / threads, million.begin() + (t + 1) * size / threads);
+        }
+        for (auto& thread : pool) thread.join();
+        return static_cast<size_t>(std::chrono::duration_cast<ns>(clock_type::now() - start).count());
+    };
+
+    size_t max_threads = std::max(8u, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        ConcurrentHashMap<int, int> concurrent(size);
+        size_t concurrent_result = time_threads(threads, [&](auto first, auto last) {
+            for (auto iter = first; iter != last; ++iter) concurrent.insert({*iter, *iter});
+            for (auto iter = first; iter != last; ++iter) concurrent.erase(*iter);
+        });
+
+        // the baseline: the whole HashMap behind one mutex
+        HashMap<int, int> locked(size);
+        std::mutex lock;
+        size_t locked_result = time_threads(threads, [&](auto first, auto last) {
+            for (auto iter = first; iter != last; ++iter) {
+                std::lock_guard guard(lock);
+                locked.insert({*iter, *iter});
+            }
+            for (auto iter = first; iter != last; ++iter) {
+                std::lock_guard guard(lock);
+                locked.erase(*iter);
+            }
+        });
+        VERIFY_TRUE(concurrent.empty() && locked.empty(), __LINE__);
+
+        std::cout << "threads " << std::setw(3) << threads;
+        std::cout << " | ConcurrentHashMap: " << std::setw(13) << print_with_commas(concurrent_result);
+        std::cout << " | HashMap + one mutex: " << std::setw(13) << print_with_commas(locked_result) << std::endl;
+    }
+    return true;
+}
+
+int I_benchmark_concurrent_reads() {
+    cout << "Task: T threads find 500,000 keys each (random hit/miss) in 100,000 elements, measured in ns." << endl;
+    const int size = 100000, finds = 500000;
+    std::vector<int> lookup(finds);
+    std::mt19937 key_rng(114);
+    for (int& key : lookup) key = key_rng() % (2 * size);
+
+    // the writer, if any, inserts and erases keys the readers never look for
+    auto time_readers = [&](size_t threads, bool with_writer, auto find, auto write) {
+        std::atomic<bool> done = false;
+        std::thread writer;
+        if (with_writer) {
+            writer = std::thread([&] {
+                for (int i = 0; !done.load(std::memory_order_relaxed); ++i) write(2 * size + i % 1000);
+            });
+        }
+        std::atomic<size_t> hits = 0;
+        auto start = clock_type::now();
+        std::vector<std::thread> pool;
+        for (size_t t = 0; t < threads; ++t) {
+            pool.emplace_back([&] {
+                size_t found = 0;
+                for (int key : lookup) found += find(key);
+                hits += found;
+            });
+        }
+        for (auto& thread : pool) thread.join();
+        auto end = clock_type::now();
+        done = true;
+        if (writer.joinable()) writer.join();
+        return std::pair{static_cast<size_t>(std::chrono::duration_cast<ns>(end - start).count()), hits.load()};
+    };
+
+    ConcurrentHashMap<int, int> concurrent;
+    HashMap<int, int> locked;
+    std::shared_mutex lock;
+    for (int i = 0; i < size; ++i) {
+        concurrent.insert({i, i});
+        locked.insert({i, i});
+    }
+    size_t expected_hits = std::count_if(lookup.begin(), lookup.end(), [&](int key) { return key < size; });
+    auto concurrent_find = [&](int key) { return concurrent.contains(key); };
+    auto concurrent_write = [&](int key) {
+        concurrent.insert({key, key});
+        concurrent.erase(key);
+    };
+    auto locked_find = [&](int key) {
+        std::shared_lock guard(lock);
+        return locked.contains(key);
+    };
+    auto locked_write = [&](int key) {
+        std::unique_lock guard(lock);
+        locked.insert({key, key});
+        locked.erase(key);
+    };
+
+    size_t max_threads = std::max(8u, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        std::cout << "threads " << std::setw(3) << threads;
+        for (bool with_writer : {false, true}) {
+            auto [concurrent_result, concurrent_hits] = time_readers(threads, with_writer, concurrent_find, concurrent_write);
+            auto [locked_result, locked_hits] = time_readers(threads, with_writer, locked_find, locked_write);
+            VERIFY_TRUE(concurrent_hits == threads * expected_hits && locked_hits == threads * expected_hits, __LINE__);
+            std::cout << (with_writer ? " | one writer: " : " | no writer: ");
+            std::cout << "ConcurrentHashMap " << std::setw(13) << print_with_commas(concurrent_result);
+            std::cout << ", HashMap + shared_mutex " << std::setw(13) << print_with_commas(locked_result);
+        }
+        std::cout << std::endl;
+    }
+    return true;
+}
+
+int J_benchmark_parallel_rehash() {
+    cout << "Task: rehash N elements into twice as many buckets with T threads, measured in ns." << endl;
+    cout << "(this machine runs " << std::thread::hardware_concurrency() << " threads at once, and rehash uses no more)" << endl;
+    std::vector<int> sizes{100000, 1000000, 4000000};
+    size_t max_threads = std::max(8u, std::thread::hardware_concurrency());
+    for (int size : sizes) {
+        std::cout << "size " << std::setw(10) << size;
+        for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+            HashMap<int, int> map(size);
+            for (int i = 0; i < size; i++) {
+                map.insert({i, i});
+            }
+            auto start = clock_type::now();
+            map.rehash(2 * size, threads);
+            auto end = clock_type::now();
+            VERIFY_TRUE(map.size() == size_t(size) && map.bucket_count() == 2 * size_t(size), __LINE__);
+            size_t result = std::chrono::duration_cast<ns>(end - start).count();
+            std::cout << " | " << threads << (threads == 1 ? " thread: " : " threads: ")
+                      << std::setw(12) << print_with_commas(result);
+        }
+        std::cout << std::endl;
+    }
+    return true;
+}
+
+int K_benchmark_parallel_iterate() {
+    cout << "Task: sum and then double the mapped values of N elements, with a range-for and with" << endl;
+    cout << "parallel_reduce/parallel_for_each on T threads, measured in ns." << endl;
+    std::vector<int> sizes{10000, 100000, 1000000, 4000000};
+    size_t max_threads = std::max(4u, std::thread::hardware_concurrency());
+    for (int size : sizes) {
+        HashMap<int, long> map(size);
+        long expected = 0;
+        for (int i = 0; i < size; i++) {
+            map.insert({i, i});
+            expected += i;
+        }
+
+        auto start = clock_type::now();
+        long sum = 0;
+        for (const auto& [key, value] : map) {
+            sum += value;
+        }
+        for (auto& [key, value] : map) {
+            value *= 2;
+        }
+        auto end = clock_type::now();
+        VERIFY_TRUE(sum == expected, __LINE__);
+        size_t result = std::chrono::duration_cast<ns>(end - start).count();
+        std::cout << "size " << std::setw(10) << size << " | range-for: " << std::setw(12) << print_with_commas(result);
+
+        for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+            start = clock_type::now();
+            sum = map.parallel_reduce(0L, [](const auto& kv) { return kv.second; }, std::plus<long>(), threads);
+            map.parallel_for_each([](auto& kv) { kv.second /= 2; }, threads);
+            end = clock_type::now();
+            VERIFY_TRUE(sum == 2 * expected, __LINE__);
+            map.parallel_for_each([](auto& kv) { kv.second *= 2; }, threads);
+            result = std::chrono::duration_cast<ns>(end - start).count();
+            std::cout << " | " << threads << (threads == 1 ? " thread: " : " threads: ")
+                      << std::setw(12) << print_with_commas(result);
+        }
+        std::cout << std::endl;
+    }
+    return true;
+}
+
+int L_benchmark_sparse_iterate() {
+    cout << "Task: iterate over N elements in a table with B buckets, measured in ns." << endl;
+    std::vector<std::pair<int, size_t>> shapes{{10000, 10000}, {10000, 1000000}, {10000, 10000000},
+                                               {1000000, 10000000}};
+    for (auto [size, buckets] : shapes) {
+        HashMap<int, int> map(buckets);
+        for (int i = 0; i < size; i++) {
+            map.insert({i, i});
+        }
+        VERIFY_TRUE(map.bucket_count() == buckets, __LINE__);
+
+        auto start = clock_type::now();
+        long long sum = 0;
+        for (const auto& [key, value] : map) {
+            sum += value;
+        }
+        auto end = clock_type::now();
+        VERIFY_TRUE(sum == (long long)size * (size - 1) / 2, __LINE__);
+        size_t result = std::chrono::duration_cast<ns>(end - start).count();
+        std::cout << "size " << std::setw(10) << size << " | buckets " << std::setw(10) << buckets
+                  << " | iterate: " << std::setw(13) << print_with_commas(result) << std::endl;
+    }
+    return true;
+}
+
+int M_benchmark_iterate_storage() {
+    cout << "Task: iterate over all N elements with each storage policy, measured in ns." << endl;
+    auto good_hash_function = [](const int& key) {
+       return (key * 43037 + 52081) % 79229;
+    };
+
+    std::vector<size_t> chained_timing;
+    std::vector<size_t> dense_timing;
+    std::vector<int> sizes{10, 100, 1000, 10000, 100000, 1000000};
+    for (size_t size : sizes) {
+        std::vector<int> million;
+        for (size_t i = 0; i < size; i++) {
+            million.push_back(i);
+        }
+        std::shuffle(million.begin(), million.end(), std::default_random_engine{});
+
+        HashMap<int, int, decltype(good_hash_function)> chained(size, good_hash_function);
+        HashMap<int, int, decltype(good_hash_function), robin_hood_storage> robin_hood(size, good_hash_function);
+        HashMap<int, int, decltype(good_hash_function), swiss_storage> swiss(size, good_hash_function);
+        HashMap<int, int, decltype(good_hash_function), dense_storage> dense(size, good_hash_function);
+        for (int element : million) {
+            chained.insert({element, element});
+            robin_hood.insert({element, element});
+            swiss.insert({element, element});
+            dense.insert({element, element});
+        }
+
+        auto iterate_ns = [](const auto& map) {
+            auto start = clock_type::now();
+            size_t sum = 0;
+            for (const auto& [key, value] : map) {
+                sum += value;
+            }
+            auto end = clock_type::now();
+            VERIFY_TRUE(sum == map.size() * (map.size() - 1) / 2, __LINE__);
+            return static_cast<size_t>(std::chrono::duration_cast<ns>(end - start).count());
+        };
+        size_t chained_result = iterate_ns(chained);
+        size_t robin_hood_result = iterate_ns(robin_hood);
+        size_t swiss_result = iterate_ns(swiss);
+        size_t dense_result = iterate_ns(dense);
+
+        std::cout << "size "  << std::setw(10) << size;
+        std::cout << " | chained: " <<  std::setw(13) << print_with_commas(chained_result);
+        std::cout << " | robin_hood: " <<  std::setw(13) << print_with_commas(robin_hood_result);
+        std::cout << " | swiss: " <<  std::setw(13) << print_with_commas(swiss_result);
+        std::cout << " | dense: " <<  std::setw(13) << print_with_commas(dense_result) << std::endl;
+        chained_timing.push_back(chained_result);
+        dense_timing.push_back(dense_result);
+    }
+    // the contiguous entries should beat chasing a pointer per element on a large table
+    print_ratio("dense / chained at N = 1,000,000", dense_timing[5], chained_timing[5]);
+    VERIFY_TRUE(10*dense_timing[0] < dense_timing[3], __LINE__); // Ensure runtime of N = 10 is much faster than N = 10000
+    return true;
+}
+
+int N_benchmark_snapshot_startup() {
+    cout << "Task: load N string keys at startup, from text or from a snapshot, measured in ns." << endl;
+    std::string text_path = (std::filesystem::temp_directory_path() / "hashmap_n_benchmark.txt").string();
+    std::string snapshot_path = (std::filesystem::temp_directory_path() / "hashmap_n_benchmark.snap").string();
+    std::vector<size_t> text_timing;
+    std::vector<size_t> snapshot_timing;
+    std::vector<int> sizes{1000, 10000, 100000, 1000000};
+    for (int size : sizes) {
+        HashMap<std::string, int> source;
+        {
+            std::ofstream text(text_path, std::ios::trunc);
+            for (int i = 0; i < size; i++) {
+                std::string key = "key" + std::to_string(i * 7919LL);
+                text << key << ' ' << i << '\n';
+                source.insert({key, i});
+            }
+        }
+        save_snapshot(source, snapshot_path);
+        std::string probe = "key" + std::to_string((size - 1) * 7919LL);
+
+        auto start = clock_type::now();
+        HashMap<std::string, int> parsed;
+        {
+            std::ifstream text(text_path);
+            std::string key;
+            int value;
+            while (text >> key >> value) {
+                parsed.insert({key, value});
+            }
+        }
+        auto middle = clock_type::now();
+        MappedHashMap<std::string, int> mapped(snapshot_path);
+        int found = mapped.at(probe);
+        auto end = clock_type::now();
+        VERIFY_TRUE(parsed == source && mapped.size() == source.size() && found == size - 1, __LINE__);
+
+        size_t text_result = std::chrono::duration_cast<ns>(middle - start).count();
+        size_t snapshot_result = std::chrono::duration_cast<ns>(end - middle).count();
+        std::cout << "size "  << std::setw(10) << size;
+        std::cout << " | parse text: " <<  std::setw(13) << print_with_commas(text_result);
+        std::cout << " | map snapshot + find: " <<  std::setw(13) << print_with_commas(snapshot_result) << std::endl;
+        text_timing.push_back(text_result);
+        snapshot_timing.push_back(snapshot_result);
+    }
+    std::filesystem::remove(text_path);
+    std::filesystem::remove(snapshot_path);
+    // opening a large snapshot should be much faster than rebuilding the map from text
+    print_ratio("text / snapshot at N = 1,000,000", text_timing[3], snapshot_timing[3]);
+    return true;
+}
+
 int B_benchmark_find() {
     cout << "Task: find N elements (random hit/miss), measured in ns." << endl;
     auto good_hash_function = [](const int& key) {
@@ -1976,12 +4001,346 @@ int C_benchmark_iterate() {
     return true;
 }
 
+template <typename Map>
+size_t benchmark_find_ns(const Map& map, const std::vector<int>& lookup, int& misses) {
+    auto start = clock_type::now();
+    misses = 0;
+    for (size_t i = 0; i < lookup.size(); i += 2) {
+        misses += (map.find(lookup[i]) == map.end());
+    }
+    auto end = clock_type::now();
+    return std::chrono::duration_cast<ns>(end - start).count();
+}
+
+int D_benchmark_find_storage() {
+    cout << "Task: find N elements (random hit/miss) with each storage policy, measured in ns." << endl;
+    auto good_hash_function = [](const int& key) {
+       return (key * 43037 + 52081) % 79229;
+    };
+
+    std::vector<size_t> robin_hood_timing;
+    std::vector<size_t> swiss_timing;
+    std::vector<int> sizes{10, 100, 1000, 10000, 100000, 1000000};
+    for (size_t size : sizes) {
+        std::vector<int> million;
+        std::vector<int> lookup;
+        for (size_t i = 0; i < 2*size; i++) {
+            million.push_back(i);
+            lookup.push_back(i);
+        }
+        auto rng = std::default_random_engine {};
+        std::shuffle(million.begin(), million.end(), rng);
+        std::shuffle(lookup.begin(), lookup.end(), rng);
+
+        HashMap<int, int, decltype(good_hash_function)> chained(size, good_hash_function);
+        HashMap<int, int, decltype(good_hash_function), robin_hood_storage> robin_hood(size, good_hash_function);
+        HashMap<int, int, decltype(good_hash_function), swiss_storage> swiss(size, good_hash_function);
+        std::unordered_map<int, int, decltype(good_hash_function)> std_map(size, good_hash_function);
+        for (size_t i = 0; i < million.size(); i += 2) {
+            chained.insert({million[i], million[i]});
+            robin_hood.insert({million[i], million[i]});
+            swiss.insert({million[i], million[i]});
+            std_map.insert({million[i], million[i]});
+        }
+
+        int chained_misses, robin_hood_misses, swiss_misses, std_map_misses;
+        size_t chained_result = benchmark_find_ns(chained, lookup, chained_misses);
+        size_t robin_hood_result = benchmark_find_ns(robin_hood, lookup, robin_hood_misses);
+        size_t swiss_result = benchmark_find_ns(swiss, lookup, swiss_misses);
+        size_t std_map_result = benchmark_find_ns(std_map, lookup, std_map_misses);
+        VERIFY_TRUE(chained_misses == std_map_misses && robin_hood_misses == std_map_misses, __LINE__);
+        VERIFY_TRUE(swiss_misses == std_map_misses, __LINE__);
+
+        std::cout << "size "  << std::setw(10) << size;
+        std::cout << " | chained: " <<  std::setw(13) << print_with_commas(chained_result);
+        std::cout << " | robin_hood: " <<  std::setw(13) << print_with_commas(robin_hood_result);
+        std::cout << " | swiss: " <<  std::setw(13) << print_with_commas(swiss_result);
+        std::cout << " | std:unordered_map: "  << std::setw(13) << print_with_commas(std_map_result) << std::endl;
+        robin_hood_timing.push_back(robin_hood_result);
+        swiss_timing.push_back(swiss_result);
+    }
+    VERIFY_TRUE(10*robin_hood_timing[0] < robin_hood_timing[3], __LINE__); // Ensure runtime of N = 10 is much faster than N = 10000
+    VERIFY_TRUE(10*swiss_timing[0] < swiss_timing[3], __LINE__);
+    return true;
+}
+
+int O_benchmark_frozen() {
+    cout << "Task: build a FrozenHashMap from a HashMap with N elements, then find N keys (random hit/miss)"
+         << " in each, measured in ns." << endl;
+    std::vector<size_t> chained_timing;
+    std::vector<size_t> frozen_timing;
+    std::vector<int> sizes{1000, 10000, 100000, 1000000};
+    for (int size : sizes) {
+        std::vector<int> million;
+        std::vector<int> lookup;
+        for (int i = 0; i < 2*size; i++) {
+            million.push_back(i);
+            lookup.push_back(i);
+        }
+        auto rng = std::default_random_engine {};
+        std::shuffle(million.begin(), million.end(), rng);
+        std::shuffle(lookup.begin(), lookup.end(), rng);
+
+        HashMap<int, int> chained;
+        for (size_t i = 0; i < million.size(); i += 2) {
+            chained.insert({million[i], million[i]});
+        }
+        auto start = clock_type::now();
+        auto frozen = FrozenHashMap<int, int>::build(chained);
+        auto end = clock_type::now();
+        size_t build_result = std::chrono::duration_cast<ns>(end - start).count();
+
+        // best of five runs, so one-off stalls don't decide the comparison
+        int chained_misses, frozen_misses;
+        size_t chained_result = SIZE_MAX, frozen_result = SIZE_MAX;
+        for (int round = 0; round < 5; ++round) {
+            chained_result = std::min(chained_result, benchmark_find_ns(chained, lookup, chained_misses));
+            frozen_result = std::min(frozen_result, benchmark_find_ns(frozen, lookup, frozen_misses));
+        }
+        VERIFY_TRUE(chained_misses == frozen_misses, __LINE__);
+
+        std::cout << "size "  << std::setw(10) << size;
+        std::cout << " | build: " <<  std::setw(13) << print_with_commas(build_result);
+        std::cout << " | chained find: " <<  std::setw(13) << print_with_commas(chained_result);
+        std::cout << " | frozen find: " <<  std::setw(13) << print_with_commas(frozen_result) << std::endl;
+        chained_timing.push_back(chained_result);
+        frozen_timing.push_back(frozen_result);
+    }
+    // lookups with no chains to follow should beat the chained map on a large table: one read
+    // of a pilot that stays in cache and one of the slot, against a bucket and a node
+    print_ratio("frozen / chained find at N = 1,000,000", frozen_timing[3], chained_timing[3]);
+    VERIFY_TRUE(10*frozen_timing[0] < frozen_timing[3], __LINE__); // Ensure runtime of N = 1000 is much faster than N = 1000000
+    return true;
+}
+
+template <typename Map>
+size_t benchmark_tiny_maps_ns(int maps, int size) {
+    auto start = clock_type::now();
+    long long sum = 0;
+    for (int m = 0; m < maps; ++m) {
+        Map map;
+        for (int i = 0; i < size; ++i) map.insert({m + i, i});
+        for (int i = 0; i < size; ++i) sum += map.at(m + i);
+    }
+    auto end = clock_type::now();
+    VERIFY_TRUE(sum == 1LL * maps * size * (size - 1) / 2, __LINE__);
+    return static_cast<size_t>(std::chrono::duration_cast<ns>(end - start).count());
+}
+
+int P_benchmark_tiny_maps() {
+    cout << "Task: build, search and destroy 100,000 maps of N elements each, measured in ns." << endl;
+    const int maps = 100000;
+    std::vector<size_t> chained_timing;
+    std::vector<size_t> small_timing;
+    for (int size : {1, 4, 8, 16}) {
+        size_t chained_result = benchmark_tiny_maps_ns<HashMap<int, int>>(maps, size);
+        size_t dense_result = benchmark_tiny_maps_ns<HashMap<int, int, std::hash<int>, dense_storage>>(maps, size);
+        size_t small_result = benchmark_tiny_maps_ns<HashMap<int, int, std::hash<int>, small_storage<8>>>(maps, size);
+
+        std::cout << "size "  << std::setw(10) << size;
+        std::cout << " | chained: " <<  std::setw(13) << print_with_commas(chained_result);
+        std::cout << " | dense: " <<  std::setw(13) << print_with_commas(dense_result);
+        std::cout << " | small_storage<8>: " <<  std::setw(13) << print_with_commas(small_result) << std::endl;
+        chained_timing.push_back(chained_result);
+        small_timing.push_back(small_result);
+    }
+    // keeping a few elements inline should beat allocating buckets and nodes for them
+    print_ratio("small_storage<8> / chained at N = 4", small_timing[1], chained_timing[1]);
+    return true;
+}
+
+int Q_benchmark_find_many() {
+    cout << "Task: find 2N keys (half hits), one at a time or with contains_many, measured in ns." << endl;
+    std::vector<size_t> single_timing;
+    std::vector<size_t> batched_timing;
+    std::vector<int> sizes{1000, 100000, 1000000};
+    for (size_t size : sizes) {
+        std::vector<int> keys(2 * size);
+        std::iota(keys.begin(), keys.end(), 0);
+        auto rng = std::default_random_engine {};
+        std::shuffle(keys.begin(), keys.end(), rng);
+        HashMap<int, int> map(size);
+        for (size_t i = 0; i < size; ++i) map.insert({keys[i], keys[i]});
+        std::shuffle(keys.begin(), keys.end(), rng);
+
+        auto single_start = clock_type::now();
+        size_t single_hits = 0;
+        for (int key : keys) single_hits += map.contains(key);
+        auto single_end = clock_type::now();
+
+        std::vector<bool> present;
+        present.reserve(keys.size());
+        auto batched_start = clock_type::now();
+        map.contains_many(keys.begin(), keys.end(), std::back_inserter(present));
+        auto batched_end = clock_type::now();
+        size_t batched_hits = std::count(present.begin(), present.end(), true);
+        VERIFY_TRUE(single_hits == size && batched_hits == size, __LINE__);
+
+        size_t single_result = std::chrono::duration_cast<ns>(single_end - single_start).count();
+        size_t batched_result = std::chrono::duration_cast<ns>(batched_end - batched_start).count();
+        std::cout << "size "  << std::setw(10) << size;
+        std::cout << " | contains: " <<  std::setw(13) << print_with_commas(single_result);
+        std::cout << " | contains_many: " <<  std::setw(13) << print_with_commas(batched_result) << std::endl;
+        single_timing.push_back(single_result);
+        batched_timing.push_back(batched_result);
+    }
+    // overlapping the cache misses of a batch should beat taking them one at a time
+    print_ratio("contains_many / contains at N = 1,000,000", batched_timing[2], single_timing[2]);
+    VERIFY_TRUE(10*batched_timing[0] < batched_timing[2], __LINE__); // Ensure runtime of N = 1000 is much faster than N = 1000000
+    return true;
+}
+
+int G_benchmark_bulk_build() {
+    cout << "Task: build a HashMap from N unique pairs, measured in ns." << endl;
+    std::vector<size_t> insert_timing;
+    std::vector<size_t> unique_timing;
+    std::vector<int> sizes{1000, 10000, 100000, 1000000};
+    for (int size : sizes) {
+        std::vector<std::pair<int, int>> rows;
+        for (int i = 0; i < size; i++) {
+            rows.push_back({i, i});
+        }
+        std::shuffle(rows.begin(), rows.end(), std::default_random_engine{});
+
+        auto start = clock_type::now();
+        HashMap<int, int> inserted;
+        for (const auto& row : rows) {
+            inserted.insert(row);
+        }
+        auto middle = clock_type::now();
+        HashMap<int, int> ranged(rows.begin(), rows.end());
+        auto middle2 = clock_type::now();
+        auto unique = HashMap<int, int>::from_unique_range(rows.begin(), rows.end());
+        auto end = clock_type::now();
+        VERIFY_TRUE(inserted.size() == size_t(size) && ranged == inserted && unique == inserted, __LINE__);
+
+        size_t insert_result = std::chrono::duration_cast<ns>(middle - start).count();
+        size_t range_result = std::chrono::duration_cast<ns>(middle2 - middle).count();
+        size_t unique_result = std::chrono::duration_cast<ns>(end - middle2).count();
+        std::cout << "size "  << std::setw(10) << size;
+        std::cout << " | insert one by one: " <<  std::setw(13) << print_with_commas(insert_result);
+        std::cout << " | range ctor: " <<  std::setw(13) << print_with_commas(range_result);
+        std::cout << " | from_unique_range: " <<  std::setw(13) << print_with_commas(unique_result) << std::endl;
+        insert_timing.push_back(insert_result);
+        unique_timing.push_back(unique_result);
+    }
+    // building a large table in bulk should be faster than growing it one insert at a time
+    print_ratio("from_unique_range / insert at N = 1,000,000", unique_timing[3], insert_timing[3]);
+    VERIFY_TRUE(10*unique_timing[0] < unique_timing[3], __LINE__); // Ensure runtime of N = 1000 is much faster than N = 1000000
+    return true;
+}
+
+int F_benchmark_find_indexing() {
+    cout << "Task: find N int keys (random hit/miss) with each bucket indexing policy, measured in ns." << endl;
+    std::vector<size_t> modulo_timing;
+    std::vector<size_t> fibonacci_timing;
+    std::vector<int> sizes{10, 100, 1000, 10000, 100000, 1000000};
+    for (size_t size : sizes) {
+        // random keys: with sequential keys and std::hash<int> (the identity), modulo_indexing
+        // puts exactly one key in each bucket, which real keys rarely do
+        std::vector<int> million;
+        std::mt19937 key_rng(106);
+        for (size_t i = 0; i < 2*size; i++) {
+            million.push_back(static_cast<int>(key_rng()));
+        }
+        std::vector<int> lookup = million;
+        auto rng = std::default_random_engine {};
+        std::shuffle(lookup.begin(), lookup.end(), rng);
+
+        HashMap<int, int> modulo(size);
+        HashMap<int, int, std::hash<int>, basic_chained_storage<mask_indexing>> mask(size);
+        HashMap<int, int, std::hash<int>, basic_chained_storage<fibonacci_indexing>> fibonacci(size);
+        std::unordered_map<int, int> std_map(size);
+        for (size_t i = 0; i < million.size(); i += 2) {
+            modulo.insert({million[i], million[i]});
+            mask.insert({million[i], million[i]});
+            fibonacci.insert({million[i], million[i]});
+            std_map.insert({million[i], million[i]});
+        }
+
+        // best of five runs, so one-off stalls don't decide the comparison
+        int modulo_misses, mask_misses, fibonacci_misses, std_map_misses;
+        size_t modulo_result = SIZE_MAX, mask_result = SIZE_MAX, fibonacci_result = SIZE_MAX, std_map_result = SIZE_MAX;
+        for (int round = 0; round < 5; ++round) {
+            modulo_result = std::min(modulo_result, benchmark_find_ns(modulo, lookup, modulo_misses));
+            mask_result = std::min(mask_result, benchmark_find_ns(mask, lookup, mask_misses));
+            fibonacci_result = std::min(fibonacci_result, benchmark_find_ns(fibonacci, lookup, fibonacci_misses));
+            std_map_result = std::min(std_map_result, benchmark_find_ns(std_map, lookup, std_map_misses));
+        }
+        VERIFY_TRUE(modulo_misses == std_map_misses && mask_misses == std_map_misses, __LINE__);
+        VERIFY_TRUE(fibonacci_misses == std_map_misses, __LINE__);
+
+        std::cout << "size "  << std::setw(10) << size;
+        std::cout << " | modulo: " <<  std::setw(13) << print_with_commas(modulo_result);
+        std::cout << " | mask: " <<  std::setw(13) << print_with_commas(mask_result);
+        std::cout << " | fibonacci: " <<  std::setw(13) << print_with_commas(fibonacci_result);
+        std::cout << " | std:unordered_map: "  << std::setw(13) << print_with_commas(std_map_result) << std::endl;
+        modulo_timing.push_back(modulo_result);
+        fibonacci_timing.push_back(fibonacci_result);
+    }
+    // fibonacci_indexing should be faster while the table fits in cache (N = 10000), where the
+    // division of modulo_indexing is a big part of a lookup. At larger N cache misses dominate.
+    print_ratio("fibonacci / modulo at N = 10,000", fibonacci_timing[3], modulo_timing[3]);
+    VERIFY_TRUE(10*fibonacci_timing[0] < fibonacci_timing[3], __LINE__); // Ensure runtime of N = 10 is much faster than N = 10000
+    return true;
+}
+
+/*
+* Inserts n keys one at a time into a new HashMap<int, int> and returns the latency of every
+* insert, sorted. Runs three rounds and keeps the one with the smallest maximum, so a one-off
+* stall (the OS running something else) doesn't decide the result.
+*/
+std::vector<size_t> benchmark_insert_latencies(bool incremental, int n) {
+    std::vector<size_t> best;
+    for (int round = 0; round < 3; ++round) {
+        HashMap<int, int> map;
+        map.incremental_rehash(incremental);
+        std::vector<size_t> latencies;
+        latencies.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            auto start = clock_type::now();
+            map.insert({i, i});
+            auto end = clock_type::now();
+            latencies.push_back(std::chrono::duration_cast<ns>(end - start).count());
+        }
+        VERIFY_TRUE(map.size() == size_t(n), __LINE__);
+        std::sort(latencies.begin(), latencies.end());
+        if (best.empty() || latencies.back() < best.back()) best = std::move(latencies);
+    }
+    return best;
+}
+
+int E_benchmark_insert_latency() {
+    cout << "Task: insert N elements into a growing map, measured in ns per insert (p99 and max)." << endl;
+    std::vector<int> sizes{1000, 10000, 100000, 1000000};
+    std::vector<size_t> stop_the_world_max;
+    std::vector<size_t> incremental_max;
+    for (int size : sizes) {
+        auto stop_the_world_result = benchmark_insert_latencies(false, size);
+        auto incremental_result = benchmark_insert_latencies(true, size);
+
+        size_t p99 = size - size / 100;
+        std::cout << "size "  << std::setw(10) << size;
+        std::cout << " | rehash all at once: p99 " << std::setw(6) << print_with_commas(stop_the_world_result[p99])
+                  << ", max " << std::setw(13) << print_with_commas(stop_the_world_result.back());
+        std::cout << " | incremental: p99 " << std::setw(6) << print_with_commas(incremental_result[p99])
+                  << ", max " << std::setw(13) << print_with_commas(incremental_result.back()) << std::endl;
+        stop_the_world_max.push_back(stop_the_world_result.back());
+        incremental_max.push_back(incremental_result.back());
+    }
+    // the slowest insert at N = 100000 should be faster with incremental rehashing. At larger N
+    // both maxima are dominated by allocating the new bucket array, which happens either way.
+    print_ratio("incremental / all at once, max at N = 100,000", incremental_max[2], stop_the_world_max[2]);
+    return true;
+}
+
 using std::cout;
 using std::endl;
 int run_milestone1_tests();
 int run_milestone2_tests();
 int run_milestone3_tests();
 int run_milestone4_tests();
+int run_extension_tests();
 int run_benchmark();
 
 template <typename T>
@@ -2025,15 +4384,17 @@ void run_test_harness() {
     required_pass += run_milestone3_tests();
     cout << endl << "----- Milestone 4 Tests (Required) -----" << endl;
     required_pass += run_milestone4_tests();
+    cout << endl << "----- Extension Tests (Optional) -----" << endl;
+    bonus_pass += run_extension_tests();
     cout << endl << "----- Benchmark Tests (Optional) -----" << endl;
     bonus_pass += run_benchmark();
     cout << endl << "----- Test Harness Summary -----" << endl;
     cout << "Required Tests passed: " << required_pass << "/36" << endl;
-    cout << "Optional Tests passed: " << bonus_pass << "/7" << endl;
+    cout << "Optional Tests passed: " << bonus_pass << "/48" << endl;
 
     if (required_pass < 36) {
         cout << "Some required tests were failed or skipped. " << endl;
-    } else if (bonus_pass == 7) {
+    } else if (bonus_pass == 48) {
         cout << "You passed all required and optional tests! Awesome job!" << endl;
     } else {
         cout << "You passed all required tests! Great job!" << endl;
@@ -2196,6 +4557,68 @@ int run_milestone4_tests() {
     return passed;
 }
 
+int run_extension_tests() {
+    int passed = 0;
+    #if RUN_EXTENSION_TESTS
+    passed += run_test(A_robin_hood_basic, "A_robin_hood_basic");
+    passed += run_test(B_robin_hood_iterator_erase, "B_robin_hood_iterator_erase");
+    passed += run_test(C_swiss_basic, "C_swiss_basic");
+    passed += run_test(D_swiss_tombstones, "D_swiss_tombstones");
+    passed += run_test(E_max_load_factor_reserve, "E_max_load_factor_reserve");
+    passed += run_test(F_incremental_rehash, "F_incremental_rehash");
+    passed += run_test(G_node_pool, "G_node_pool");
+    passed += run_test(H_pmr_allocator, "H_pmr_allocator");
+    passed += run_test(I_transparent_lookup, "I_transparent_lookup");
+    passed += run_test(J_emplace, "J_emplace");
+    passed += run_test(K_cached_hash, "K_cached_hash");
+    passed += run_test(L_bucket_indexing, "L_bucket_indexing");
+    passed += run_test(M_bulk_build, "M_bulk_build");
+    passed += run_test(N_clone_copy, "N_clone_copy");
+    passed += run_test(O_concurrent_map, "O_concurrent_map");
+    passed += run_test(P_lock_free_reads, "P_lock_free_reads");
+    passed += run_test(Q_sharded_map, "Q_sharded_map");
+    passed += run_test(R_parallel_rehash, "R_parallel_rehash");
+    passed += run_test(S_parallel_iteration, "S_parallel_iteration");
+    passed += run_test(T_bucket_interface, "T_bucket_interface");
+    passed += run_test(U_occupancy_bitmap, "U_occupancy_bitmap");
+    passed += run_test(V_dense_storage, "V_dense_storage");
+    passed += run_test(W_snapshot, "W_snapshot");
+    passed += run_test(X_frozen_map, "X_frozen_map");
+    passed += run_test(Y_static_map, "Y_static_map");
+    passed += run_test(Z_small_storage, "Z_small_storage");
+    passed += run_test(AA_find_many, "AA_find_many");
+    #else
+    skip_test("A_robin_hood_basic");
+    skip_test("B_robin_hood_iterator_erase");
+    skip_test("C_swiss_basic");
+    skip_test("D_swiss_tombstones");
+    skip_test("E_max_load_factor_reserve");
+    skip_test("F_incremental_rehash");
+    skip_test("G_node_pool");
+    skip_test("H_pmr_allocator");
+    skip_test("I_transparent_lookup");
+    skip_test("J_emplace");
+    skip_test("K_cached_hash");
+    skip_test("L_bucket_indexing");
+    skip_test("M_bulk_build");
+    skip_test("N_clone_copy");
+    skip_test("O_concurrent_map");
+    skip_test("P_lock_free_reads");
+    skip_test("Q_sharded_map");
+    skip_test("R_parallel_rehash");
+    skip_test("S_parallel_iteration");
+    skip_test("T_bucket_interface");
+    skip_test("U_occupancy_bitmap");
+    skip_test("V_dense_storage");
+    skip_test("W_snapshot");
+    skip_test("X_frozen_map");
+    skip_test("Y_static_map");
+    skip_test("Z_small_storage");
+    skip_test("AA_find_many");
+    #endif
+    return passed;
+}
+
 int run_benchmark() {
     int passed = 0;
     #if RUN_BENCHMARK
@@ -2204,10 +4627,52 @@ int run_benchmark() {
     passed += run_test(B_benchmark_find, "B_benchmark_find");
     std::cout << std::endl;
     passed += run_test(C_benchmark_iterate, "C_benchmark_iterate");
+    std::cout << std::endl;
+    passed += run_test(D_benchmark_find_storage, "D_benchmark_find_storage");
+    std::cout << std::endl;
+    passed += run_test(E_benchmark_insert_latency, "E_benchmark_insert_latency");
+    std::cout << std::endl;
+    passed += run_test(F_benchmark_find_indexing, "F_benchmark_find_indexing");
+    std::cout << std::endl;
+    passed += run_test(G_benchmark_bulk_build, "G_benchmark_bulk_build");
+    std::cout << std::endl;
+    passed += run_test(H_benchmark_concurrent_insert_erase, "H_benchmark_concurrent_insert_erase");
+    std::cout << std::endl;
+    passed += run_test(I_benchmark_concurrent_reads, "I_benchmark_concurrent_reads");
+    std::cout << std::endl;
+    passed += run_test(J_benchmark_parallel_rehash, "J_benchmark_parallel_rehash");
+    std::cout << std::endl;
+    passed += run_test(K_benchmark_parallel_iterate, "K_benchmark_parallel_iterate");
+    std::cout << std::endl;
+    passed += run_test(L_benchmark_sparse_iterate, "L_benchmark_sparse_iterate");
+    std::cout << std::endl;
+    passed += run_test(M_benchmark_iterate_storage, "M_benchmark_iterate_storage");
+    std::cout << std::endl;
+    passed += run_test(N_benchmark_snapshot_startup, "N_benchmark_snapshot_startup");
+    std::cout << std::endl;
+    passed += run_test(O_benchmark_frozen, "O_benchmark_frozen");
+    std::cout << std::endl;
+    passed += run_test(P_benchmark_tiny_maps, "P_benchmark_tiny_maps");
+    std::cout << std::endl;
+    passed += run_test(Q_benchmark_find_many, "Q_benchmark_find_many");
     #else
     skip_test("A_benchmark_insert_erase");
     skip_test("B_benchmark_find");
     skip_test("C_benchmark_iterate");
+    skip_test("D_benchmark_find_storage");
+    skip_test("E_benchmark_insert_latency");
+    skip_test("F_benchmark_find_indexing");
+    skip_test("G_benchmark_bulk_build");
+    skip_test("H_benchmark_concurrent_insert_erase");
+    skip_test("I_benchmark_concurrent_reads");
+    skip_test("J_benchmark_parallel_rehash");
+    skip_test("K_benchmark_parallel_iterate");
+    skip_test("L_benchmark_sparse_iterate");
+    skip_test("M_benchmark_iterate_storage");
+    skip_test("N_benchmark_snapshot_startup");
+    skip_test("O_benchmark_frozen");
+    skip_test("P_benchmark_tiny_maps");
+    skip_test("Q_benchmark_find_many");
     #endif
     return passed;
 }